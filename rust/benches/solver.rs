@@ -0,0 +1,92 @@
+// Copyright (C) 2017 - Pavel Nikitin
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+//! Benchmarks `LightsSolver::from` and `LightsSolver::solve` over all-ones
+//! fields. Every case is warmed up and sampled, the median and the minimum
+//! times are printed. `cargo bench -- 40` runs the cases with `40` in name.
+
+extern crate los;
+
+use std::env;
+use std::time::{Duration, Instant};
+use los::bitmat::BitMat;
+use los::ligsol::LightsSolver;
+
+/// Sizes of the fields, all have the only solution.
+const SIZES: [usize; 5] = [10, 20, 25, 40, 60];
+
+/// Number of timed runs of every case.
+const N_SAMPLES: usize = 15;
+
+/// Minimum time of the warm up of every case.
+const WARM_UP_MS: u64 = 200;
+
+// Creates all-ones field.
+fn field(n: usize) -> BitMat {
+    let mut field = BitMat::with_size(n, n);
+
+    for i in 0..n {
+        field[i].setall(true);
+    }
+
+    field
+}
+
+// Times the `routine` after the `setup`, prints the median and the minimum.
+fn bench<T, S, R>(name: &str, mut setup: S, mut routine: R)
+    where S: FnMut() -> T, R: FnMut(T) {
+    let warm_up = Instant::now();
+    while warm_up.elapsed() < Duration::from_millis(WARM_UP_MS) {
+        routine(setup());
+    }
+
+    let mut samples: Vec<Duration> = (0..N_SAMPLES).map(|_| {
+        let input = setup();
+        let start = Instant::now();
+        routine(input);
+        start.elapsed()
+    }).collect();
+    samples.sort();
+
+    println!("{:<24} median {:>12.3} ms   min {:>12.3} ms", name,
+             samples[N_SAMPLES / 2].as_secs_f64() * 1e3,
+             samples[0].as_secs_f64() * 1e3);
+}
+
+fn main() {
+    // Cargo passes `--bench` and the filter
+    let filter = env::args().skip(1).find(|arg| !arg.starts_with("--")).unwrap_or(String::new());
+
+    for &n in SIZES.iter() {
+        let field = field(n);
+        let name = |case: &str| format!("{}/{}x{}", case, n, n);
+
+        if name("from").contains(&filter) {
+            bench(&name("from"), || (), |_| { LightsSolver::from(&field); });
+        }
+
+        for &(case, n_threads) in [("solve", 0), ("solve_1_thread", 1)].iter() {
+            if !name(case).contains(&filter) {
+                continue;
+            }
+
+            bench(&name(case), || {
+                let mut solver = LightsSolver::from(&field);
+                solver.alg_mut().set_threads(n_threads);
+                solver
+            }, |mut solver| { solver.solve(); });
+        }
+    }
+}
@@ -16,16 +16,89 @@
 //! Implements Gauss algorithm for `n_rows` logical equations and `n_cols-1`
 //! variables.    
 
+use std::cmp;
+use std::hint;
+use std::sync::RwLock;
+use std::sync::atomic::{AtomicUsize, Ordering};
+use std::thread;
 use ::bitmat::BitMat;
-use ::bitvec::BitVec;
+use ::bitvec::{BitVec, WORDSIZE};
+use ::rowbuf::RowBuf;
+
+/// Minimum number of equations per thread of elimination. A smaller part
+/// costs more on the synchronization of threads than it saves.
+pub const PAR_MIN_ROWS: usize = 256;
+
+// A missing pivot of column.
+const NO_PIVOT: usize = usize::MAX;
+
+// Number of spins of a waiting thread before it yields the processor.
+const SPIN_LIMIT: usize = 1 << 10;
+
+// A barrier spinning on the generation counter. Threads meet three times per
+// column, which is too often to sleep on a condition variable.
+struct SpinBarrier {
+    n_threads: usize,
+    count: AtomicUsize,
+    generation: AtomicUsize,
+}
+
+impl SpinBarrier {
+    fn new(n_threads: usize) -> SpinBarrier {
+        SpinBarrier {
+            n_threads: n_threads,
+            count: AtomicUsize::new(0),
+            generation: AtomicUsize::new(0),
+        }
+    }
+
+    // Blocks until all threads have called `wait`.
+    fn wait(&self) {
+        if self.n_threads == 1 {
+            return;
+        }
+
+        let generation = self.generation.load(Ordering::Acquire);
+        if self.count.fetch_add(1, Ordering::AcqRel) + 1 == self.n_threads {
+            self.count.store(0, Ordering::Relaxed);
+            self.generation.fetch_add(1, Ordering::Release);
+            return;
+        }
+
+        let mut n_spins = 0;
+        while self.generation.load(Ordering::Acquire) == generation {
+            if n_spins < SPIN_LIMIT {
+                hint::spin_loop();
+                n_spins += 1;
+            } else {
+                thread::yield_now();
+            }
+        }
+    }
+}
+
+// The state shared by threads of elimination.
+struct Shared {
+    barrier: SpinBarrier,
+    candidate: AtomicUsize,
+    pivot: RwLock<Vec<usize>>,
+}
+
+// The result of a thread: the pivot rows by columns and the order of columns.
+struct Part {
+    pivots: Vec<(usize, usize)>,
+    order: Vec<usize>,
+}
 
 /// Implements Gauss algorithm for `n_rows` logical equations and `n_cols-1`
 /// variables.    
 pub struct BitGauss {
     sys: BitMat,
+    order: Vec<usize>,
     rank: usize,
     n_solutions: usize,
     min_weight: usize,
+    n_threads: usize,
 }
 
 impl BitGauss {
@@ -33,13 +106,26 @@ impl BitGauss {
     /// equations. System contains `row` equations with `col-1` variables.
     #[inline]
     pub fn from(sys: BitMat) -> BitGauss {
+        let n_vars = sys.n_cols() - 1;
+
         BitGauss {
             sys: sys,
+            order: (0..n_vars).collect(),
             rank: 0,
             n_solutions: 0,
             min_weight: 0,
+            n_threads: 0,
         }
     }
+
+    /// Sets the number of threads of elimination. The default 0 takes a
+    /// thread per `PAR_MIN_ROWS` equations up to the number of processors.
+    /// Threads wait for each other spinning, so more threads than processors
+    /// are slow.
+    #[inline]
+    pub fn set_threads(&mut self, n_threads: usize) {
+        self.n_threads = n_threads;
+    }
         
     /// Returns an immutable `sys`.
     #[inline]
@@ -53,6 +139,12 @@ impl BitGauss {
         &mut self.sys
     }
     
+    /// Returns the variable of every column of the gaussed `sys`.
+    #[inline]
+    pub fn order(&self) -> &Vec<usize> {
+        &self.order
+    }
+
     /// Returns a `rank` of system.
     #[inline]
     pub fn rank(&self) -> usize {
@@ -72,6 +164,14 @@ impl BitGauss {
     }
     
     /// Gausses system with `n_rows` logical equations and `n_cols-1` variables.
+    /// A column without `true` on the main diagonal is swapped with the last
+    /// unchecked column, so the first `rank` columns are pivots for any system.
+    ///
+    /// The system is copied to a contiguous row-major buffer, which rows are
+    /// split between threads. Threads agree on the pivot row of every column
+    /// and eliminate it from their own rows, see `set_threads`. Every thread
+    /// loads its rows itself, so a large buffer is placed on the NUMA nodes
+    /// of the threads, see `RowBuf`.
     ///
     /// # Examples
     ///
@@ -96,31 +196,76 @@ impl BitGauss {
     /// ```
     pub fn gauss(&mut self) {
         let n_rows = self.sys.n_rows();
-      
-        // Convert the left square matrix to a identity matrix
-        for i in 0..n_rows {
-            // Find and set one on the main diagonal
-            for j in i..n_rows {
-                if self.sys.get(j, i) {
-                    self.sys.swap(j, i);
-                }
-            }
+        let n_cols = self.sys.n_cols();
+        let n_vars = self.order.len();
+        let stride = (n_cols + WORDSIZE - 1) / WORDSIZE;
 
-            // Skip column, if it does not contains `true`
-            if !self.sys.get(i, i) {
-                continue;
-            }
+        if n_rows == 0 {
+            return;
+        }
 
-            // Increase rank: the column contains `true` on the main diagonal
-            self.rank = i+1;
+        // Every thread loads and eliminates its own part of rows of a
+        // contiguous row-major buffer
+        let mut buf = RowBuf::zeroed(n_rows * stride);
+        let sys = self.sys.rows();
+        let n_threads = self.threads(n_rows);
+        let chunk = (n_rows + n_threads - 1) / n_threads;
+        let n_parts = (n_rows + chunk - 1) / chunk;
+        let n_pivots = cmp::min(n_rows, n_vars);
+        let shared = Shared {
+            barrier: SpinBarrier::new(n_parts),
+            candidate: AtomicUsize::new(NO_PIVOT),
+            pivot: RwLock::new(vec![0; stride]),
+        };
 
-            // Set values to `false` at column except the main diagonal
-            for j in 0..n_rows {
-                if self.sys.get(j, i) && j != i {
-                    self.sys.xor(j, i);
-                }
+        let mut parts: Vec<Part> = if n_parts == 1 {
+            load(&mut buf, sys, stride);
+            vec![eliminate(&mut buf, 0, stride, n_pivots, n_vars, &shared)]
+        } else {
+            thread::scope(|scope| {
+                let shared = &shared;
+                let handles: Vec<_> = buf.chunks_mut(chunk * stride)
+                    .enumerate()
+                    .map(|(k, rows)| scope.spawn(move || {
+                        load(rows, &sys[k * chunk..], stride);
+                        eliminate(rows, k * chunk, stride, n_pivots, n_vars, shared)
+                    }))
+                    .collect();
+                handles.into_iter().map(|handle| handle.join().unwrap()).collect()
+            })
+        };
+
+        // Every thread has the same order of columns
+        let mut by_col = vec![NO_PIVOT; n_pivots];
+        let mut is_pivot = vec![false; n_rows];
+        for part in &parts {
+            for &(col, row) in &part.pivots {
+                by_col[col] = row;
+                is_pivot[row] = true;
             }
         }
+        self.order = parts.swap_remove(0).order;
+        self.rank = by_col.iter().take_while(|&&row| row != NO_PIVOT).count();
+
+        // Copy the pivot rows by columns and then the rest rows back
+        let rows = by_col[..self.rank].iter().cloned()
+            .chain((0..n_rows).filter(|&row| !is_pivot[row]));
+        for (i, row) in rows.enumerate() {
+            self.sys[i].buf_mut()[..stride].copy_from_slice(&buf[row * stride..(row + 1) * stride]);
+        }
+    }
+
+    /// Returns the number of threads to eliminate `n_rows` equations.
+    fn threads(&self, n_rows: usize) -> usize {
+        if self.n_threads > 0 {
+            return cmp::min(self.n_threads, n_rows);
+        }
+        if n_rows < 2 * PAR_MIN_ROWS {
+            return 1;
+        }
+
+        let n_cpus = thread::available_parallelism().map(|n| n.get()).unwrap_or(1);
+        cmp::max(1, cmp::min(n_cpus, n_rows / PAR_MIN_ROWS))
     }
 
     // Finds shortest solution in the system.
@@ -146,7 +291,7 @@ impl BitGauss {
         // The system has one solution
         if rank == n_vars {
             for i in 0..n_rows {
-                solution.set(i, self.sys.get(i, n_vars));
+                solution.set(self.order[i], self.sys.get(i, n_vars));
             }
         }
         // The system has 2^(n_vars-rank) solutions
@@ -185,12 +330,12 @@ impl BitGauss {
 
                     // Get first part of elemets of solution from accumulator
                     for j in 0..rank {
-                        solution.set(j, accumulator.get(j));
+                        solution.set(self.order[j], accumulator.get(j));
                     }
 
                     // Get second part of elemets of solution from rest
                     for j in 0..n_rest {
-                        solution.set(rank + j, rest.get(j));
+                        solution.set(self.order[rank + j], rest.get(j));
                     }
                 }
             }
@@ -199,3 +344,98 @@ impl BitGauss {
         Some(solution)
     }
 }
+
+// Copies the equations to the rows of a thread. The pages of a mapped buffer
+// are first touched by the thread, which places them on its NUMA node.
+fn load(rows: &mut [usize], sys: &[BitVec], stride: usize) {
+    for (bits, row) in rows.chunks_mut(stride).zip(sys) {
+        bits.copy_from_slice(&row.buf()[..stride]);
+    }
+}
+
+// Eliminates the columns in `rows` of a thread, the first row is `first` row of
+// the system. Threads pick the first unused row with `true` of all threads as
+// pivot, the owner moves it to the end of its used rows. A column without
+// `true` is swapped with the last unchecked column by every thread, so the
+// first pivots are the first columns.
+fn eliminate(rows: &mut [usize], first: usize, stride: usize, n_pivots: usize,
+             n_vars: usize, shared: &Shared) -> Part {
+    let n_local = rows.len() / stride;
+    let mut n_used = 0;
+    let mut part = Part {
+        pivots: Vec::new(),
+        order: (0..n_vars).collect(),
+    };
+    let mut last = n_vars;
+    let mut i = 0;
+
+    while i < n_pivots {
+        let word = i / WORDSIZE;
+        let mask = 1usize << (i % WORDSIZE);
+
+        // Propose the first unused row with `true` at column
+        if let Some(row) = (n_used..n_local).find(|&row| rows[row * stride + word] & mask != 0) {
+            shared.candidate.fetch_min(first + row, Ordering::AcqRel);
+        }
+        shared.barrier.wait();
+
+        let pivot = shared.candidate.load(Ordering::Acquire);
+        let owner = pivot != NO_PIVOT && pivot >= first && pivot < first + n_local;
+        if owner {
+            let local = pivot - first;
+            for k in 0..stride {
+                rows.swap(local * stride + k, n_used * stride + k);
+            }
+            shared.pivot.write().unwrap().copy_from_slice(&rows[n_used * stride..(n_used + 1) * stride]);
+        }
+        shared.barrier.wait();
+
+        // Move the column without `true` to the end
+        if pivot == NO_PIVOT {
+            if last <= i + 1 {
+                break;
+            }
+            last -= 1;
+            for row in rows.chunks_mut(stride) {
+                swap_bits(row, i, last);
+            }
+            part.order.swap(i, last);
+            continue;
+        }
+
+        let mut skip = n_local;
+        if owner {
+            skip = n_used;
+            part.pivots.push((i, first + n_used));
+            n_used += 1;
+            shared.candidate.store(NO_PIVOT, Ordering::Release);
+        }
+
+        // Set values to `false` at column except the pivot row
+        {
+            let pivot_row = shared.pivot.read().unwrap();
+            for (row, bits) in rows.chunks_mut(stride).enumerate() {
+                if bits[word] & mask != 0 && row != skip {
+                    for (bit, pivot_bit) in bits[word..].iter_mut().zip(&pivot_row[word..]) {
+                        *bit ^= *pivot_bit;
+                    }
+                }
+            }
+        }
+        shared.barrier.wait();
+        i += 1;
+    }
+
+    part
+}
+
+// Swaps two bits of a row of the buffer.
+fn swap_bits(row: &mut [usize], i: usize, j: usize) {
+    let bit_i = row[i / WORDSIZE] >> (i % WORDSIZE) & 1;
+    let bit_j = row[j / WORDSIZE] >> (j % WORDSIZE) & 1;
+
+    if bit_i != bit_j {
+        row[i / WORDSIZE] ^= 1 << (i % WORDSIZE);
+        row[j / WORDSIZE] ^= 1 << (j % WORDSIZE);
+    }
+}
@@ -1,10 +1,81 @@
 pub mod bitvec;
 pub mod bitmat;
 pub mod bitalg;
+pub mod rowbuf;
 pub mod ligsol;
 
 #[cfg(test)]
 mod tests {
+    use super::bitalg::BitGauss;
+    use super::bitmat::BitMat;
+    use super::ligsol::LightsSolver;
+
+    // Gets the next number of splitmix generator.
+    fn random(state: &mut u64) -> u64 {
+        *state = state.wrapping_add(0x9E3779B97F4A7C15);
+        let mut z = *state;
+        z = (z ^ (z >> 30)).wrapping_mul(0xBF58476D1CE4E5B9);
+        z = (z ^ (z >> 27)).wrapping_mul(0x94D049BB133111EB);
+        z ^ (z >> 31)
+    }
+
+    // Creates a random system of `n` equations with `n` variables.
+    fn random_sys(n: usize, seed: u64) -> BitMat {
+        let mut state = seed;
+        let mut sys = BitMat::with_size(n, n + 1);
+
+        for i in 0..n {
+            for j in 0..n + 1 {
+                sys.set(i, j, random(&mut state) & 1 == 1);
+            }
+        }
+
+        sys
+    }
+
+    // Solves the system by `n_threads` and returns the rank, the gaussed
+    // system and the solution.
+    fn solve(mut alg: BitGauss, n_threads: usize) -> (usize, String, Option<String>) {
+        alg.set_threads(n_threads);
+        let solution = alg.solve().map(|solution| solution.to_string());
+
+        (alg.rank(), alg.sys().to_string(), solution)
+    }
+
+    #[test]
+    fn parallel_equals_serial_random() {
+        for &n in [37, 301, 517].iter() {
+            let serial = solve(BitGauss::from(random_sys(n, n as u64)), 1);
+            for n_threads in 2..6 {
+                let parallel = solve(BitGauss::from(random_sys(n, n as u64)), n_threads);
+                assert_eq!(parallel, serial, "{} equations, {} threads", n, n_threads);
+            }
+        }
+    }
+
+    #[test]
+    fn parallel_equals_serial_all_ones() {
+        for &(n_rows, n_cols) in [(5, 5), (7, 7), (13, 11), (25, 25)].iter() {
+            let mut field = BitMat::with_size(n_rows, n_cols);
+            for i in 0..n_rows {
+                field[i].setall(true);
+            }
+
+            let alg = |n_threads| {
+                let mut solver = LightsSolver::from(&field);
+                solver.alg_mut().set_threads(n_threads);
+                let solution = solver.solve().map(|solution| solution.to_string());
+                (solver.alg().rank(), solution)
+            };
+
+            let serial = alg(1);
+            assert!(serial.1.is_some());
+            for n_threads in 2..6 {
+                assert_eq!(alg(n_threads), serial, "{}x{}, {} threads", n_rows, n_cols, n_threads);
+            }
+        }
+    }
+
     #[test]
     fn it_works() {
         let mut vec = super::bitvec::BitVec::new();
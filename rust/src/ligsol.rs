@@ -18,6 +18,52 @@
 use ::bitmat::BitMat;
 use ::bitalg::BitGauss;
 
+/// The cells toggled by a click, specialized at compile time. A stencil is
+/// the band of three cells of the clicked row and the band of the rows above
+/// and below: the bit 0 is the left neighbor, the bit 1 is the column of the
+/// clicked cell, the bit 2 is the right neighbor.
+pub trait Stencil {
+    /// The band of the clicked row.
+    const MIDDLE: u8;
+    /// The band of the rows above and below.
+    const SIDES: u8;
+    /// The edges of field are glued together.
+    const WRAP: bool = false;
+}
+
+/// The cell and its four neighbors by side.
+pub struct Plus;
+
+/// The cell and its four neighbors by corner.
+pub struct Cross;
+
+/// The cell and all of its eight neighbors.
+pub struct King;
+
+/// The plus on the field with glued edges.
+pub struct Torus;
+
+impl Stencil for Plus {
+    const MIDDLE: u8 = 7;
+    const SIDES: u8 = 2;
+}
+
+impl Stencil for Cross {
+    const MIDDLE: u8 = 2;
+    const SIDES: u8 = 5;
+}
+
+impl Stencil for King {
+    const MIDDLE: u8 = 7;
+    const SIDES: u8 = 7;
+}
+
+impl Stencil for Torus {
+    const MIDDLE: u8 = 7;
+    const SIDES: u8 = 2;
+    const WRAP: bool = true;
+}
+
 /// Solves "Lights Off" pazzle.
 pub struct LightsSolver {
     alg: BitGauss,
@@ -28,36 +74,36 @@ pub struct LightsSolver {
 impl LightsSolver {
     /// Creates "Lights Off" solver with specified field.
     pub fn from(field: &BitMat) -> LightsSolver {
+        LightsSolver::with_stencil::<Plus>(field)
+    }
+
+    /// Creates "Lights Off" solver with specified field, where a click toggles
+    /// the cells of stencil `S`.
+    pub fn with_stencil<S: Stencil>(field: &BitMat) -> LightsSolver {
         let n_rows = field.n_rows() as isize;
         let n_cols = field.n_cols() as isize;
         let n = n_rows * n_cols;
         let mut himself: isize;
         let mut neighbor: isize;
+        let mut band: u8;
         let mut sys = BitMat::with_size(n as usize, (n + 1) as usize);
 
         for row in 0..n_rows {
             for col in 0..n_cols {
-                himself = sys_index(row, col, n_rows, n_cols);
-                sys.set(himself as usize, himself as usize, true);
-
-                neighbor = sys_index(row, col + 1, n_rows, n_cols);
-                if neighbor >= 0 {
-                    sys.set(himself as usize, neighbor as usize, true);
-                }
-
-                neighbor = sys_index(row, col - 1, n_rows, n_cols);
-                if neighbor >= 0 {
-                    sys.set(himself as usize, neighbor as usize, true);
-                }
+                himself = sys_index::<S>(row, col, n_rows, n_cols);
 
-                neighbor = sys_index(row + 1, col, n_rows, n_cols);
-                if neighbor >= 0 {
-                    sys.set(neighbor as usize, himself as usize, true);
-                }
+                for i in -1..2 {
+                    band = if i == 0 { S::MIDDLE } else { S::SIDES };
+                    for j in -1..2 {
+                        if band & (1 << (j + 1)) == 0 {
+                            continue;
+                        }
 
-                neighbor = sys_index(row - 1, col, n_rows, n_cols);
-                if neighbor >= 0 {
-                    sys.set(neighbor as usize, himself as usize, true);
+                        neighbor = sys_index::<S>(row + i, col + j, n_rows, n_cols);
+                        if neighbor >= 0 {
+                            sys.set(himself as usize, neighbor as usize, true);
+                        }
+                    }
                 }
 
                 sys.set(himself as usize, n as usize, field.get(row as usize, col as usize));
@@ -78,6 +124,12 @@ impl LightsSolver {
     pub fn alg(&self) -> &BitGauss {
         &self.alg
     }
+
+    /// Returns a mutable `alg` of solver.
+    #[inline]
+    pub fn alg_mut(&mut self) -> &mut BitGauss {
+        &mut self.alg
+    }
     
     /// Finds shortest solution in the system.
     pub fn solve(&mut self) -> Option<BitMat> {
@@ -100,9 +152,17 @@ impl LightsSolver {
 }
 
 /// Calculates of the index in the system matrix by row and column in the field.
-/// Returns -1 if out of field range.
+/// The stencil with `WRAP` glues the edges of the field of at least 3 rows or
+/// columns. Returns -1 if out of field range.
 #[inline]
-fn sys_index(row: isize, col: isize, n_rows: isize, n_cols: isize) -> isize {
+fn sys_index<S: Stencil>(mut row: isize, mut col: isize, n_rows: isize, n_cols: isize) -> isize {
+    if S::WRAP && n_rows >= 3 {
+        row = (row + n_rows) % n_rows;
+    }
+    if S::WRAP && n_cols >= 3 {
+        col = (col + n_cols) % n_cols;
+    }
+
     if 0 <= row && row < n_rows as isize && 0 <= col && col < n_cols as isize {
         n_cols * row + col
     } else {
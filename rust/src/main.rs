@@ -18,19 +18,25 @@ extern crate los;
 use std::env;
 use std::time::SystemTime;
 use los::bitmat::BitMat;
-use los::ligsol::LightsSolver;
+use los::ligsol::{LightsSolver, Plus, Cross, King, Torus};
 
 fn main() {
     let n = env::args().nth(1).unwrap_or("10".to_string()).parse::<usize>().unwrap_or(10);
+    let stencil = env::args().nth(2).unwrap_or("plus".to_string());
     let mut field = BitMat::with_size(n, n);
     
     for i in 0..n {
         field[i].setall(true);
     }
 
-    println!("Usage: los <size>\nSolving {} x {}...\n", n, n);
+    println!("Usage: los <size> [plus|cross|king|torus]\nSolving {} x {}...\n", n, n);
 
-    let mut solver = LightsSolver::from(&field);
+    let mut solver = match stencil.as_str() {
+        "cross" => LightsSolver::with_stencil::<Cross>(&field),
+        "king" => LightsSolver::with_stencil::<King>(&field),
+        "torus" => LightsSolver::with_stencil::<Torus>(&field),
+        _ => LightsSolver::with_stencil::<Plus>(&field),
+    };
     let now = SystemTime::now();
 
     match solver.solve() {
@@ -0,0 +1,166 @@
+// Copyright (C) 2017 - Pavel Nikitin
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+//! A zeroed buffer of words for the rows of a system. A large buffer is
+//! mapped without touching its pages, so every page is placed on the NUMA
+//! node of the thread that writes it first, and it is advised to be backed
+//! by transparent huge pages.
+
+use std::mem;
+use std::ops::{Deref, DerefMut};
+use std::ptr;
+use std::slice;
+
+/// Size of a huge page. A smaller buffer is allocated from the heap.
+pub const HUGE_PAGE: usize = 2 << 20;
+
+#[cfg(all(target_os = "linux", any(target_arch = "x86_64", target_arch = "aarch64")))]
+mod sys {
+    use std::os::raw::{c_int, c_void};
+
+    pub const PROT_READ: c_int = 1;
+    pub const PROT_WRITE: c_int = 2;
+    pub const MAP_PRIVATE: c_int = 2;
+    pub const MAP_ANONYMOUS: c_int = 0x20;
+    pub const MADV_HUGEPAGE: c_int = 14;
+
+    extern "C" {
+        pub fn mmap(addr: *mut c_void, len: usize, prot: c_int, flags: c_int,
+                    fd: c_int, offset: i64) -> *mut c_void;
+        pub fn munmap(addr: *mut c_void, len: usize) -> c_int;
+        pub fn madvise(addr: *mut c_void, len: usize, advice: c_int) -> c_int;
+    }
+}
+
+/// A zeroed buffer of words for the rows of a system.
+pub struct RowBuf {
+    ptr: *mut usize,
+    len: usize,
+    map: *mut u8,
+    map_size: usize,
+    heap: Vec<usize>,
+}
+
+// The buffer owns its words as a `Vec` does.
+unsafe impl Send for RowBuf {}
+unsafe impl Sync for RowBuf {}
+
+impl RowBuf {
+    /// Creates a zeroed buffer of `len` words. The buffer of at least
+    /// `HUGE_PAGE` bytes is mapped, if the system allows.
+    ///
+    /// # Examples
+    ///
+    /// ```
+    /// use los::rowbuf::{RowBuf, HUGE_PAGE};
+    ///
+    /// let mut buf = RowBuf::zeroed(HUGE_PAGE);
+    /// assert!(buf.iter().all(|&word| word == 0));
+    ///
+    /// buf[1] = 7;
+    /// assert_eq!(buf[1], 7);
+    /// ```
+    pub fn zeroed(len: usize) -> RowBuf {
+        if len * mem::size_of::<usize>() >= HUGE_PAGE {
+            if let Some(buf) = RowBuf::mapped(len) {
+                return buf;
+            }
+        }
+
+        RowBuf {
+            ptr: ptr::null_mut(),
+            len: len,
+            map: ptr::null_mut(),
+            map_size: 0,
+            heap: vec![0; len],
+        }
+    }
+
+    /// Checks if the buffer is mapped.
+    #[inline]
+    pub fn is_mapped(&self) -> bool {
+        self.map_size > 0
+    }
+
+    // Maps the buffer aligned by a huge page. The mapping is larger by a huge
+    // page to align the start.
+    #[cfg(all(target_os = "linux", any(target_arch = "x86_64", target_arch = "aarch64")))]
+    fn mapped(len: usize) -> Option<RowBuf> {
+        let size = len * mem::size_of::<usize>();
+        let map_size = size + HUGE_PAGE;
+
+        unsafe {
+            let map = sys::mmap(ptr::null_mut(), map_size, sys::PROT_READ | sys::PROT_WRITE,
+                                sys::MAP_PRIVATE | sys::MAP_ANONYMOUS, -1, 0);
+            if map as isize == -1 {
+                return None;
+            }
+
+            // The advice is only a hint, the buffer works without it
+            let start = (map as usize + HUGE_PAGE - 1) & !(HUGE_PAGE - 1);
+            sys::madvise(start as *mut _, size, sys::MADV_HUGEPAGE);
+
+            Some(RowBuf {
+                ptr: start as *mut usize,
+                len: len,
+                map: map as *mut u8,
+                map_size: map_size,
+                heap: Vec::new(),
+            })
+        }
+    }
+
+    #[cfg(not(all(target_os = "linux", any(target_arch = "x86_64", target_arch = "aarch64"))))]
+    fn mapped(_len: usize) -> Option<RowBuf> {
+        None
+    }
+}
+
+impl Drop for RowBuf {
+    #[cfg(all(target_os = "linux", any(target_arch = "x86_64", target_arch = "aarch64")))]
+    fn drop(&mut self) {
+        if self.is_mapped() {
+            unsafe {
+                sys::munmap(self.map as *mut _, self.map_size);
+            }
+        }
+    }
+
+    #[cfg(not(all(target_os = "linux", any(target_arch = "x86_64", target_arch = "aarch64"))))]
+    fn drop(&mut self) {
+    }
+}
+
+impl Deref for RowBuf {
+    type Target = [usize];
+
+    #[inline]
+    fn deref(&self) -> &[usize] {
+        if !self.is_mapped() {
+            return &self.heap;
+        }
+        unsafe { slice::from_raw_parts(self.ptr, self.len) }
+    }
+}
+
+impl DerefMut for RowBuf {
+    #[inline]
+    fn deref_mut(&mut self) -> &mut [usize] {
+        if !self.is_mapped() {
+            return &mut self.heap;
+        }
+        unsafe { slice::from_raw_parts_mut(self.ptr, self.len) }
+    }
+}
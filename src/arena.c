@@ -0,0 +1,171 @@
+/*
+ * arena.c
+ *
+ * Copyright (C) 2017 - Pavel Nikitin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include "arena.h"
+#include "profile.h"
+
+#define ALIGN_UP(size) (((size) + ARENA_ALIGN - 1) & ~(size_t) (ARENA_ALIGN - 1))
+
+typedef struct _ArenaBlock ArenaBlock;
+
+struct _ArenaBlock
+{
+  ArenaBlock *next;
+  size_t      size;
+  size_t      used;
+};
+
+struct _Arena
+{
+  ArenaBlock *first;
+  ArenaBlock *current;
+  size_t      block_size;
+  size_t      used;
+  size_t      peak;
+};
+
+/*
+ * Creates an empty arena.
+ */
+Arena *
+arena_new (size_t block_size)
+{
+  Arena *arena = calloc (1, sizeof *arena);
+
+  if (arena != NULL)
+    arena->block_size = block_size > 0 ? block_size : ARENA_BLOCK_SIZE;
+
+  return arena;
+}
+
+/*
+ * Allocates memory aligned by ARENA_ALIGN bytes from the arena. The blocks
+ * are used in order, a new block is linked after the current one.
+ */
+void *
+arena_alloc (Arena  *arena,
+             size_t  size)
+{
+  size_t      header = ALIGN_UP (sizeof (ArenaBlock));
+  ArenaBlock *block  = arena->current;
+  void       *data;
+
+  size = ALIGN_UP (size);
+
+  /* Skip the blocks without room */
+  while (block != NULL && block->size - block->used < size)
+    {
+      block = block->next;
+      if (block != NULL)
+        block->used = 0;
+    }
+
+  if (block == NULL)
+    {
+      if (posix_memalign (&data, ARENA_ALIGN,
+                          header + (size > arena->block_size ?
+                                    size : arena->block_size)) != 0)
+        return NULL;
+
+      block = data;
+      block->size = size > arena->block_size ? size : arena->block_size;
+      block->used = 0;
+      PROFILE_COUNT (PROFILE_ALLOCATED, block->size);
+
+      if (arena->current == NULL)
+        {
+          block->next = arena->first;
+          arena->first = block;
+        }
+      else
+        {
+          block->next = arena->current->next;
+          arena->current->next = block;
+        }
+    }
+
+  arena->current = block;
+  data = (char *) block + header + block->used;
+  block->used += size;
+
+  arena->used += size;
+  if (arena->peak < arena->used)
+    arena->peak = arena->used;
+
+  return data;
+}
+
+/*
+ * Allocates memory from the arena and zeros it.
+ */
+void *
+arena_calloc (Arena  *arena,
+              size_t  n_items,
+              size_t  size)
+{
+  void *data = arena_alloc (arena, n_items * size);
+
+  if (data != NULL)
+    memset (data, 0, n_items * size);
+
+  return data;
+}
+
+/*
+ * Releases all memory allocated from the arena, but keeps its blocks.
+ */
+void
+arena_reset (Arena *arena)
+{
+  arena->current = arena->first;
+  if (arena->current != NULL)
+    arena->current->used = 0;
+  arena->used = 0;
+}
+
+/*
+ * Gets the most bytes allocated from the arena between resets.
+ */
+size_t
+arena_peak (Arena *arena)
+{
+  return arena->peak;
+}
+
+/*
+ * Releases an arena with all of its blocks.
+ */
+void
+arena_free (Arena *arena)
+{
+  ArenaBlock *block;
+
+  if (arena == NULL)
+    return;
+
+  while (arena->first != NULL)
+    {
+      block = arena->first;
+      arena->first = block->next;
+      free (block);
+    }
+
+  free (arena);
+}
@@ -0,0 +1,114 @@
+/*
+ * arena.h
+ *
+ * Copyright (C) 2017 - Pavel Nikitin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ARENA_H_
+#define ARENA_H_
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#define ARENA_ALIGN      64
+#define ARENA_BLOCK_SIZE (1 << 20)
+
+/**
+ * SECTION: arena
+ * @title: arena
+ * @short_description: An arena of memory for the temporaries of a solve.
+ *
+ * An arena allocates memory from large blocks by moving a pointer. The
+ * memory is not released one by one, the whole arena is reset between
+ * solves and its blocks are reused, so the repeated solves of the same size
+ * do not call malloc at all.
+ */
+
+typedef struct _Arena Arena;
+
+/**
+ * arena_new:
+ * @block_size: Minimal size of a block in bytes, %ARENA_BLOCK_SIZE if zero
+ *
+ * Creates an empty arena.
+ *
+ * Returns: A new arena or %NULL if out of memory
+ */
+Arena *
+arena_new (size_t block_size);
+
+/**
+ * arena_alloc:
+ * @arena: An arena
+ * @size:  Size in bytes
+ *
+ * Allocates memory aligned by %ARENA_ALIGN bytes from the arena.
+ *
+ * Returns: The memory or %NULL if out of memory
+ */
+void *
+arena_alloc (Arena  *arena,
+             size_t  size);
+
+/**
+ * arena_calloc:
+ * @arena:   An arena
+ * @n_items: Number of items
+ * @size:    Size of item in bytes
+ *
+ * Allocates memory from the arena and zeros it.
+ *
+ * Returns: The memory or %NULL if out of memory
+ */
+void *
+arena_calloc (Arena  *arena,
+              size_t  n_items,
+              size_t  size);
+
+/**
+ * arena_reset:
+ * @arena: An arena
+ *
+ * Releases all memory allocated from the arena, but keeps its blocks for the
+ * next allocations.
+ */
+void
+arena_reset (Arena *arena);
+
+/**
+ * arena_peak:
+ * @arena: An arena
+ *
+ * Gets the high-water mark of the arena: the most bytes allocated from it
+ * between two resets since it is created, counted with the alignment. The
+ * blocks of the arena may hold more, since a block is not split between
+ * allocations.
+ *
+ * Returns: Size in bytes
+ */
+size_t
+arena_peak (Arena *arena);
+
+/**
+ * arena_free:
+ * @arena: An arena
+ *
+ * Releases an arena with all of its blocks.
+ */
+void
+arena_free (Arena *arena);
+
+#endif
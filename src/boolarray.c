@@ -17,7 +17,18 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <stdint.h>
 #include "boolarray.h"
+#include "profile.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/* The mask of the lowest @n bits, @n up to WORD_BITS */
+#define LOW_MASK(n) ((n) >= WORD_BITS ? ~(word_t) 0 : ((word_t) 1 << (n)) - 1)
 
 /*
  * Creates a new boolean array and initializes it by zeros.
@@ -25,9 +36,24 @@
 word_t *
 bool_array_new (int n_bools)
 {
+  PROFILE_COUNT (PROFILE_ALLOCATED, bool_array_n_words (n_bools) * sizeof (word_t));
+
   return calloc (bool_array_n_words (n_bools), sizeof (word_t));
 }
 
+/*
+ * Creates a new boolean array in the arena and initializes it by zeros.
+ */
+word_t *
+bool_array_new_in (Arena *arena,
+                   int    n_bools)
+{
+  if (arena == NULL)
+    return bool_array_new (n_bools);
+
+  return arena_calloc (arena, bool_array_n_words (n_bools), sizeof (word_t));
+}
+
 /*
  * Creates a new boolean array from string.
  */
@@ -36,25 +62,177 @@ bool_array_new_string (const char *string,
                        int        *n_bools)
 {
   word_t *array = NULL;
-  int     i;
-  
+
   *n_bools = strlen (string);
-  if (string[*n_bools - 1] == '\n')
+  if (*n_bools > 0 && string[*n_bools - 1] == '\n')
     (*n_bools)--; 
   
   if (*n_bools > 0)
     {
-      array = malloc (*n_bools * sizeof (word_t));
-      if (array != NULL)
+      array = bool_array_new (*n_bools);
+      if (array != NULL && !bool_array_parse (array, string, *n_bools))
         {
-          for (i = 0; i < *n_bools; i++)
-            bool_array_set (array, i, string[i] == '1');
+          free (array);
+          array = NULL;
         }
     }
 
   return array;
 }
 
+/*
+ * Parses up to one word of symbols. The symbols are compared by 32 or 16 at
+ * once, the comparison masks give the bits of word.
+ */
+static bool
+parse_word (const char *string,
+            int         n_bools,
+            word_t     *word)
+{
+  word_t ones  = 0;
+  bool   valid = true;
+  int    i     = 0;
+
+#if defined(__AVX2__)
+  __m256i chars, one, zero;
+
+  for (; i + 32 <= n_bools; i += 32)
+    {
+      chars = _mm256_loadu_si256 ((const __m256i *) (string + i));
+      one   = _mm256_cmpeq_epi8 (chars, _mm256_set1_epi8 ('1'));
+      zero  = _mm256_cmpeq_epi8 (chars, _mm256_set1_epi8 ('0'));
+      ones |= (word_t) (unsigned) _mm256_movemask_epi8 (one) << i;
+      valid &= (unsigned) _mm256_movemask_epi8 (_mm256_or_si256 (one, zero))
+               == 0xFFFFFFFFU;
+    }
+#elif defined(__SSE2__)
+  __m128i chars, one, zero;
+
+  for (; i + 16 <= n_bools; i += 16)
+    {
+      chars = _mm_loadu_si128 ((const __m128i *) (string + i));
+      one   = _mm_cmpeq_epi8 (chars, _mm_set1_epi8 ('1'));
+      zero  = _mm_cmpeq_epi8 (chars, _mm_set1_epi8 ('0'));
+      ones |= (word_t) _mm_movemask_epi8 (one) << i;
+      valid &= _mm_movemask_epi8 (_mm_or_si128 (one, zero)) == 0xFFFF;
+    }
+#endif
+
+  for (; i < n_bools; i++)
+    {
+      ones |= (word_t) (string[i] == '1') << i;
+      valid &= string[i] == '0' || string[i] == '1';
+    }
+
+  *word = ones;
+
+  return valid;
+}
+
+/*
+ * Parses a string to the boolean array by whole words.
+ */
+bool
+bool_array_parse (word_t     *array,
+                  const char *string,
+                  int         n_bools)
+{
+  int  n_full = n_bools / WORD_BITS;
+  bool valid  = true;
+  int  i;
+
+  for (i = 0; i < n_full; i++)
+    valid &= parse_word (string + i * WORD_BITS, WORD_BITS, &array[i]);
+
+  if (n_full * WORD_BITS < n_bools)
+    valid &= parse_word (string + n_full * WORD_BITS,
+                         n_bools - n_full * WORD_BITS, &array[n_full]);
+
+  return valid;
+}
+
+/*
+ * Reverses the bits in every byte of word and converts the bytes of
+ * word to the host order.
+ */
+static word_t
+reverse_byte_bits (word_t word)
+{
+  word = ((word >> 1) & (word_t) 0x5555555555555555ULL) |
+         ((word & (word_t) 0x5555555555555555ULL) << 1);
+  word = ((word >> 2) & (word_t) 0x3333333333333333ULL) |
+         ((word & (word_t) 0x3333333333333333ULL) << 2);
+  word = ((word >> 4) & (word_t) 0x0F0F0F0F0F0F0F0FULL) |
+         ((word & (word_t) 0x0F0F0F0F0F0F0F0FULL) << 4);
+
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__ && WORD_BITS == 64
+  word = __builtin_bswap64 (word);
+#elif __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  word = __builtin_bswap32 (word);
+#endif
+
+  return word;
+}
+
+/*
+ * Unpacks booleans from bytes in the most significant bit first order.
+ */
+void
+bool_array_unpack_msb (word_t              *array,
+                       const unsigned char *bytes,
+                       int                  n_bools)
+{
+  int    n_bytes = (n_bools + 7) / 8;
+  int    n_full  = n_bytes / sizeof *array;
+  int    i;
+  word_t word;
+
+  for (i = 0; i < n_full; i++)
+    {
+      memcpy (&word, bytes + i * sizeof word, sizeof word);
+      array[i] = reverse_byte_bits (word);
+    }
+
+  if (n_full * (int) sizeof word < n_bytes)
+    {
+      word = 0;
+      memcpy (&word, bytes + n_full * sizeof word,
+              n_bytes - n_full * sizeof word);
+      array[n_full] = reverse_byte_bits (word);
+    }
+
+  /* Zero the padding bits of the last byte */
+  if (BIT_INDEX (n_bools) != 0)
+    array[ARRAY_INDEX (n_bools)] &= BIT_MASK (n_bools) - 1;
+}
+
+/*
+ * Packs booleans to bytes in the most significant bit first order.
+ */
+void
+bool_array_pack_msb (const word_t  *array,
+                     unsigned char *bytes,
+                     int            n_bools)
+{
+  int    n_bytes = (n_bools + 7) / 8;
+  int    n_full  = n_bytes / sizeof *array;
+  int    i;
+  word_t word;
+
+  for (i = 0; i < n_full; i++)
+    {
+      word = reverse_byte_bits (array[i]);
+      memcpy (bytes + i * sizeof word, &word, sizeof word);
+    }
+
+  if (n_full * (int) sizeof word < n_bytes)
+    {
+      word = reverse_byte_bits (array[n_full]);
+      memcpy (bytes + n_full * sizeof word, &word,
+              n_bytes - n_full * sizeof word);
+    }
+}
+
 /*
  * Gets boolean by its index in the boolean array.
  */
@@ -107,19 +285,11 @@ int
 bool_array_count (word_t *array,
                   int     n_words)
 {
-  int    count = 0;
-  int    i;
-  word_t word;
+  int count = 0;
+  int i;
 
   for (i = 0; i < n_words; i++)
-    {
-      word = array[i];
-      while (word)
-        {
-          word &= (word - 1);
-          count++;
-        }
-    }
+    count += __builtin_popcountl (array[i]);
 
   return count;
 }
@@ -143,16 +313,334 @@ char *
 bool_array_string (word_t *array,
                    int     n_bools)
 {
-  int   i;
   char *str = malloc (n_bools + 1);
 
   if (str != NULL)
     {
-      for (i = 0; i < n_bools; i++)
-        str[i] = bool_array_get (array, i) ? '1' : '0';
-
+      bool_array_to_ascii (array, str, n_bools);
       str[n_bools] = '\0';
     }
 
   return str;
 }
+
+/*
+ * Converts 8 booleans to symbols: the byte is broadcast to all bytes of
+ * word, every byte keeps its own bit, which is turned to '0' or '1'.
+ */
+static uint64_t
+byte_to_ascii (unsigned byte)
+{
+  uint64_t bytes = (uint64_t) byte * 0x0101010101010101ULL;
+
+  bytes &= 0x8040201008040201ULL;
+  bytes = ((bytes + 0x7F7F7F7F7F7F7F7FULL) & 0x8080808080808080ULL) >> 7;
+
+  return bytes + 0x3030303030303030ULL;
+}
+
+/*
+ * Converts booleans to '0' and '1' symbols by a SIMD register at once.
+ */
+void
+bool_array_to_ascii (const word_t *array,
+                     char         *string,
+                     int           n_bools)
+{
+  int      i = 0;
+  uint64_t bytes;
+
+#if defined(__AVX2__)
+  const __m256i spread = _mm256_set_epi8 (3, 3, 3, 3, 3, 3, 3, 3,
+                                          2, 2, 2, 2, 2, 2, 2, 2,
+                                          1, 1, 1, 1, 1, 1, 1, 1,
+                                          0, 0, 0, 0, 0, 0, 0, 0);
+  const __m256i bits   = _mm256_set1_epi64x (0x8040201008040201LL);
+  __m256i       chars;
+
+  /* Every byte of 32 booleans is spread to 8 bytes, which keep own bits */
+  for (; i + 32 <= n_bools; i += 32)
+    {
+      chars = _mm256_set1_epi32 ((int) (array[ARRAY_INDEX (i)] >> BIT_INDEX (i)));
+      chars = _mm256_shuffle_epi8 (chars, spread);
+      chars = _mm256_cmpeq_epi8 (_mm256_and_si256 (chars, bits), bits);
+      chars = _mm256_sub_epi8 (_mm256_set1_epi8 ('0'), chars);
+      _mm256_storeu_si256 ((__m256i *) (string + i), chars);
+    }
+#elif defined(__SSE2__)
+  const __m128i bits = _mm_set1_epi64x (0x8040201008040201LL);
+  __m128i       chars;
+
+  /* Every byte of 16 booleans is spread to 8 bytes by unpacking */
+  for (; i + 16 <= n_bools; i += 16)
+    {
+      chars = _mm_cvtsi32_si128 ((array[ARRAY_INDEX (i)] >> BIT_INDEX (i)) & 0xFFFF);
+      chars = _mm_unpacklo_epi8 (chars, chars);
+      chars = _mm_unpacklo_epi16 (chars, chars);
+      chars = _mm_unpacklo_epi32 (chars, chars);
+      chars = _mm_cmpeq_epi8 (_mm_and_si128 (chars, bits), bits);
+      chars = _mm_sub_epi8 (_mm_set1_epi8 ('0'), chars);
+      _mm_storeu_si128 ((__m128i *) (string + i), chars);
+    }
+#endif
+
+  for (; i + 8 <= n_bools; i += 8)
+    {
+      bytes = byte_to_ascii ((array[ARRAY_INDEX (i)] >> BIT_INDEX (i)) & 0xFF);
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+      bytes = __builtin_bswap64 (bytes);
+#endif
+      memcpy (string + i, &bytes, 8);
+    }
+
+  for (; i < n_bools; i++)
+    string[i] = bool_array_get ((word_t *) array, i) ? '1' : '0';
+}
+
+/*
+ * Applies a word operation to the booleans [start, end) of arrays. The first
+ * and the last words are merged by masks.
+ */
+#define BIT_RANGE_OP(dst, src, start, end, OP)                               \
+  do                                                                         \
+    {                                                                        \
+      int    first_ = ARRAY_INDEX (start);                                   \
+      int    last_  = ARRAY_INDEX ((end) - 1);                               \
+      word_t head_  = ~LOW_MASK (BIT_INDEX (start));                         \
+      word_t tail_  = LOW_MASK (BIT_INDEX ((end) - 1) + 1);                  \
+      word_t mask_;                                                          \
+      int    k_;                                                             \
+                                                                             \
+      if ((start) >= (end))                                                  \
+        break;                                                               \
+                                                                             \
+      for (k_ = first_; k_ <= last_; k_++)                                   \
+        {                                                                    \
+          mask_ = ~(word_t) 0;                                               \
+          if (k_ == first_)                                                  \
+            mask_ &= head_;                                                  \
+          if (k_ == last_)                                                   \
+            mask_ &= tail_;                                                  \
+          OP (dst[k_], src[k_], mask_);                                      \
+        }                                                                    \
+    }                                                                        \
+  while (0)
+
+#define XOR_OP(d, s, m)  ((d) ^= (s) & (m))
+#define AND_OP(d, s, m)  ((d) &= (s) | ~(m))
+#define OR_OP(d, s, m)   ((d) |= (s) & (m))
+#define COPY_OP(d, s, m) ((d) = ((d) & ~(m)) | ((s) & (m)))
+
+/*
+ * Xors the booleans [start, end) of src into dst by whole words.
+ */
+void
+bool_array_xor_bits (word_t       *dst,
+                     const word_t *src,
+                     int           start,
+                     int           end)
+{
+  BIT_RANGE_OP (dst, src, start, end, XOR_OP);
+}
+
+/*
+ * Ands the booleans [start, end) of src into dst by whole words.
+ */
+void
+bool_array_and_bits (word_t       *dst,
+                     const word_t *src,
+                     int           start,
+                     int           end)
+{
+  BIT_RANGE_OP (dst, src, start, end, AND_OP);
+}
+
+/*
+ * Ors the booleans [start, end) of src into dst by whole words.
+ */
+void
+bool_array_or_bits (word_t       *dst,
+                    const word_t *src,
+                    int           start,
+                    int           end)
+{
+  BIT_RANGE_OP (dst, src, start, end, OR_OP);
+}
+
+/*
+ * Copies the booleans [start, end) of src into dst by whole words.
+ */
+void
+bool_array_copy_bits (word_t       *dst,
+                      const word_t *src,
+                      int           start,
+                      int           end)
+{
+  BIT_RANGE_OP (dst, src, start, end, COPY_OP);
+}
+
+/*
+ * Sets the booleans [start, end) to ones by whole words.
+ */
+void
+bool_array_set_bits (word_t *array,
+                     int     start,
+                     int     end)
+{
+  int k;
+
+  if (start >= end)
+    return;
+
+  if (ARRAY_INDEX (start) == ARRAY_INDEX (end - 1))
+    {
+      array[ARRAY_INDEX (start)] |= LOW_MASK (end - start) << BIT_INDEX (start);
+      return;
+    }
+
+  array[ARRAY_INDEX (start)] |= ~(word_t) 0 << BIT_INDEX (start);
+  for (k = ARRAY_INDEX (start) + 1; k < ARRAY_INDEX (end - 1); k++)
+    array[k] = ~(word_t) 0;
+  array[ARRAY_INDEX (end - 1)] |= LOW_MASK (BIT_INDEX (end - 1) + 1);
+}
+
+/*
+ * Finds the next one in the boolean array.
+ */
+int
+bool_array_next (const word_t *array,
+                 int           n_bools,
+                 int           index)
+{
+  int    n_words = bool_array_n_words (n_bools);
+  int    k       = ARRAY_INDEX (index);
+  word_t word;
+
+  if (index >= n_bools)
+    return -1;
+
+  word = array[k] & ~LOW_MASK (BIT_INDEX (index));
+  while (word == 0)
+    {
+      if (++k >= n_words)
+        return -1;
+      word = array[k];
+    }
+
+  index = k * WORD_BITS + __builtin_ctzl (word);
+
+  return index < n_bools ? index : -1;
+}
+
+/*
+ * Finds the next zero in the boolean array.
+ */
+int
+bool_array_next_zero (const word_t *array,
+                      int           n_bools,
+                      int           index)
+{
+  int    n_words = bool_array_n_words (n_bools);
+  int    k       = ARRAY_INDEX (index);
+  word_t word;
+
+  if (index >= n_bools)
+    return n_bools;
+
+  word = ~array[k] & ~LOW_MASK (BIT_INDEX (index));
+  while (word == 0)
+    {
+      if (++k >= n_words)
+        return n_bools;
+      word = ~array[k];
+    }
+
+  index = k * WORD_BITS + __builtin_ctzl (word);
+
+  return index < n_bools ? index : n_bools;
+}
+
+/*
+ * Extracts booleans across the boundary of words.
+ */
+word_t
+bool_array_extract (const word_t *array,
+                    int           index,
+                    int           n_bits)
+{
+  int    shift = BIT_INDEX (index);
+  word_t bits  = array[ARRAY_INDEX (index)] >> shift;
+
+  if (shift > 0 && shift + n_bits > WORD_BITS)
+    bits |= array[ARRAY_INDEX (index) + 1] << (WORD_BITS - shift);
+
+  return bits & LOW_MASK (n_bits);
+}
+
+/*
+ * Replaces booleans across the boundary of words.
+ */
+void
+bool_array_insert (word_t *array,
+                   int     index,
+                   int     n_bits,
+                   word_t  bits)
+{
+  int    shift = BIT_INDEX (index);
+  int    k     = ARRAY_INDEX (index);
+  word_t mask  = LOW_MASK (n_bits);
+
+  bits &= mask;
+  array[k] = (array[k] & ~(mask << shift)) | (bits << shift);
+
+  if (shift > 0 && shift + n_bits > WORD_BITS)
+    {
+      array[k + 1] &= ~(mask >> (WORD_BITS - shift));
+      array[k + 1] |= bits >> (WORD_BITS - shift);
+    }
+}
+
+/*
+ * Clears the booleans [start, end) to zeros by whole words.
+ */
+void
+bool_array_clear_bits (word_t *array,
+                       int     start,
+                       int     end)
+{
+  int k;
+
+  if (start >= end)
+    return;
+
+  if (ARRAY_INDEX (start) == ARRAY_INDEX (end - 1))
+    {
+      array[ARRAY_INDEX (start)] &= ~(LOW_MASK (end - start) << BIT_INDEX (start));
+      return;
+    }
+
+  array[ARRAY_INDEX (start)] &= LOW_MASK (BIT_INDEX (start));
+  for (k = ARRAY_INDEX (start) + 1; k < ARRAY_INDEX (end - 1); k++)
+    array[k] = 0;
+  array[ARRAY_INDEX (end - 1)] &= ~LOW_MASK (BIT_INDEX (end - 1) + 1);
+}
+
+/*
+ * Copies booleans to another index by whole words.
+ */
+void
+bool_array_move_bits (word_t       *dst,
+                      int           dst_index,
+                      const word_t *src,
+                      int           src_index,
+                      int           n_bools)
+{
+  int i, width;
+
+  for (i = 0; i < n_bools; i += WORD_BITS)
+    {
+      width = n_bools - i < WORD_BITS ? n_bools - i : WORD_BITS;
+      bool_array_insert (dst, dst_index + i, width,
+                         bool_array_extract (src, src_index + i, width));
+    }
+}
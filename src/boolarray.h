@@ -22,6 +22,7 @@
 #include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
+#include "arena.h"
 
 /**
  * SECTION: boolarray
@@ -34,12 +35,14 @@
 typedef size_t word_t;
 
 #if __WORDSIZE == 64
-#define ARRAY_INDEX(index) (index >> 6)
-#define BIT_INDEX(index)   (index &  63)
+#define WORD_BITS          64
+#define ARRAY_INDEX(index) ((index) >> 6)
+#define BIT_INDEX(index)   ((index) &  63)
 #define BIT_MASK(index)    (1UL   << BIT_INDEX(index))
 #else
-#define ARRAY_INDEX(index) (index >> 5)
-#define BIT_INDEX(index)   (index &  31)
+#define WORD_BITS          32
+#define ARRAY_INDEX(index) ((index) >> 5)
+#define BIT_INDEX(index)   ((index) &  31)
 #define BIT_MASK(index)    (1U    << BIT_INDEX(index))
 #endif
 
@@ -54,19 +57,78 @@ typedef size_t word_t;
 word_t *
 bool_array_new (int n_bools);
 
+/**
+ * bool_array_new_in:
+ * @arena:   An arena to allocate from or %NULL to allocate from heap
+ * @n_bools: Number of booleans in the array
+ *
+ * Creates a new boolean array in the arena and initializes it by zeros. The
+ * array is released with the arena.
+ *
+ * Returns: Boolean array
+ */
+word_t *
+bool_array_new_in (Arena *arena,
+                   int    n_bools);
+
 /**
  * bool_array_new_string:
  * @string:         Source string
  * @n_bools: (out): Number of booleans in the array
  * 
- * Creates a new boolean array from string.
+ * Creates a new boolean array from string of '0' and '1' symbols. A trailing
+ * new line is ignored.
  * 
- * Returns: Boolean array
+ * Returns: Boolean array or %NULL if the string has other symbols
  */
 word_t *
 bool_array_new_string (const char *string,
                        int        *n_bools);
 
+/**
+ * bool_array_parse:
+ * @array:   Boolean array of @n_bools booleans at least
+ * @string:  Source string of '0' and '1' symbols, not zero terminated
+ * @n_bools: Number of symbols to parse
+ *
+ * Parses a string to the boolean array by whole words. The bits of the last
+ * word beyond @n_bools are zeroed.
+ *
+ * Returns: %FALSE if the string has symbols other than '0' and '1'
+ */
+bool
+bool_array_parse (word_t     *array,
+                  const char *string,
+                  int         n_bools);
+
+/**
+ * bool_array_unpack_msb:
+ * @array:   Boolean array of @n_bools booleans at least
+ * @bytes:   Source bytes, (@n_bools + 7) / 8
+ * @n_bools: Number of booleans
+ *
+ * Unpacks booleans from bytes in the most significant bit first order, as in
+ * rows of PBM image. The bits are reversed by whole words.
+ */
+void
+bool_array_unpack_msb (word_t              *array,
+                       const unsigned char *bytes,
+                       int                  n_bools);
+
+/**
+ * bool_array_pack_msb:
+ * @array:   Boolean array
+ * @bytes:   Destination bytes, (@n_bools + 7) / 8
+ * @n_bools: Number of booleans
+ *
+ * Packs booleans to bytes in the most significant bit first order, as in rows
+ * of PBM image. The unused bits of the last byte are zero.
+ */
+void
+bool_array_pack_msb (const word_t  *array,
+                     unsigned char *bytes,
+                     int            n_bools);
+
 /**
  * bool_array_get:
  * @array: Boolean array
@@ -122,7 +184,8 @@ bool_array_n_words (int n_bools);
  * @array:   Boolean array
  * @n_words: Number of processor words in the boolean array
  * 
- * Counts number of ones in the boolean array by number of processor words.
+ * Counts number of ones in the boolean array by number of processor words
+ * with the population count instruction.
  * 
  * Returns:  Number of ones in the boolean array
  */
@@ -154,4 +217,184 @@ char *
 bool_array_string (word_t *array,
                    int     n_bools);
 
+/**
+ * bool_array_to_ascii:
+ * @array:   Boolean array
+ * @string:  Destination of @n_bools symbols, not zero terminated
+ * @n_bools: Number of booleans
+ *
+ * Converts booleans to '0' and '1' symbols by a SIMD register at once.
+ */
+void
+bool_array_to_ascii (const word_t *array,
+                     char         *string,
+                     int           n_bools);
+
+/**
+ * bool_array_xor_bits:
+ * @dst:   Destination boolean array
+ * @src:   Source boolean array
+ * @start: Index of the first boolean
+ * @end:   Index after the last boolean
+ *
+ * Xors the booleans [@start, @end) of @src into @dst by whole words.
+ */
+void
+bool_array_xor_bits (word_t       *dst,
+                     const word_t *src,
+                     int           start,
+                     int           end);
+
+/**
+ * bool_array_and_bits:
+ * @dst:   Destination boolean array
+ * @src:   Source boolean array
+ * @start: Index of the first boolean
+ * @end:   Index after the last boolean
+ *
+ * Ands the booleans [@start, @end) of @src into @dst by whole words.
+ */
+void
+bool_array_and_bits (word_t       *dst,
+                     const word_t *src,
+                     int           start,
+                     int           end);
+
+/**
+ * bool_array_or_bits:
+ * @dst:   Destination boolean array
+ * @src:   Source boolean array
+ * @start: Index of the first boolean
+ * @end:   Index after the last boolean
+ *
+ * Ors the booleans [@start, @end) of @src into @dst by whole words.
+ */
+void
+bool_array_or_bits (word_t       *dst,
+                    const word_t *src,
+                    int           start,
+                    int           end);
+
+/**
+ * bool_array_copy_bits:
+ * @dst:   Destination boolean array
+ * @src:   Source boolean array
+ * @start: Index of the first boolean
+ * @end:   Index after the last boolean
+ *
+ * Copies the booleans [@start, @end) of @src into @dst by whole words.
+ */
+void
+bool_array_copy_bits (word_t       *dst,
+                      const word_t *src,
+                      int           start,
+                      int           end);
+
+/**
+ * bool_array_set_bits:
+ * @array: Boolean array
+ * @start: Index of the first boolean
+ * @end:   Index after the last boolean
+ *
+ * Sets the booleans [@start, @end) to ones by whole words.
+ */
+void
+bool_array_set_bits (word_t *array,
+                     int     start,
+                     int     end);
+
+/**
+ * bool_array_clear_bits:
+ * @array: Boolean array
+ * @start: Index of the first boolean
+ * @end:   Index after the last boolean
+ *
+ * Clears the booleans [@start, @end) to zeros by whole words.
+ */
+void
+bool_array_clear_bits (word_t *array,
+                       int     start,
+                       int     end);
+
+/**
+ * bool_array_next:
+ * @array:   Boolean array
+ * @n_bools: Number of booleans in the array
+ * @index:   Index to start the search from
+ *
+ * Finds the next one in the boolean array by counting trailing zeros of
+ * words.
+ *
+ * Returns: Index of the first one at @index or after, -1 if there is no one
+ */
+int
+bool_array_next (const word_t *array,
+                 int           n_bools,
+                 int           index);
+
+/**
+ * bool_array_next_zero:
+ * @array:   Boolean array
+ * @n_bools: Number of booleans in the array
+ * @index:   Index to start the search from
+ *
+ * Finds the next zero in the boolean array by counting trailing ones of
+ * words.
+ *
+ * Returns: Index of the first zero at @index or after, @n_bools if there is
+ * no zero
+ */
+int
+bool_array_next_zero (const word_t *array,
+                      int           n_bools,
+                      int           index);
+
+/**
+ * bool_array_extract:
+ * @array:  Boolean array
+ * @index:  Index of the first boolean
+ * @n_bits: Number of booleans, up to %WORD_BITS
+ *
+ * Extracts booleans across the boundary of words.
+ *
+ * Returns: The booleans as the lowest bits of a word
+ */
+word_t
+bool_array_extract (const word_t *array,
+                    int           index,
+                    int           n_bits);
+
+/**
+ * bool_array_insert:
+ * @array:  Boolean array
+ * @index:  Index of the first boolean
+ * @n_bits: Number of booleans, up to %WORD_BITS
+ * @bits:   The booleans as the lowest bits of a word
+ *
+ * Replaces booleans across the boundary of words.
+ */
+void
+bool_array_insert (word_t *array,
+                   int     index,
+                   int     n_bits,
+                   word_t  bits);
+
+/**
+ * bool_array_move_bits:
+ * @dst:       Destination boolean array
+ * @dst_index: Index of the first boolean in @dst
+ * @src:       Source boolean array
+ * @src_index: Index of the first boolean in @src
+ * @n_bools:   Number of booleans
+ *
+ * Copies booleans to another index by extracting and inserting whole words.
+ * The arrays must be different.
+ */
+void
+bool_array_move_bits (word_t       *dst,
+                      int           dst_index,
+                      const word_t *src,
+                      int           src_index,
+                      int           n_bools);
+
 #endif
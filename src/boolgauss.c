@@ -18,58 +18,670 @@
  */
 
 #include "boolgauss.h"
+#include "boolmul.h"
+#include "profile.h"
 #include "progress.h"
 
+/* Number of candidates between the checks of progress in the search */
+#define SEARCH_BLOCK_SIZE ((word_t) 1 << 16)
+
+/* Least number of pivot columns of a dense system to eliminate recursively */
+#define RECURSIVE_MIN_PIVOTS 1024
+
+/* A system is dense, if a row has ones farther from the main diagonal than
+   this part of the pivot columns */
+#define DENSE_BAND_DIVISOR 4
+
+/* Number of pivots of a triangle solved without the multiplication */
+#define TRIANGLE_BASE (2 * WORD_BITS)
+
 /*
- * Gausses system with @n_rows logical equations and @n_cols-1 variables.
+ * Swaps booleans of two rows in the columns of tile.
  */
-int
-bool_gauss (word_t **system,
+static void
+swap_tile_rows (word_t **tile,
+                int      n_cols,
+                int      row1,
+                int      row2)
+{
+  bool bit;
+  int  b;
+
+  for (b = 0; b < n_cols; b++)
+    {
+      bit = bool_array_get (tile[b], row1);
+      bool_array_set (tile[b], row1, bool_array_get (tile[b], row2));
+      bool_array_set (tile[b], row2, bit);
+    }
+}
+
+/*
+ * Swaps two columns of the system in every row.
+ */
+static void
+swap_columns (word_t **system,
+              int      n_rows,
+              int      col1,
+              int      col2)
+{
+  bool differ;
+  int  j;
+
+  for (j = 0; j < n_rows; j++)
+    {
+      differ = bool_array_get (system[j], col1) !=
+               bool_array_get (system[j], col2);
+      bool_array_xor (system[j], col1, differ);
+      bool_array_xor (system[j], col2, differ);
+    }
+}
+
+/*
+ * Reduces the echelon system, so the pivot columns become the identity.
+ * The rows are reduced from the last pivot up. The pivot columns of the
+ * reduced rows below are the identity, so a row is xored only in the
+ * columns after the pivots and the bit of pivot is cleared by itself.
+ */
+static bool
+back_substitute (word_t  **system,
+                 int       rank,
+                 int       n_cols,
+                 Progress *progress)
+{
+  int n_words = bool_array_n_words (n_cols) - ARRAY_INDEX (rank);
+  int i, j;
+
+  progress_stage (progress, "Substituting back", rank);
+  for (i = rank - 1; i >= 0; i--)
+    {
+      for (j = bool_array_next (system[i], rank, i + 1); j >= 0;
+           j = bool_array_next (system[i], rank, j + 1))
+        {
+          /* A skipped column has no pivot row */
+          if (!bool_array_get (system[j], j))
+            continue;
+
+          bool_array_xor (system[i], j, true);
+          bool_array_xor_bits (system[i], system[j], rank, n_cols);
+          PROFILE_COUNT (PROFILE_ROW_XORS, 1);
+          PROFILE_COUNT (PROFILE_WORDS, n_words);
+        }
+
+      progress_step (progress, 1);
+      if (i % WORD_BITS == 0 && progress_cancelled (progress))
+        return false;
+    }
+
+  return true;
+}
+
+/*
+ * Checks whether the left square part of system has ones far from the main
+ * diagonal. The echelon form of such system fills in, so the banded
+ * elimination does the cubic work of xoring whole rows.
+ */
+static bool
+is_dense (word_t **system,
+          int      n_rows,
+          int      n_pivots)
+{
+  int band = n_pivots / DENSE_BAND_DIVISOR;
+  int j;
+
+  for (j = 0; j < n_rows; j++)
+    {
+      if (j > band && bool_array_next (system[j], j - band, 0) >= 0)
+        return true;
+      if (j + band + 1 < n_pivots &&
+          bool_array_next (system[j], n_pivots, j + band + 1) >= 0)
+        return true;
+    }
+
+  return false;
+}
+
+/*
+ * Takes a block of the rows of system.
+ */
+static BoolBlock
+make_block (word_t **rows,
+            int      col,
             int      n_rows,
-            int      n_cols,
-            bool     progress_sign)
+            int      n_cols)
+{
+  BoolBlock block;
+
+  block.rows = rows;
+  block.col = col;
+  block.n_rows = n_rows;
+  block.n_cols = n_cols;
+
+  return block;
+}
+
+/*
+ * Moves the columns [middle, end) before the columns [start, middle).
+ */
+static bool
+rotate_columns (word_t **system,
+                int      n_rows,
+                int     *order,
+                int      start,
+                int      middle,
+                int      end)
+{
+  word_t *save  = bool_array_new (end - start);
+  int    *moved = malloc ((middle - start) * sizeof *moved);
+  int     j;
+
+  if (save == NULL || moved == NULL)
+    {
+      free (save);
+      free (moved);
+      return false;
+    }
+
+  for (j = 0; j < n_rows; j++)
+    {
+      bool_array_move_bits (save, 0, system[j], start, end - start);
+      bool_array_move_bits (system[j], start, save, middle - start,
+                            end - middle);
+      bool_array_move_bits (system[j], start + end - middle, save, 0,
+                            middle - start);
+    }
+
+  memcpy (moved, order + start, (middle - start) * sizeof *moved);
+  memmove (order + start, order + middle, (end - middle) * sizeof *order);
+  memcpy (order + start + end - middle, moved, (middle - start) * sizeof *moved);
+
+  free (save);
+  free (moved);
+
+  return true;
+}
+
+/*
+ * Solves the unit lower triangle of @rank pivot rows from @row and pivot
+ * columns from @col for the columns [start, end) of the same rows. The
+ * triangle is halved, so the lower rows are updated by a multiplication.
+ */
+static bool
+solve_lower (word_t **system,
+             int      row,
+             int      col,
+             int      rank,
+             int      start,
+             int      end)
+{
+  BoolBlock l21, x1, x2;
+  int       half, i, j;
+
+  if (rank <= TRIANGLE_BASE)
+    {
+      for (i = 1; i < rank; i++)
+        {
+          for (j = bool_array_next (system[row + i], col + i, col); j >= 0;
+               j = bool_array_next (system[row + i], col + i, j + 1))
+            bool_array_xor_bits (system[row + i], system[row + j - col],
+                                 start, end);
+        }
+      return true;
+    }
+
+  half = (rank / 2 + WORD_BITS - 1) / WORD_BITS * WORD_BITS;
+  l21 = make_block (system + row + half, col, rank - half, half);
+  x1 = make_block (system + row, start, half, end - start);
+  x2 = make_block (system + row + half, start, rank - half, end - start);
+
+  return solve_lower (system, row, col, half, start, end) &&
+         bool_matrix_mul_add (&x2, &l21, &x1) &&
+         solve_lower (system, row + half, col + half, rank - half, start, end);
+}
+
+/*
+ * Solves the unit upper triangle of @rank pivot rows from @row and pivot
+ * columns from @col for the columns [start, end) of the same rows.
+ */
+static bool
+solve_upper (word_t **system,
+             int      row,
+             int      col,
+             int      rank,
+             int      start,
+             int      end)
+{
+  BoolBlock u12, x1, x2;
+  int       half, i, j;
+
+  if (rank <= TRIANGLE_BASE)
+    {
+      for (i = rank - 2; i >= 0; i--)
+        {
+          for (j = bool_array_next (system[row + i], col + rank, col + i + 1);
+               j >= 0;
+               j = bool_array_next (system[row + i], col + rank, j + 1))
+            bool_array_xor_bits (system[row + i], system[row + j - col],
+                                 start, end);
+        }
+      return true;
+    }
+
+  half = (rank / 2 + WORD_BITS - 1) / WORD_BITS * WORD_BITS;
+  u12 = make_block (system + row, col + half, half, rank - half);
+  x1 = make_block (system + row, start, half, end - start);
+  x2 = make_block (system + row + half, start, rank - half, end - start);
+
+  return solve_upper (system, row + half, col + half, rank - half, start, end) &&
+         bool_matrix_mul_add (&x1, &u12, &x2) &&
+         solve_upper (system, row, col, half, start, end);
+}
+
+/*
+ * Applies the elimination by @rank pivots from @row and @col to the columns
+ * [start, end). The pivot rows are solved by their multipliers, then the
+ * rows below are xored by the product of their multipliers and the pivot
+ * rows.
+ */
+static bool
+update_columns (word_t **system,
+                int      n_rows,
+                int      row,
+                int      col,
+                int      rank,
+                int      start,
+                int      end)
+{
+  BoolBlock l21, x, c;
+
+  if (!solve_lower (system, row, col, rank, start, end))
+    return false;
+
+  if (row + rank == n_rows)
+    return true;
+
+  l21 = make_block (system + row + rank, col, n_rows - row - rank, rank);
+  x = make_block (system + row, start, rank, end - start);
+  c = make_block (system + row + rank, start, n_rows - row - rank,
+                    end - start);
+
+  return bool_matrix_mul_add (&c, &l21, &x);
+}
+
+/*
+ * Reduces the tile of columns [first, end) of the rows from @row, the tile
+ * starts a word and fits in it. The pivots are searched in the transposed
+ * tile as by bool_gauss(), but a pivot row is xored only in the word of
+ * tile. The ones of the eliminated rows in the pivot column are kept as
+ * the multipliers, which update the columns after the tile later. A column
+ * without pivot is swapped with the last unchecked column of the tile.
+ */
+static int
+eliminate_tile (word_t  **system,
+                int       n_rows,
+                int       row,
+                int       first,
+                int       end,
+                int      *order,
+                word_t  **tile,
+                word_t   *rows,
+                Progress *progress)
 {
+  int     r_words = bool_array_n_words (n_rows);
+  int     width   = end - first;
+  int     k       = ARRAY_INDEX (first);
+  int     last    = end;
   int     rank    = 0;
-  int     n_words = bool_array_n_words (n_cols);
-  int     i, j, k;
+  int     n_xors, pivot, i, j, b;
+  word_t  bits;
   word_t *swap;
 
-  /* Convert the left square matrix to a identity matrix */
-  for (i = 0; i < n_rows; i++)
+  for (b = 0; b < width; b++)
+    bool_array_clear (tile[b], r_words);
+  for (j = row; j < n_rows; j++)
     {
-      /* Find and set one on the main diagonal */
-      for (j = i; j < n_rows; j++)
+      bits = bool_array_extract (system[j], first, width);
+      for (; bits != 0; bits &= bits - 1)
+        bool_array_set (tile[__builtin_ctzl (bits)], j, true);
+    }
+
+  i = first;
+  while (i < last)
+    {
+      b = i - first;
+      pivot = row + rank;
+      j = pivot < n_rows ? bool_array_next (tile[b], n_rows, pivot) : -1;
+      if (j < 0)
         {
-          if (bool_array_get (system[j], i))
+          last--;
+          if (i < last)
             {
-              swap = system[j];
-              system[j] = system[i];
-              system[i] = swap;
-              break;
+              swap_columns (system, n_rows, i, last);
+              j = order[i];
+              order[i] = order[last];
+              order[last] = j;
+
+              swap = tile[b];
+              tile[b] = tile[last - first];
+              tile[last - first] = swap;
             }
+          progress_step (progress, 1);
+          continue;
         }
 
-      /* Skip column, if it does not contain one */
-      if (! bool_array_get (system[i], i))
-        continue;
+      if (j > pivot)
+        {
+          swap = system[j];
+          system[j] = system[pivot];
+          system[pivot] = swap;
+          swap_tile_rows (tile + b, width - b, pivot, j);
+        }
 
-      rank = i + 1;
+      /* Xor the pivot row below in the columns of tile after the pivot */
+      memcpy (rows, tile[b], r_words * sizeof *rows);
+      bool_array_clear_bits (rows, 0, pivot + 1);
+      bits = system[pivot][k] & ~(word_t) 0 << BIT_INDEX (i) << 1;
+      if (BIT_INDEX (end) != 0)
+        bits &= ((word_t) 1 << BIT_INDEX (end)) - 1;
 
-      /* Zero column except the main diagonal */
+      n_xors = 0;
+      for (j = bool_array_next (rows, n_rows, pivot + 1); j >= 0;
+           j = bool_array_next (rows, n_rows, j + 1))
+        {
+          system[j][k] ^= bits;
+          n_xors++;
+        }
+      PROFILE_COUNT (PROFILE_PIVOTS, 1);
+      PROFILE_COUNT (PROFILE_ROW_XORS, n_xors);
+      PROFILE_COUNT (PROFILE_WORDS, n_xors);
+
+      /* The eliminated rows change in the columns of pivot row */
+      for (; bits != 0; bits &= bits - 1)
+        bool_array_xor_bits (tile[__builtin_ctzl (bits)], rows, pivot + 1,
+                             n_rows);
+
+      rank++;
+      i++;
+      progress_step (progress, 1);
+    }
+
+  return rank;
+}
+
+/*
+ * Reduces the columns [first, end) of the rows from @row to the echelon
+ * form with the multipliers below the pivots. The left half of columns is
+ * reduced first, its pivots update the right half, which is reduced by the
+ * rest of rows. The pivot columns of both halves are joined by moving the
+ * columns without pivot of the left half to the end.
+ */
+static int
+eliminate_columns (word_t  **system,
+                   int       n_rows,
+                   int       row,
+                   int       first,
+                   int       end,
+                   int      *order,
+                   word_t  **tile,
+                   word_t   *rows,
+                   Progress *progress)
+{
+  int middle, rank1, rank2;
+
+  if (row >= n_rows)
+    {
+      progress_step (progress, end - first);
+      return 0;
+    }
+
+  if (end - first <= WORD_BITS)
+    {
+      rank1 = eliminate_tile (system, n_rows, row, first, end, order, tile,
+                              rows, progress);
+      return progress_cancelled (progress) ? -1 : rank1;
+    }
+
+  middle = first + ((end - first) / 2 + WORD_BITS - 1) / WORD_BITS * WORD_BITS;
+  rank1 = eliminate_columns (system, n_rows, row, first, middle, order, tile,
+                             rows, progress);
+  if (rank1 < 0)
+    return -1;
+
+  if (rank1 > 0 &&
+      !update_columns (system, n_rows, row, first, rank1, middle, end))
+    return -1;
+
+  rank2 = eliminate_columns (system, n_rows, row + rank1, middle, end, order,
+                             tile, rows, progress);
+  if (rank2 < 0)
+    return -1;
+
+  if (rank2 > 0 && first + rank1 < middle &&
+      !rotate_columns (system, n_rows, order, first + rank1, middle,
+                       middle + rank2))
+    return -1;
+
+  return rank1 + rank2;
+}
+
+/*
+ * Gausses system by the recursive elimination of halves of columns, the
+ * rows out of the halves are updated by multiplications.
+ *
+ * The left square part is reduced to P A Q = L U, the multipliers of L are
+ * kept below the pivots, so the columns after a half are updated at once by
+ * solving the triangle of L and multiplying by the rows below. Then the
+ * multipliers are cleared and the triangle of U is solved the same way for
+ * the columns after the pivots. The result is an equivalent reduced echelon
+ * form: for a rank-deficient system the pivot rows and the order of the free
+ * columns may differ from the tiled elimination.
+ */
+int
+bool_gauss_recursive (word_t  **system,
+                      int       n_rows,
+                      int       n_cols,
+                      int      *order,
+                      Progress *progress)
+{
+  int      n_pivots = n_rows < n_cols ? n_rows : n_cols;
+  int      rank, i;
+  word_t  *rows;
+  word_t **tile;
+
+  for (i = 0; i < n_pivots; i++)
+    order[i] = i;
+
+  tile = bool_matrix_new (WORD_BITS, n_rows);
+  rows = bool_array_new (n_rows);
+  if (tile == NULL || rows == NULL)
+    {
+      bool_matrix_free (tile, WORD_BITS);
+      free (rows);
+      return -1;
+    }
+
+  progress_stage (progress, "Gaussing system", n_pivots);
+  rank = eliminate_columns (system, n_rows, 0, 0, n_pivots, order, tile, rows,
+                            progress);
+
+  bool_matrix_free (tile, WORD_BITS);
+  free (rows);
+
+  if (rank > 0 && n_cols > n_pivots &&
+      !update_columns (system, n_rows, 0, 0, rank, n_pivots, n_cols))
+    rank = -1;
+  if (rank <= 0)
+    return rank;
+
+  for (i = 1; i < n_rows; i++)
+    bool_array_clear_bits (system[i], 0, i < rank ? i : rank);
+
+  progress_stage (progress, "Substituting back", rank);
+  if (!solve_upper (system, 0, 0, rank, rank, n_cols))
+    return -1;
+
+  for (i = 0; i < rank; i++)
+    bool_array_clear_bits (system[i], i + 1, rank);
+  progress_step (progress, rank);
+
+  return progress_cancelled (progress) ? -1 : rank;
+}
+
+/*
+ * Gausses system with @n_rows logical equations and @n_cols-1 variables.
+ *
+ * The system is reduced to the echelon form first: a pivot row is xored
+ * only into the rows below it and only from the word of pivot, the columns
+ * before are zero. Then back_substitute() reduces the rows above the pivots
+ * in the columns after the pivots, which are the free variables and the
+ * right-hand side. The banded systems of the field stay banded in the
+ * echelon form, so both passes are much cheaper than xoring every pivot
+ * into all rows. The result is the same as of the Gauss-Jordan method.
+ *
+ * The pivot columns are taken by tiles of WORD_BITS columns transposed to
+ * rows, so the pivot and the rows to eliminate are found by counting
+ * trailing zeros of the column instead of probing every row. The tile is
+ * kept up to date by xoring the set of eliminated rows into the columns,
+ * where the pivot row has ones. A column without pivot is moved to the end
+ * by swapping with the last unchecked column, which is loaded to the tile.
+ */
+int
+bool_gauss (word_t  **system,
+            int       n_rows,
+            int       n_cols,
+            int      *order,
+            Progress *progress)
+{
+  int      rank    = 0;
+  int      n_words = bool_array_n_words (n_cols);
+  int      r_words = bool_array_n_words (n_rows);
+  int      n_pivots, last, first, width, i, j, k, b;
+  word_t   bits;
+  word_t  *swap, *rows;
+  word_t **tile;
+
+  n_pivots = n_rows < n_cols ? n_rows : n_cols;
+  if (order != NULL && n_pivots >= RECURSIVE_MIN_PIVOTS &&
+      is_dense (system, n_rows, n_pivots))
+    return bool_gauss_recursive (system, n_rows, n_cols, order, progress);
+
+  last = n_pivots;
+  for (i = 0; order != NULL && i < n_pivots; i++)
+    order[i] = i;
+
+  tile = bool_matrix_new (WORD_BITS, n_rows);
+  rows = bool_array_new (n_rows);
+  if (tile == NULL || rows == NULL)
+    {
+      bool_matrix_free (tile, WORD_BITS);
+      free (rows);
+      return -1;
+    }
+
+  progress_stage (progress, "Gaussing system", n_pivots);
+  for (first = 0; first < n_pivots; first += WORD_BITS)
+    {
+      width = n_pivots - first < (int) WORD_BITS ? n_pivots - first :
+                                                   (int) WORD_BITS;
+
+      /* Transpose the tile of columns */
+      for (b = 0; b < width; b++)
+        bool_array_clear (tile[b], r_words);
       for (j = 0; j < n_rows; j++)
         {
-          if (bool_array_get (system[j], i) && j != i)
+          bits = bool_array_extract (system[j], first, width);
+          for (; bits != 0; bits &= bits - 1)
+            bool_array_set (tile[__builtin_ctzl (bits)], j, true);
+        }
+
+      /* Reduce the left square matrix to the echelon form */
+      for (i = first; i < first + width; i++)
+        {
+          b = i - first;
+
+          /* Find and set one on the main diagonal */
+          j = bool_array_next (tile[b], n_rows, i);
+
+          /* Move the column without pivot to the end */
+          while (j < 0 && order != NULL && last - 1 > i)
+            {
+              last--;
+              swap_columns (system, n_rows, i, last);
+              k = order[i];
+              order[i] = order[last];
+              order[last] = k;
+
+              if (last - first < width)
+                {
+                  swap = tile[b];
+                  tile[b] = tile[last - first];
+                  tile[last - first] = swap;
+                }
+              else
+                {
+                  bool_array_clear (tile[b], r_words);
+                  for (k = 0; k < n_rows; k++)
+                    {
+                      if (bool_array_get (system[k], i))
+                        bool_array_set (tile[b], k, true);
+                    }
+                }
+
+              j = bool_array_next (tile[b], n_rows, i);
+            }
+          if (j > i)
+            {
+              swap = system[j];
+              system[j] = system[i];
+              system[i] = swap;
+              swap_tile_rows (tile + b, width - b, i, j);
+            }
+
+          /* Skip column, if it does not contain one */
+          if (j >= 0)
             {
-              for (k = 0; k < n_words; k++)
-                system[j][k] ^= system[i][k];
+              rank = i + 1;
+
+              /* Zero column below the main diagonal */
+              memcpy (rows, tile[b], r_words * sizeof *rows);
+              memset (rows, 0, ARRAY_INDEX (i) * sizeof *rows);
+              rows[ARRAY_INDEX (i)] &= ~(word_t) 0 << BIT_INDEX (i) << 1;
+              PROFILE_COUNT (PROFILE_PIVOTS, 1);
+              PROFILE_COUNT (PROFILE_ROW_XORS, bool_array_count (rows, r_words));
+              PROFILE_COUNT (PROFILE_WORDS,
+                             (uint64_t) bool_array_count (rows, r_words) *
+                             (n_words - ARRAY_INDEX (i)));
+              for (j = bool_array_next (rows, n_rows, i + 1); j >= 0;
+                   j = bool_array_next (rows, n_rows, j + 1))
+                {
+                  for (k = ARRAY_INDEX (i); k < n_words; k++)
+                    system[j][k] ^= system[i][k];
+                }
+
+              /* The eliminated rows change in the columns of pivot row */
+              bits = bool_array_extract (system[i], first, width) >> b;
+              for (; bits != 0; bits &= bits - 1)
+                {
+                  k = b + __builtin_ctzl (bits);
+                  bool_array_xor_bits (tile[k], rows, i + 1, n_rows);
+                }
             }
+
+          progress_step (progress, 1);
         }
 
-      /* Refresh progress bar */
-      if (progress_sign)
-        show_progress ("Gaussing system", (i + 1) * 100 / n_rows);
+      if (progress_cancelled (progress))
+        {
+          rank = -1;
+          break;
+        }
     }
 
+  bool_matrix_free (tile, WORD_BITS);
+  free (rows);
+
+  if (rank > 0 && !back_substitute (system, rank, n_cols, progress))
+    rank = -1;
+
   return rank;
 }
 
@@ -82,10 +694,27 @@ find_shortest_solution (word_t **system,
                         int      n_cols,
                         int      rank)
 {
-  int     n_vars  = n_cols - 1;
-  int     n_words = bool_array_n_words (n_rows);
-  int     n_remn, n_solutions, min_weight, weight, i, j, k;
-  word_t *solution, *remn, *sum;
+  return find_shortest_solution_in (NULL, system, n_rows, n_cols, rank, NULL);
+}
+
+/*
+ * Finds shortest solution in the gaussed system with temporaries allocated
+ * from the arena.
+ */
+word_t *
+find_shortest_solution_in (Arena    *arena,
+                           word_t  **system,
+                           int       n_rows,
+                           int       n_cols,
+                           int       rank,
+                           Progress *progress)
+{
+  int      n_vars  = n_cols - 1;
+  int      n_words = bool_array_n_words (n_rows);
+  int      n_remn, min_weight, weight, i, j, k;
+  uint64_t n_solutions, step, gray, best;
+  word_t  *solution, *sum;
+  word_t **cols;
 
   /* Check the system for inconsistency */
   for (i = rank; i < n_rows; i++)
@@ -94,7 +723,9 @@ find_shortest_solution (word_t **system,
         return NULL;
     }
 
-  solution = bool_array_new (n_vars);
+  solution = bool_array_new_in (arena, n_vars);
+  if (solution == NULL)
+    return NULL;
 
   /* The system has one solution */
   if (rank == n_vars)
@@ -102,52 +733,97 @@ find_shortest_solution (word_t **system,
       for (i = 0; i < n_rows; i++)
         bool_array_set (solution, i, bool_array_get (system[i], n_vars));
     }
+  /* Too many solutions to walk, the free variables are zeros */
+  else if (n_vars - rank > BOOL_GAUSS_MAX_FREE)
+    {
+      for (i = 0; i < rank; i++)
+        bool_array_set (solution, i, bool_array_get (system[i], n_vars));
+    }
   /* The system has 2^(n_vars-rank) solutions */
   else
     {
       n_remn = n_vars - rank;
-      n_solutions = 1 << n_remn;
+      n_solutions = (uint64_t) 1 << n_remn;
       min_weight = n_cols;
-      remn = bool_array_new (n_remn);
-      sum = bool_array_new (n_rows);
+      best = 0;
 
-      /* Find a solution with a minimum number of ones */
-      for (i = 0; i < n_solutions; i++)
+      /* Transpose the columns of free variables to rows, so a solution is
+         summed by whole words. The last row is the right-hand side. */
+      cols = bool_matrix_new_in (arena, n_remn + 1, n_rows);
+      sum = bool_array_new_in (arena, n_rows);
+      if (cols == NULL || sum == NULL)
         {
-          remn[0] = i;
-          bool_array_clear (sum, n_words);
+          if (arena == NULL)
+            {
+              bool_matrix_free (cols, n_remn + 1);
+              free (sum);
+              free (solution);
+            }
+          return NULL;
+        }
+
+      for (j = 0; j < rank; j++)
+        {
+          for (k = bool_array_next (system[j], n_cols, rank); k >= 0;
+               k = bool_array_next (system[j], n_cols, k + 1))
+            bool_array_set (cols[k - rank], j, true);
+        }
 
-          /* Sum a solution with index i */
-          for (j = 0; j < rank; j++)
+      /* Walk the solutions in Gray code order, a step flips one variable.
+         Ties are broken by the smallest index as in the plain order. The
+         counters are 64-bit, as a word may have no more bits than the
+         free variables. */
+      bool_array_copy_bits (sum, cols[n_remn], 0, rank);
+      gray = 0;
+      progress_stage (progress, "Searching solution",
+                      n_remn < 63 ? (int64_t) n_solutions : 0);
+      for (step = 0; step < n_solutions; step++)
+        {
+          if (step > 0 && step % SEARCH_BLOCK_SIZE == 0)
             {
-              for (k = 0; k < n_remn; k++)
-                {
-                  if (bool_array_get (remn, k))
-                    bool_array_xor (sum, j, bool_array_get (system[j], rank + k));
-                }
-              bool_array_xor (sum, j, bool_array_get (system[j], n_vars));
+              progress_step (progress, SEARCH_BLOCK_SIZE);
+              if (progress_cancelled (progress))
+                break;
             }
 
-          /* Weigh out a solution with index i */
-          weight = bool_array_count (remn, 1) + bool_array_count (sum, n_words);
+          if (step > 0)
+            {
+              k = __builtin_ctzll (step);
+              gray ^= (uint64_t) 1 << k;
+              bool_array_xor_bits (sum, cols[k], 0, rank);
+            }
+
+          weight = __builtin_popcountll (gray) +
+                   bool_array_count (sum, n_words);
 
-          /* Construct a solution with less weight */
-          if (weight < min_weight)
+          if (weight < min_weight || (weight == min_weight && gray < best))
             {
               min_weight = weight;
+              best = gray;
 
-              /* First elemets of solution get from sum */
-              for (j = 0; j < rank; j++)
-                bool_array_set (solution, j, bool_array_get (sum, j));
-
-              /* Rest elemets of solution get from remnant */
-              for (j = 0; j < n_remn; j++)
-                bool_array_set (solution, rank + j, bool_array_get (remn, j));
+              /* First elemets of solution get from sum, rest from remnant */
+              bool_array_copy_bits (solution, sum, 0, rank);
+              bool_array_insert (solution, rank, n_remn, (word_t) gray);
             }
         }
 
-      free (remn);
-      free (sum);
+      PROFILE_COUNT (PROFILE_CANDIDATES, step);
+      PROFILE_COUNT (PROFILE_WORDS, step * 2 * bool_array_n_words (rank));
+      progress_step (progress, step % SEARCH_BLOCK_SIZE);
+
+      if (arena == NULL)
+        {
+          bool_matrix_free (cols, n_remn + 1);
+          free (sum);
+        }
+
+      /* A cancelled search has no lightest solution */
+      if (step < n_solutions)
+        {
+          if (arena == NULL)
+            free (solution);
+          solution = NULL;
+        }
     }
 
   return solution;
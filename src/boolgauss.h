@@ -21,6 +21,11 @@
 #define BOOL_GAUSS_H_
 
 #include "boolmatrix.h"
+#include "progress.h"
+
+/* Most free variables searched for the shortest solution, which 2^n_free
+ * candidates are walked in a reasonable time, they fit a word of 32 bits */
+#define BOOL_GAUSS_MAX_FREE 32
 
 /**
  * SECTION: boolgauss
@@ -36,17 +41,66 @@
  * @system:        A system of logical equations as boolean matrix
  * @n_rows:        Number of equations
  * @n_cols:        Number of variables with right part of system
- * @progress_sign: Show a progress bar
+ * @order:         The array of variables for the columns or %NULL
+ * @progress:      A progress to report the pivot columns or %NULL
  *
  * Gausses system with @n_rows logical equations and @n_cols-1 variables.
+ * The pivots are searched in a transposed tile of columns by whole words.
+ * The system is reduced to the echelon form, then the rows above the pivots
+ * are reduced by back-substitution only in the columns after the pivots.
+ * The result is the same as of the Gauss-Jordan method. The cancellation is
+ * checked after every tile of columns and every %WORD_BITS rows of
+ * back-substitution.
+ *
+ * The pivots are on the main diagonal. If @order is given, a column without
+ * pivot is swapped with the last column of the left square part, so the
+ * first rank columns are pivots for any system, and @order gets the variable
+ * of every column. The swaps reorder the free columns. Otherwise the column
+ * is skipped, which is enough for the systems of the plus stencil, since
+ * their free columns are the last ones, and keeps the free columns in order.
+ *
+ * A dense system of at least 1024 pivot columns with @order is gaussed by
+ * bool_gauss_recursive(), since its echelon form is not banded.
  *
- * Returns:        The rank of system
+ * Returns:        The rank of system or -1 if out of memory or cancelled
  */
 int
-bool_gauss (word_t **system,
-            int      n_rows,
-            int      n_cols,
-            bool     progress_sign);
+bool_gauss (word_t  **system,
+            int       n_rows,
+            int       n_cols,
+            int      *order,
+            Progress *progress);
+
+/**
+ * bool_gauss_recursive:
+ * @system:        A system of logical equations as boolean matrix
+ * @n_rows:        Number of equations
+ * @n_cols:        Number of variables with right part of system
+ * @order:         The array of variables for the columns
+ * @progress:      A progress to report the pivot columns or %NULL
+ *
+ * Gausses system to the reduced echelon form as bool_gauss() with @order, but
+ * by the recursive PLUQ decomposition. The left square part is halved by
+ * columns down to tiles of %WORD_BITS columns, and the pivots of a half
+ * update the columns after it by bool_matrix_mul_add(). So the most of work
+ * is done by the Four Russians and Strassen-Winograd multiplication instead
+ * of xoring rows, which is several times faster for the dense systems of
+ * thousands of variables. The cancellation is checked after every tile of
+ * columns.
+ *
+ * The result is equivalent, not identical to the tiled elimination: the
+ * rank is the same, the first rank columns form the identity and the system
+ * has the same solutions, but for a rank-deficient system other rows may be
+ * the pivots, so @order may put other variables to the free columns.
+ *
+ * Returns:        The rank of system or -1 if out of memory or cancelled
+ */
+int
+bool_gauss_recursive (word_t  **system,
+                      int       n_rows,
+                      int       n_cols,
+                      int      *order,
+                      Progress *progress);
 
 /**
  * find_shortest_solution:
@@ -55,7 +109,8 @@ bool_gauss (word_t **system,
  * @n_cols:        Number of variables with right part of system
  * @rank:          A rank of system calculated by gauss method
  * 
- * Finds shortest solution in the gaussed system.
+ * Finds shortest solution in the gaussed system. If there are more than
+ * %BOOL_GAUSS_MAX_FREE free variables, they are set to zeros.
  * 
  * Returns:        A shortest solution as boolean array
  */
@@ -65,4 +120,30 @@ find_shortest_solution (word_t **system,
                         int      n_cols,
                         int      rank);
 
+/**
+ * find_shortest_solution_in:
+ * @arena:         An arena to allocate from or %NULL to allocate from heap
+ * @system:        A system of logical equations as boolean matrix
+ * @n_rows:        Number of equations
+ * @n_cols:        Number of variables with right part of system
+ * @rank:          A rank of system calculated by gauss method
+ * @progress:      A progress to report the candidates or %NULL
+ *
+ * Finds shortest solution in the gaussed system. The solution and the
+ * temporaries are allocated from the arena. The cancellation is checked
+ * every 65536 candidates. If there are more than %BOOL_GAUSS_MAX_FREE free
+ * variables, they are not searched but set to zeros, so the solution is not
+ * the shortest.
+ *
+ * Returns:        A shortest solution as boolean array or %NULL if there is
+ * no one or the search is cancelled
+ */
+word_t *
+find_shortest_solution_in (Arena    *arena,
+                           word_t  **system,
+                           int       n_rows,
+                           int       n_cols,
+                           int       rank,
+                           Progress *progress);
+
 #endif
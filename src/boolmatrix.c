@@ -17,7 +17,18 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include "boolmatrix.h"
+#include "profile.h"
+
+#define LINE_READER_BLOCK 65536
+
+/* Most memory of a matrix read from the header of image or compact format */
+#define READ_MAX_BYTES ((uint64_t) 1 << 30)
 
 /*
  * Creates boolean matrix and zeros it.
@@ -32,6 +43,7 @@ bool_matrix_new (int n_rows,
   if (matrix != NULL)
     {
       n_words = bool_array_n_words (n_cols);
+      PROFILE_COUNT (PROFILE_ALLOCATED, (size_t) n_rows * n_words * sizeof (word_t));
       for (i = 0; i < n_rows; i++)
         {
           matrix[i] = calloc (n_words, sizeof *matrix[i]);
@@ -47,6 +59,33 @@ bool_matrix_new (int n_rows,
   return matrix;
 }
 
+/*
+ * Creates boolean matrix in the arena and zeros it.
+ */
+word_t **
+bool_matrix_new_in (Arena *arena,
+                    int    n_rows,
+                    int    n_cols)
+{
+  int      n_words = bool_array_n_words (n_cols);
+  word_t **matrix;
+  word_t  *rows;
+  int      i;
+
+  if (arena == NULL)
+    return bool_matrix_new (n_rows, n_cols);
+
+  matrix = arena_alloc (arena, n_rows * sizeof *matrix);
+  rows = arena_calloc (arena, (size_t) n_rows * n_words, sizeof *rows);
+  if (matrix == NULL || rows == NULL)
+    return NULL;
+
+  for (i = 0; i < n_rows; i++)
+    matrix[i] = rows + (size_t) i * n_words;
+
+  return matrix;
+}
+
 /*
  * Adds empty rows in the boolean matrix. If number of lines is negative,
  * then delete specified number of rows and release memory.
@@ -99,104 +138,540 @@ bool_matrix_free (word_t **matrix,
 {
   int i;
 
+  if (matrix == NULL)
+    return;
+
   for (i = 0; i < n_rows; i++)
     {
       if (matrix[i] != NULL)
         free (matrix[i]);
     }
 
-  if (matrix != NULL)
-    free (matrix);
+  free (matrix);
 }
 
 /*
- * Reads a boolean matrix from a stream.
+ * A reader of lines by large blocks. Regular files are mapped into memory,
+ * so their lines are parsed in place.
  */
-static char *
-read_line (FILE *stream)
+typedef struct
 {
-  size_t size   = 64;
-  size_t tie    = size;
-  char  *line   = malloc (size);
-  char  *pline  = line;
-  char  *new_line;
-  int    symbol;
+  int     fd;
+  char   *data;
+  size_t  size;
+  size_t  pos;
+  size_t  capacity;
+  bool    mapped;
+  bool    eof;
+} LineReader;
 
-  if (line == NULL)
-    return NULL;
+/*
+ * Opens a reader of lines on the descriptor of stream.
+ */
+static bool
+line_reader_open (LineReader *reader,
+                  FILE       *stream)
+{
+  struct stat st;
+
+  memset (reader, 0, sizeof *reader);
+  reader->fd = fileno (stream);
+
+  /* Map a regular file read from its beginning */
+  if (fstat (reader->fd, &st) == 0 && S_ISREG (st.st_mode) && st.st_size > 0 &&
+      lseek (reader->fd, 0, SEEK_CUR) == 0)
+    {
+      reader->data = mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE,
+                           reader->fd, 0);
+      if (reader->data != MAP_FAILED)
+        {
+          madvise (reader->data, st.st_size, MADV_SEQUENTIAL);
+          reader->size = st.st_size;
+          reader->mapped = true;
+          reader->eof = true;
+          return true;
+        }
+    }
+
+  reader->capacity = LINE_READER_BLOCK;
+  reader->data = malloc (reader->capacity);
+
+  return reader->data != NULL;
+}
+
+/*
+ * Closes a reader of lines.
+ */
+static void
+line_reader_close (LineReader *reader)
+{
+  if (reader->mapped)
+    munmap (reader->data, reader->size);
+  else
+    free (reader->data);
+}
+
+/*
+ * Reads the next block of stream, so that at least @n_bytes are available.
+ * Returns %FALSE if the stream ends before.
+ */
+static bool
+line_reader_fill (LineReader *reader,
+                  size_t      n_bytes)
+{
+  char    *data;
+  ssize_t  n;
+
+  while (reader->size - reader->pos < n_bytes && !reader->eof)
+    {
+      /* Move the unread data to the beginning of buffer */
+      memmove (reader->data, reader->data + reader->pos,
+               reader->size - reader->pos);
+      reader->size -= reader->pos;
+      reader->pos = 0;
+
+      while (reader->capacity < n_bytes || reader->size == reader->capacity)
+        {
+          data = realloc (reader->data, reader->capacity * 2);
+          if (data == NULL)
+            return false;
+          reader->data = data;
+          reader->capacity *= 2;
+        }
+
+      n = read (reader->fd, reader->data + reader->size,
+                reader->capacity - reader->size);
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n <= 0)
+        reader->eof = true;
+      else
+        reader->size += n;
+    }
+
+  return reader->size - reader->pos >= n_bytes;
+}
+
+/*
+ * Reads a line without the new line symbol. The line is valid until the next
+ * call. Returns %NULL at the end of stream or on error.
+ */
+static const char *
+line_reader_next (LineReader *reader,
+                  size_t     *len)
+{
+  const char *line;
+  const char *end;
+  size_t      scanned = 0;
 
   for (;;)
     {
-      symbol = fgetc (stream);
-      if (symbol == EOF)
+      line = reader->data + reader->pos;
+      end = memchr (line + scanned, '\n', reader->size - reader->pos - scanned);
+      if (end != NULL)
+        {
+          *len = end - line;
+          reader->pos += *len + 1;
+          return line;
+        }
+
+      scanned = reader->size - reader->pos;
+      if (!line_reader_fill (reader, scanned + 1))
+        {
+          if (!reader->eof)
+            return NULL;
+
+          line = reader->data + reader->pos;
+          *len = reader->size - reader->pos;
+          reader->pos = reader->size;
+          return *len > 0 ? line : NULL;
+        }
+    }
+}
+
+/*
+ * Checks the size of matrix in a header before it is allocated. The matrix
+ * must fit %READ_MAX_BYTES and the input must have at least @row_bytes per
+ * row. A mapped file is checked whole, a stream by its first block.
+ */
+static bool
+line_reader_fits (LineReader *reader,
+                  int         n_rows,
+                  int         n_cols,
+                  uint64_t    row_bytes)
+{
+  uint64_t needed = (uint64_t) n_rows * row_bytes;
+  uint64_t bytes  = (uint64_t) n_rows * (sizeof (word_t *) +
+                    bool_array_n_words (n_cols) * sizeof (word_t));
+
+  if (bytes > READ_MAX_BYTES)
+    return false;
+
+  line_reader_fill (reader, needed < LINE_READER_BLOCK ? needed :
+                                                         LINE_READER_BLOCK);
+
+  return !reader->eof || reader->size - reader->pos >= needed;
+}
+
+/*
+ * Reads a symbol. Returns EOF at the end of stream.
+ */
+static int
+line_reader_getc (LineReader *reader)
+{
+  if (!line_reader_fill (reader, 1))
+    return EOF;
+
+  return (unsigned char) reader->data[reader->pos++];
+}
+
+/*
+ * Reads a symbol of PBM image skipping white spaces and comments.
+ */
+static int
+pbm_getc (LineReader *reader)
+{
+  int symbol;
+
+  do
+    {
+      symbol = line_reader_getc (reader);
+      if (symbol == '#')
+        {
+          while (symbol != '\n' && symbol != EOF)
+            symbol = line_reader_getc (reader);
+        }
+    }
+  while (symbol == ' ' || symbol == '\t' || symbol == '\r' || symbol == '\n');
+
+  return symbol;
+}
+
+/*
+ * Reads a non-negative number skipping white spaces and comments. Returns -1
+ * on error.
+ */
+static int
+read_number (LineReader *reader)
+{
+  int number = 0;
+  int symbol = pbm_getc (reader);
+
+  if (symbol < '0' || symbol > '9')
+    return -1;
+
+  while (symbol >= '0' && symbol <= '9')
+    {
+      if (number > (INT32_MAX - 9) / 10)
+        return -1;
+
+      number = number * 10 + symbol - '0';
+      if (!line_reader_fill (reader, 1))
         break;
+      symbol = reader->data[reader->pos];
+      if (symbol >= '0' && symbol <= '9')
+        reader->pos++;
+    }
+
+  return number;
+}
+
+/*
+ * Reads a positive number of PBM header. Returns -1 on error.
+ */
+static int
+pbm_read_number (LineReader *reader)
+{
+  int number = read_number (reader);
+
+  return number > 0 ? number : -1;
+}
+
+/*
+ * Reads the rows of PBM image after the magic number. The raw format P4 has
+ * rows packed to bytes, the plain format P1 has a symbol per bit.
+ */
+static word_t **
+pbm_read (LineReader *reader,
+          bool        raw,
+          int        *n_rows,
+          int        *n_cols)
+{
+  word_t **matrix;
+  int      n_bytes, symbol, i, j;
+
+  *n_cols = pbm_read_number (reader);
+  *n_rows = pbm_read_number (reader);
+
+  /* A single white space separates the header from the raster */
+  if (*n_rows < 0 || *n_cols < 0 || (raw && line_reader_getc (reader) == EOF))
+    {
+      fprintf (stderr, "Damaged header of PBM image\n");
+      return NULL;
+    }
 
-      if (--tie == 0)
+  /* A raw row takes its bytes, a plain one a symbol per bit */
+  n_bytes = (*n_cols + 7) / 8;
+  if (!line_reader_fits (reader, *n_rows, *n_cols, raw ? n_bytes : *n_cols))
+    {
+      fprintf (stderr, "PBM image of %i x %i is too large or truncated\n",
+               *n_rows, *n_cols);
+      return NULL;
+    }
+
+  matrix = bool_matrix_new (*n_rows, *n_cols);
+  if (matrix == NULL)
+    return NULL;
+
+  for (i = 0; i < *n_rows; i++)
+    {
+      if (raw)
         {
-          tie = size;
-          new_line = realloc (pline, size *= 2);
+          if (!line_reader_fill (reader, n_bytes))
+            break;
 
-          if (new_line == NULL)
+          bool_array_unpack_msb (matrix[i],
+                                 (unsigned char *) reader->data + reader->pos,
+                                 *n_cols);
+          reader->pos += n_bytes;
+        }
+      else
+        {
+          for (j = 0; j < *n_cols; j++)
             {
-              free (pline);
-              return NULL;
+              symbol = pbm_getc (reader);
+              if (symbol != '0' && symbol != '1')
+                break;
+              bool_array_set (matrix[i], j, symbol == '1');
             }
 
-          line = new_line + (line - pline);
-          pline = new_line;
+          if (j < *n_cols)
+            break;
         }
+    }
+
+  if (i < *n_rows)
+    {
+      fprintf (stderr, "Row %i: PBM image is truncated or damaged\n", i + 1);
+      bool_matrix_free (matrix, *n_rows);
+      matrix = NULL;
+    }
+
+  return matrix;
+}
+
+/*
+ * Reads the size of click list or run length encoded matrix after the magic
+ * number and allocates the matrix. A row takes at least @row_bytes of the
+ * input.
+ */
+static word_t **
+compact_read_header (LineReader *reader,
+                     const char *format,
+                     int         row_bytes,
+                     int        *n_rows,
+                     int        *n_cols)
+{
+  *n_cols = pbm_read_number (reader);
+  *n_rows = pbm_read_number (reader);
+  if (*n_rows < 0 || *n_cols < 0)
+    {
+      fprintf (stderr, "Damaged header of %s\n", format);
+      return NULL;
+    }
 
-      if ((*line++ = symbol) == '\n')
+  if (!line_reader_fits (reader, *n_rows, *n_cols, row_bytes))
+    {
+      fprintf (stderr, "Size of %s %i x %i is too large or truncated\n",
+               format, *n_rows, *n_cols);
+      return NULL;
+    }
+
+  return bool_matrix_new (*n_rows, *n_cols);
+}
+
+/*
+ * Reads the pairs of row and column of ones after the magic number "CL"
+ * until the end of stream.
+ */
+static word_t **
+clicks_read (LineReader *reader,
+             int        *n_rows,
+             int        *n_cols)
+{
+  word_t **matrix = compact_read_header (reader, "click list", 0, n_rows,
+                                         n_cols);
+  int      row, col, i = 1;
+
+  if (matrix == NULL)
+    return NULL;
+
+  while (pbm_getc (reader) != EOF)
+    {
+      /* The symbol is still in the buffer, it starts the row number */
+      reader->pos--;
+      row = read_number (reader);
+      col = read_number (reader);
+      if (row < 0 || row >= *n_rows || col < 0 || col >= *n_cols)
+        {
+          fprintf (stderr, "Click %i: out of the field or damaged\n", i);
+          bool_matrix_free (matrix, *n_rows);
+          return NULL;
+        }
+
+      bool_array_set (matrix[row], col, true);
+      i++;
+    }
+
+  return matrix;
+}
+
+/*
+ * Reads the run lengths of rows after the magic number "RL". The runs of
+ * zeros and ones alternate starting with zeros and sum to the row width.
+ */
+static word_t **
+rle_read (LineReader *reader,
+          int        *n_rows,
+          int        *n_cols)
+{
+  word_t **matrix = compact_read_header (reader, "run lengths", 1, n_rows,
+                                         n_cols);
+  int      row, col, run, k;
+
+  if (matrix == NULL)
+    return NULL;
+
+  for (row = 0; row < *n_rows; row++)
+    {
+      for (col = 0, k = 0; col < *n_cols; col += run, k++)
+        {
+          run = read_number (reader);
+          if (run < 0 || (run == 0 && k > 0) || run > *n_cols - col)
+            break;
+
+          /* Odd runs are ones */
+          if (k % 2 == 1)
+            bool_array_set_bits (matrix[row], col, col + run);
+        }
+
+      if (col < *n_cols)
+        {
+          fprintf (stderr, "Row %i: run lengths are truncated or damaged\n",
+                   row + 1);
+          bool_matrix_free (matrix, *n_rows);
+          return NULL;
+        }
+    }
+
+  return matrix;
+}
+
+/*
+ * Reads the rows of '0' and '1' symbols until an empty line.
+ */
+static word_t **
+text_read (LineReader *reader,
+           int        *n_rows,
+           int        *n_cols)
+{
+  bool        success  = true;
+  int         capacity = 0;
+  word_t    **matrix   = NULL;
+  const char *line;
+  size_t      len;
+
+  while (success && (line = line_reader_next (reader, &len)) != NULL)
+    {
+      if (len > 0 && line[len - 1] == '\r')
+        len--;
+
+      /* An empty line ends the matrix */
+      if (len == 0)
         break;
+
+      if (*n_rows == 0)
+        *n_cols = len;
+
+      if (len != (size_t) *n_cols)
+        {
+          fprintf (stderr, "Line %i: %i columns instead of %i\n",
+                   *n_rows + 1, (int) len, *n_cols);
+          success = false;
+          break;
+        }
+
+      /* Grow the array of rows twice */
+      if (*n_rows == capacity)
+        {
+          success = bool_matrix_add_rows (&matrix, capacity,
+                                          capacity > 0 ? capacity : 64);
+          capacity += capacity > 0 ? capacity : 64;
+        }
+
+      if (success)
+        {
+          matrix[*n_rows] = bool_array_new (*n_cols);
+          success = matrix[*n_rows] != NULL;
+        }
+
+      if (success)
+        {
+          success = bool_array_parse (matrix[(*n_rows)++], line, *n_cols);
+          if (!success)
+            fprintf (stderr, "Line %i: symbols other than '0' and '1'\n",
+                     *n_rows);
+        }
     }
 
-  *line = '\0';
+  if (!success || *n_rows == 0)
+    {
+      if (matrix != NULL)
+        bool_matrix_free (matrix, *n_rows);
+      matrix = NULL;
+    }
 
-  return pline;
+  return matrix;
 }
 
 /*
- * Converts a boolean matrix to string.
+ * Reads a boolean matrix from a stream.
  */
 word_t **
 bool_matrix_read (FILE *stream,
                   int  *n_rows,
                   int  *n_cols)
 {
-  bool     end_line = false;
-  bool     success  = true;
-  char    *line     = NULL;
-  word_t **matrix   = NULL;
-  word_t  *matrix_row;
+  word_t    **matrix;
+  const char *data;
+  LineReader  reader;
+
   *n_rows = 0;
   *n_cols = 0;
 
-  do
-    {
-      line = read_line (stream);
-      end_line = line == NULL || *line == '\0' || *line == '\n';
-
-      if (!end_line)
-        {
-          success = bool_matrix_add_rows (&matrix, *n_rows, 1);
-          if (success)
-            {
-              matrix_row = bool_array_new_string (line, n_cols);
-              success = matrix_row != NULL;
-              if (success)
-                matrix[(*n_rows)++] = matrix_row;
-            }
-        }
+  if (!line_reader_open (&reader, stream))
+    return NULL;
 
-      free (line);
+  /* Detect the magic number of PBM image */
+  data = line_reader_fill (&reader, 2) ? reader.data + reader.pos : "";
+  if (data[0] == 'P' && (data[1] == '1' || data[1] == '4'))
+    {
+      reader.pos += 2;
+      matrix = pbm_read (&reader, data[1] == '4', n_rows, n_cols);
     }
-  while (!end_line && success);
-
-  if (!success)
+  /* Detect the magic number of click list or run lengths */
+  else if ((data[0] == 'C' || data[0] == 'R') && data[1] == 'L')
     {
-      bool_matrix_free (matrix, *n_rows);
-      matrix = NULL;
+      reader.pos += 2;
+      if (data[0] == 'C')
+        matrix = clicks_read (&reader, n_rows, n_cols);
+      else
+        matrix = rle_read (&reader, n_rows, n_cols);
     }
+  else
+    matrix = text_read (&reader, n_rows, n_cols);
+
+  line_reader_close (&reader);
 
   return matrix;
 }
@@ -210,17 +685,17 @@ bool_matrix_string (word_t **matrix,
                     int      n_cols)
 {
   int   row_len = n_cols + 1;
-  char *str     = malloc (n_rows * row_len + 1);
+  char *str     = malloc ((size_t) n_rows * row_len + 1);
   char *prow    = str;
-  char *row_str;
   int   i;
 
+  if (str == NULL)
+    return NULL;
+
   for (i = 0; i < n_rows; i++)
     {
-      row_str = bool_array_string (matrix[i], n_cols);
-      memcpy (prow, row_str, n_cols);
-      *(prow + n_cols) = '\n';
-      free (row_str);
+      bool_array_to_ascii (matrix[i], prow, n_cols);
+      prow[n_cols] = '\n';
       prow += row_len;
     }
   *prow = '\0';
@@ -228,6 +703,71 @@ bool_matrix_string (word_t **matrix,
   return str;
 }
 
+/*
+ * Writes rows of a boolean matrix by chunks of BOOL_MATRIX_CHUNK_SIZE bytes,
+ * so a small matrix takes one fwrite() and a large one is streamed without
+ * the whole text in memory. The rows are packed as PBM raster or expanded
+ * to text lines.
+ */
+static bool
+write_rows (FILE     *stream,
+            word_t  **matrix,
+            int       n_rows,
+            int       n_cols,
+            bool      packed)
+{
+  size_t  row_len = packed ? (n_cols + 7) / 8 : n_cols + 1;
+  size_t  size    = row_len * n_rows;
+  size_t  used    = 0;
+  char   *chunk;
+  bool    success = true;
+  int     i;
+
+  if (size > BOOL_MATRIX_CHUNK_SIZE)
+    size = row_len > BOOL_MATRIX_CHUNK_SIZE ? row_len : BOOL_MATRIX_CHUNK_SIZE;
+
+  chunk = malloc (size);
+  if (chunk == NULL)
+    return n_rows == 0;
+
+  for (i = 0; i < n_rows && success; i++)
+    {
+      if (used + row_len > size)
+        {
+          success = fwrite (chunk, 1, used, stream) == used;
+          used = 0;
+        }
+
+      if (packed)
+        bool_array_pack_msb (matrix[i], (unsigned char *) chunk + used, n_cols);
+      else
+        {
+          bool_array_to_ascii (matrix[i], chunk + used, n_cols);
+          chunk[used + n_cols] = '\n';
+        }
+      used += row_len;
+    }
+
+  if (success && used > 0)
+    success = fwrite (chunk, 1, used, stream) == used;
+
+  free (chunk);
+
+  return success;
+}
+
+/*
+ * Writes a boolean matrix to a stream as text.
+ */
+bool
+bool_matrix_write_text (FILE     *stream,
+                        word_t  **matrix,
+                        int       n_rows,
+                        int       n_cols)
+{
+  return write_rows (stream, matrix, n_rows, n_cols, false);
+}
+
 /**
  * Prints a boolean matrix into console.
  */
@@ -236,7 +776,308 @@ bool_matrix_print (word_t **matrix,
                    int      n_rows,
                    int      n_cols)
 {
-  char *matrix_str = bool_matrix_string (matrix, n_rows, n_cols);
-  printf ("%s\n", matrix_str);
-  free (matrix_str);
+  if (bool_matrix_write_text (stdout, matrix, n_rows, n_cols))
+    putchar ('\n');
+}
+
+/*
+ * Checks whether the file starts with the header of a binary boolean matrix.
+ */
+bool
+bool_matrix_is_binary (const char *filename)
+{
+  uint32_t magic = 0;
+  FILE    *file  = fopen (filename, "rb");
+
+  if (file == NULL)
+    return false;
+
+  if (fread (&magic, sizeof magic, 1, file) != 1)
+    magic = 0;
+  fclose (file);
+
+  return magic == BOOL_MATRIX_MAGIC;
+}
+
+/*
+ * Maps a binary file of a boolean matrix into memory.
+ */
+word_t **
+bool_matrix_load (const char *filename,
+                  int        *n_rows,
+                  int        *n_cols)
+{
+  BoolMatrixHeader *header;
+  word_t          **matrix = NULL;
+  word_t           *rows, tail;
+  struct stat       st;
+  void             *data;
+  int               n_words, fd, i;
+
+  fd = open (filename, O_RDONLY);
+  if (fd < 0)
+    {
+      perror (filename);
+      return NULL;
+    }
+
+  if (fstat (fd, &st) < 0 || (size_t) st.st_size < sizeof *header)
+    {
+      fprintf (stderr, "%s: not a boolean matrix\n", filename);
+      close (fd);
+      return NULL;
+    }
+
+  data = mmap (NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close (fd);
+  if (data == MAP_FAILED)
+    {
+      perror (filename);
+      return NULL;
+    }
+
+  header = data;
+  n_words = bool_array_n_words (header->n_cols);
+
+  if (header->magic != BOOL_MATRIX_MAGIC ||
+      header->version != BOOL_MATRIX_VERSION ||
+      header->word_size != sizeof (word_t) ||
+      header->n_rows == 0 || header->n_cols == 0 ||
+      header->n_rows > INT32_MAX || header->n_cols > INT32_MAX ||
+      (uint64_t) st.st_size != sizeof *header +
+        (uint64_t) header->n_rows * n_words * sizeof (word_t))
+    {
+      fprintf (stderr, "%s: unsupported or damaged boolean matrix\n",
+               filename);
+      munmap (data, st.st_size);
+      return NULL;
+    }
+
+  *n_rows = header->n_rows;
+  *n_cols = header->n_cols;
+  rows = (word_t *) (header + 1);
+
+  matrix = malloc (*n_rows * sizeof *matrix);
+  if (matrix == NULL)
+    {
+      munmap (data, st.st_size);
+      return NULL;
+    }
+
+  for (i = 0; i < *n_rows; i++)
+    {
+      matrix[i] = rows + (size_t) i * n_words;
+
+      /* Zero the unused bits, the page is copied only if they are dirty */
+      if (BIT_INDEX (*n_cols) != 0)
+        {
+          tail = matrix[i][n_words - 1] & (BIT_MASK (*n_cols) - 1);
+          if (tail != matrix[i][n_words - 1])
+            matrix[i][n_words - 1] = tail;
+        }
+    }
+
+  return matrix;
+}
+
+/*
+ * Unmaps a boolean matrix loaded from a binary file.
+ */
+void
+bool_matrix_unload (word_t **matrix,
+                    int      n_rows,
+                    int      n_cols)
+{
+  size_t size = sizeof (BoolMatrixHeader) +
+                (size_t) n_rows * bool_array_n_words (n_cols) * sizeof (word_t);
+
+  if (matrix == NULL)
+    return;
+
+  munmap ((BoolMatrixHeader *) matrix[0] - 1, size);
+  free (matrix);
+}
+
+/*
+ * Saves a boolean matrix to a binary file through a shared mapping.
+ */
+bool
+bool_matrix_save (const char *filename,
+                  word_t    **matrix,
+                  int         n_rows,
+                  int         n_cols)
+{
+  int               n_words = bool_array_n_words (n_cols);
+  size_t            size    = sizeof (BoolMatrixHeader) +
+                              (size_t) n_rows * n_words * sizeof (word_t);
+  BoolMatrixHeader *header;
+  word_t           *rows;
+  void             *data;
+  int               fd, i;
+
+  fd = open (filename, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0)
+    {
+      perror (filename);
+      return false;
+    }
+
+  data = MAP_FAILED;
+  if (ftruncate (fd, size) == 0)
+    data = mmap (NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close (fd);
+
+  if (data == MAP_FAILED)
+    {
+      perror (filename);
+      return false;
+    }
+
+  header = data;
+  header->magic     = BOOL_MATRIX_MAGIC;
+  header->version   = BOOL_MATRIX_VERSION;
+  header->word_size = sizeof (word_t);
+  header->n_rows    = n_rows;
+  header->n_cols    = n_cols;
+
+  rows = (word_t *) (header + 1);
+  for (i = 0; i < n_rows; i++)
+    memcpy (rows + (size_t) i * n_words, matrix[i], n_words * sizeof (word_t));
+
+  munmap (data, size);
+
+  return true;
+}
+
+/*
+ * Writes a boolean matrix to a stream as PBM image.
+ */
+bool
+bool_matrix_write_pbm (FILE     *stream,
+                       word_t  **matrix,
+                       int       n_rows,
+                       int       n_cols,
+                       bool      raw)
+{
+  return fprintf (stream, "%s\n%i %i\n", raw ? "P4" : "P1",
+                  n_cols, n_rows) > 0 &&
+         write_rows (stream, matrix, n_rows, n_cols, raw);
+}
+
+/*
+ * Formats a non-negative number followed by the separator. Returns the end
+ * of the number.
+ */
+static char *
+format_number (char *str,
+               int   number,
+               char  separator)
+{
+  char digits[12];
+  int  n = 0;
+
+  do
+    {
+      digits[n++] = '0' + number % 10;
+      number /= 10;
+    }
+  while (number > 0);
+
+  while (n > 0)
+    *str++ = digits[--n];
+  *str++ = separator;
+
+  return str;
+}
+
+/*
+ * Writes a boolean matrix as click list or run lengths. The ones are found
+ * by counting trailing zeros of words, the lines are formatted to a chunk,
+ * which is written at once.
+ */
+static bool
+compact_write (FILE     *stream,
+               word_t  **matrix,
+               int       n_rows,
+               int       n_cols,
+               bool      rle)
+{
+  char *chunk   = malloc (BOOL_MATRIX_CHUNK_SIZE);
+  char *p       = chunk;
+  char *end     = chunk + BOOL_MATRIX_CHUNK_SIZE - 32;
+  bool  success = chunk != NULL;
+  int   i, j, k;
+
+  if (success)
+    success = fprintf (stream, "%s\n%i %i\n", rle ? "RL" : "CL",
+                       n_cols, n_rows) > 0;
+
+  for (i = 0; i < n_rows && success; i++)
+    {
+      for (j = bool_array_next (matrix[i], n_cols, 0), k = 0;
+           j >= 0 && success;
+           j = bool_array_next (matrix[i], n_cols, k))
+        {
+          /* Runs of zeros and ones up to the next zero */
+          if (rle)
+            {
+              p = format_number (p, j - k, ' ');
+              k = bool_array_next_zero (matrix[i], n_cols, j);
+              p = format_number (p, k - j, k < n_cols ? ' ' : '\n');
+            }
+          else
+            {
+              p = format_number (p, i, ' ');
+              p = format_number (p, j, '\n');
+              k = j + 1;
+            }
+
+          if (p > end)
+            {
+              success = fwrite (chunk, 1, p - chunk, stream) == (size_t) (p - chunk);
+              p = chunk;
+            }
+        }
+
+      /* The last run of zeros ends the row, a row of zeros is only it */
+      if (rle && k < n_cols)
+        p = format_number (p, n_cols - k, '\n');
+
+      if (p > end && success)
+        {
+          success = fwrite (chunk, 1, p - chunk, stream) == (size_t) (p - chunk);
+          p = chunk;
+        }
+    }
+
+  if (success && p > chunk)
+    success = fwrite (chunk, 1, p - chunk, stream) == (size_t) (p - chunk);
+
+  free (chunk);
+
+  return success;
+}
+
+/*
+ * Writes a boolean matrix to a stream as click list.
+ */
+bool
+bool_matrix_write_clicks (FILE     *stream,
+                          word_t  **matrix,
+                          int       n_rows,
+                          int       n_cols)
+{
+  return compact_write (stream, matrix, n_rows, n_cols, false);
+}
+
+/*
+ * Writes a boolean matrix to a stream as run lengths of rows.
+ */
+bool
+bool_matrix_write_rle (FILE     *stream,
+                       word_t  **matrix,
+                       int       n_rows,
+                       int       n_cols)
+{
+  return compact_write (stream, matrix, n_rows, n_cols, true);
 }
@@ -20,9 +20,15 @@
 #ifndef BOOL_MATRIX_H_
 #define BOOL_MATRIX_H_
 
+#include <stdint.h>
 #include <stdio.h>
 #include "boolarray.h"
 
+#define BOOL_MATRIX_MAGIC   0x42534F4CU
+#define BOOL_MATRIX_VERSION 1
+
+#define BOOL_MATRIX_CHUNK_SIZE (1 << 20)
+
 /**
  * SECTION: boolmatrix
  * @title: boolmatrix
@@ -31,6 +37,28 @@
  * A boolean matrix as dynamic array of boolean arrays.
  */
 
+/**
+ * BoolMatrixHeader:
+ * @magic:     %BOOL_MATRIX_MAGIC, "LOSB" in a little-endian file
+ * @version:   %BOOL_MATRIX_VERSION
+ * @word_size: Size of a processor word in bytes
+ * @n_rows:    Number of rows
+ * @n_cols:    Number of columns
+ *
+ * The header of a binary file of a boolean matrix. The header is followed by
+ * the rows of @n_cols bits packed to processor words exactly as in memory,
+ * the unused bits of the last word of row are zero. All fields are in the
+ * host byte order.
+ */
+typedef struct
+{
+  uint32_t magic;
+  uint16_t version;
+  uint16_t word_size;
+  uint32_t n_rows;
+  uint32_t n_cols;
+} BoolMatrixHeader;
+
 /**
  * bool_matrix_new:
  * @n_rows: Number of equations
@@ -44,6 +72,23 @@ word_t **
 bool_matrix_new (int n_rows,
                  int n_cols);
 
+/**
+ * bool_matrix_new_in:
+ * @arena:  An arena to allocate from or %NULL to allocate from heap
+ * @n_rows: Number of rows
+ * @n_cols: Number of columns
+ *
+ * Creates boolean matrix in the arena and zeros it. The rows are allocated
+ * as one block. The matrix is released with the arena, it must not be passed
+ * to bool_matrix_free().
+ *
+ * Returns: A new boolean matrix
+ */
+word_t **
+bool_matrix_new_in (Arena *arena,
+                    int    n_rows,
+                    int    n_cols);
+
 /**
  * bool_matrix_add_rows:
  * @matrix: (inout): A boolean matrix
@@ -77,9 +122,16 @@ bool_matrix_free (word_t **matrix,
  * @n_rows: (out): Number of rows
  * @n_cols: (out): Number of columns
  * 
- * Reads a boolean matrix from a stream.
+ * Reads a boolean matrix of '0' and '1' symbols from a stream until an empty
+ * line or the end of stream. A stream starting with the magic number "P4" or
+ * "P1" is read as raw or plain PBM image, the black pixels are ones. A stream
+ * starting with "CL" or "RL" is read as click list or run lengths, see
+ * bool_matrix_write_clicks() and bool_matrix_write_rle(). The
+ * stream is read by its descriptor in large blocks, a regular file is mapped
+ * into memory. A row of other width or with other symbols is reported to
+ * stderr.
  * 
- * Returns: A boolean matrix
+ * Returns: A boolean matrix or %NULL on error
  */
 word_t **
 bool_matrix_read (FILE *stream,
@@ -101,6 +153,24 @@ bool_matrix_string (word_t **matrix,
                     int      n_rows,
                     int      n_cols);
 
+/**
+ * bool_matrix_write_text:
+ * @stream: A stream to write as #FILE
+ * @matrix: A boolean matrix
+ * @n_rows: Number of rows
+ * @n_cols: Number of columns
+ *
+ * Writes a boolean matrix to a stream as text. The rows are expanded to a
+ * buffer of %BOOL_MATRIX_CHUNK_SIZE bytes, which is written at once.
+ *
+ * Returns: A success flag
+ */
+bool
+bool_matrix_write_text (FILE     *stream,
+                        word_t  **matrix,
+                        int       n_rows,
+                        int       n_cols);
+
 /**
  * bool_matrix_print:
  * @matrix: A boolean matrix
@@ -114,4 +184,120 @@ bool_matrix_print (word_t **matrix,
                    int      n_rows,
                    int      n_cols);
 
+/**
+ * bool_matrix_write_pbm:
+ * @stream: A stream to write as #FILE
+ * @matrix: A boolean matrix
+ * @n_rows: Number of rows
+ * @n_cols: Number of columns
+ * @raw:    Write the raw format P4 with packed rows, otherwise the plain P1
+ *
+ * Writes a boolean matrix to a stream as PBM image, ones are black pixels.
+ *
+ * Returns: A success flag
+ */
+bool
+bool_matrix_write_pbm (FILE     *stream,
+                       word_t  **matrix,
+                       int       n_rows,
+                       int       n_cols,
+                       bool      raw);
+
+/**
+ * bool_matrix_is_binary:
+ * @filename: A file name
+ *
+ * Checks whether the file starts with the header of a binary boolean matrix.
+ *
+ * Returns: %TRUE if the file is a binary boolean matrix
+ */
+bool
+bool_matrix_is_binary (const char *filename);
+
+/**
+ * bool_matrix_load:
+ * @filename:      A binary file of a boolean matrix
+ * @n_rows: (out): Number of rows
+ * @n_cols: (out): Number of columns
+ *
+ * Maps a binary file of a boolean matrix into memory. The rows point into the
+ * private mapping, so they can be modified without touching the file. The
+ * matrix must be released by bool_matrix_unload().
+ *
+ * Returns: A boolean matrix or %NULL on error
+ */
+word_t **
+bool_matrix_load (const char *filename,
+                  int        *n_rows,
+                  int        *n_cols);
+
+/**
+ * bool_matrix_unload:
+ * @matrix: A boolean matrix loaded by bool_matrix_load()
+ * @n_rows: Number of rows
+ * @n_cols: Number of columns
+ *
+ * Unmaps a boolean matrix loaded from a binary file.
+ */
+void
+bool_matrix_unload (word_t **matrix,
+                    int      n_rows,
+                    int      n_cols);
+
+/**
+ * bool_matrix_save:
+ * @filename: A file name
+ * @matrix:   A boolean matrix
+ * @n_rows:   Number of rows
+ * @n_cols:   Number of columns
+ *
+ * Saves a boolean matrix to a binary file through a shared mapping.
+ *
+ * Returns: A success flag
+ */
+bool
+bool_matrix_save (const char *filename,
+                  word_t    **matrix,
+                  int         n_rows,
+                  int         n_cols);
+
+/**
+ * bool_matrix_write_clicks:
+ * @stream: A stream to write as #FILE
+ * @matrix: A boolean matrix
+ * @n_rows: Number of rows
+ * @n_cols: Number of columns
+ *
+ * Writes a boolean matrix to a stream as click list: the magic number "CL",
+ * the number of columns and rows, then the zero based row and column of
+ * every one, a pair per line, sorted by rows and columns.
+ *
+ * Returns: A success flag
+ */
+bool
+bool_matrix_write_clicks (FILE     *stream,
+                          word_t  **matrix,
+                          int       n_rows,
+                          int       n_cols);
+
+/**
+ * bool_matrix_write_rle:
+ * @stream: A stream to write as #FILE
+ * @matrix: A boolean matrix
+ * @n_rows: Number of rows
+ * @n_cols: Number of columns
+ *
+ * Writes a boolean matrix to a stream as run lengths: the magic number "RL",
+ * the number of columns and rows, then a line per row with the lengths of
+ * runs of zeros and ones alternately. The first run is of zeros and may be
+ * empty, the runs of a row sum to the number of columns.
+ *
+ * Returns: A success flag
+ */
+bool
+bool_matrix_write_rle (FILE     *stream,
+                       word_t  **matrix,
+                       int       n_rows,
+                       int       n_cols);
+
 #endif
@@ -0,0 +1,445 @@
+/*
+ * boolmul.c
+ *
+ * Copyright (C) 2017 - Pavel Nikitin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "boolmul.h"
+#include "profile.h"
+
+#define LOW_MASK(n) ((n) >= WORD_BITS ? ~(word_t) 0 : ((word_t) 1 << (n)) - 1)
+
+#define TABLE_SIZE  (1 << BOOL_MUL_TABLE_BITS)
+#define TABLE_MASK  (TABLE_SIZE - 1)
+#define STRIP_WORDS (BOOL_MUL_STRIP_COLS / WORD_BITS + 1)
+#define MAX_LEVELS  24
+
+/* The temporaries of a level of Strassen-Winograd */
+typedef struct
+{
+  BoolBlock x;
+  BoolBlock y;
+  BoolBlock z;
+} Workspace;
+
+/*
+ * Xors the product of @a by @b into @c by the tables of Four Russians. The
+ * columns of @b must have the same offset in words as the columns of @c.
+ * The product is computed by strips of columns, so the tables of a strip
+ * stay in cache while all rows of @a look them up.
+ */
+static void
+mul_four_russians (const BoolBlock *c,
+                   const BoolBlock *a,
+                   const BoolBlock *b,
+                   word_t          *tables)
+{
+  int           n_words, first, b_first, start, width, k, t, s, i, r, w;
+  int           n_bits, n_xors, stride;
+  word_t        head, tail, bits;
+  word_t       *table, *dst;
+  const word_t *src, *t0, *t1, *t2, *t3;
+
+  for (start = 0; start < c->n_cols; start += BOOL_MUL_STRIP_COLS)
+    {
+      width = c->n_cols - start < BOOL_MUL_STRIP_COLS ? c->n_cols - start :
+                                                        BOOL_MUL_STRIP_COLS;
+      first = ARRAY_INDEX (c->col + start);
+      b_first = ARRAY_INDEX (b->col + start);
+      n_words = ARRAY_INDEX (c->col + start + width - 1) - first + 1;
+      head = ~(word_t) 0 << BIT_INDEX (c->col + start);
+      tail = LOW_MASK (BIT_INDEX (c->col + start + width - 1) + 1);
+      stride = TABLE_SIZE * n_words;
+
+      /* The first row of every table is the empty sum */
+      for (t = 0; t < BOOL_MUL_N_TABLES; t++)
+        memset (tables + t * stride, 0, n_words * sizeof *tables);
+
+      for (k = 0; k < a->n_cols; k += BOOL_MUL_N_TABLES * BOOL_MUL_TABLE_BITS)
+        {
+          n_bits = a->n_cols - k;
+          if (n_bits > BOOL_MUL_N_TABLES * BOOL_MUL_TABLE_BITS)
+            n_bits = BOOL_MUL_N_TABLES * BOOL_MUL_TABLE_BITS;
+
+          /* Table the sums of rows of @b, a sum from a smaller one */
+          for (t = 0; t * BOOL_MUL_TABLE_BITS < n_bits; t++)
+            {
+              table = tables + t * stride;
+              for (s = 0; s < BOOL_MUL_TABLE_BITS; s++)
+                {
+                  dst = table + (1 << s) * n_words;
+                  if (t * BOOL_MUL_TABLE_BITS + s >= n_bits)
+                    {
+                      memset (dst, 0, n_words * sizeof *dst);
+                      continue;
+                    }
+
+                  src = b->rows[k + t * BOOL_MUL_TABLE_BITS + s] + b_first;
+                  memcpy (dst, src, n_words * sizeof *dst);
+                  dst[0] &= head;
+                  dst[n_words - 1] &= tail;
+                }
+
+              for (i = 3; i < TABLE_SIZE; i++)
+                {
+                  if ((i & (i - 1)) == 0)
+                    continue;
+
+                  dst = table + i * n_words;
+                  src = table + (i & (i - 1)) * n_words;
+                  t0 = table + (i & -i) * n_words;
+                  for (w = 0; w < n_words; w++)
+                    dst[w] = src[w] ^ t0[w];
+                }
+            }
+
+          /* A row of product takes one tabled sum from every table */
+          n_xors = 0;
+          for (r = 0; r < a->n_rows; r++)
+            {
+              bits = bool_array_extract (a->rows[r], a->col + k, n_bits);
+              if (bits == 0)
+                continue;
+
+              dst = c->rows[r] + first;
+              t0 = tables + (bits & TABLE_MASK) * n_words;
+#if BOOL_MUL_N_TABLES == 4
+              t1 = tables + stride +
+                   ((bits >> BOOL_MUL_TABLE_BITS) & TABLE_MASK) * n_words;
+              t2 = tables + 2 * stride +
+                   ((bits >> 2 * BOOL_MUL_TABLE_BITS) & TABLE_MASK) * n_words;
+              t3 = tables + 3 * stride +
+                   ((bits >> 3 * BOOL_MUL_TABLE_BITS) & TABLE_MASK) * n_words;
+              for (w = 0; w < n_words; w++)
+                dst[w] ^= t0[w] ^ t1[w] ^ t2[w] ^ t3[w];
+#else
+              for (w = 0; w < n_words; w++)
+                dst[w] ^= t0[w];
+              for (t = 1; t < BOOL_MUL_N_TABLES; t++)
+                {
+                  t1 = tables + t * stride +
+                       ((bits >> t * BOOL_MUL_TABLE_BITS) & TABLE_MASK) *
+                       n_words;
+                  for (w = 0; w < n_words; w++)
+                    dst[w] ^= t1[w];
+                }
+#endif
+              n_xors++;
+            }
+
+          PROFILE_COUNT (PROFILE_ROW_XORS, n_xors);
+          PROFILE_COUNT (PROFILE_WORDS, (uint64_t) n_xors * n_words);
+        }
+    }
+}
+
+/*
+ * Takes a quadrant of block, the sizes of block are even.
+ */
+static BoolBlock
+quadrant (const BoolBlock *block,
+          int              row,
+          int              col)
+{
+  BoolBlock quarter;
+
+  quarter.n_rows = block->n_rows / 2;
+  quarter.n_cols = block->n_cols / 2;
+  quarter.rows = block->rows + row * quarter.n_rows;
+  quarter.col = block->col + col * quarter.n_cols;
+
+  return quarter;
+}
+
+/*
+ * Xors two blocks of whole words into the third one, which may be any of
+ * them.
+ */
+static void
+add_blocks (const BoolBlock *dst,
+            const BoolBlock *x,
+            const BoolBlock *y)
+{
+  int           n_words = dst->n_cols / WORD_BITS;
+  int           i, w;
+  word_t       *d;
+  const word_t *p, *q;
+
+  for (i = 0; i < dst->n_rows; i++)
+    {
+      d = dst->rows[i] + dst->col / WORD_BITS;
+      p = x->rows[i] + x->col / WORD_BITS;
+      q = y->rows[i] + y->col / WORD_BITS;
+      for (w = 0; w < n_words; w++)
+        d[w] = p[w] ^ q[w];
+    }
+}
+
+/*
+ * Zeros a block of whole words.
+ */
+static void
+clear_block (const BoolBlock *block)
+{
+  int i;
+
+  for (i = 0; i < block->n_rows; i++)
+    memset (block->rows[i] + block->col / WORD_BITS, 0,
+            block->n_cols / WORD_BITS * sizeof (word_t));
+}
+
+static void
+winograd (const BoolBlock *c,
+          const BoolBlock *a,
+          const BoolBlock *b,
+          int              level,
+          const Workspace *workspace,
+          word_t          *tables);
+
+/*
+ * Xors the product of half blocks into @c. The product is taken to the
+ * temporary of level, unless the half blocks are multiplied directly.
+ */
+static void
+winograd_add (const BoolBlock *c,
+              const BoolBlock *a,
+              const BoolBlock *b,
+              int              level,
+              const Workspace *workspace,
+              word_t          *tables)
+{
+  if (level == 1)
+    {
+      mul_four_russians (c, a, b, tables);
+      return;
+    }
+
+  winograd (&workspace[level].z, a, b, level - 1, workspace, tables);
+  add_blocks (c, c, &workspace[level].z);
+}
+
+/*
+ * Multiplies the blocks of whole words to @c by the Strassen-Winograd
+ * recursion. The 7 half products and 15 sums are scheduled as by Boyer,
+ * Dumas, Pernet and Zhou, so a level needs only 3 temporaries. The sums
+ * and the differences are the same xor over GF(2).
+ */
+static void
+winograd (const BoolBlock *c,
+          const BoolBlock *a,
+          const BoolBlock *b,
+          int              level,
+          const Workspace *workspace,
+          word_t          *tables)
+{
+  const BoolBlock *x = &workspace[level].x;
+  const BoolBlock *y = &workspace[level].y;
+  BoolBlock        a11, a12, a21, a22, b11, b12, b21, b22;
+  BoolBlock        c11, c12, c21, c22;
+
+  if (level == 0)
+    {
+      clear_block (c);
+      mul_four_russians (c, a, b, tables);
+      return;
+    }
+
+  a11 = quadrant (a, 0, 0);
+  a12 = quadrant (a, 0, 1);
+  a21 = quadrant (a, 1, 0);
+  a22 = quadrant (a, 1, 1);
+  b11 = quadrant (b, 0, 0);
+  b12 = quadrant (b, 0, 1);
+  b21 = quadrant (b, 1, 0);
+  b22 = quadrant (b, 1, 1);
+  c11 = quadrant (c, 0, 0);
+  c12 = quadrant (c, 0, 1);
+  c21 = quadrant (c, 1, 0);
+  c22 = quadrant (c, 1, 1);
+
+  add_blocks (x, &a11, &a21);
+  add_blocks (y, &b22, &b12);
+  winograd (&c21, x, y, level - 1, workspace, tables);
+  add_blocks (x, &a21, &a22);
+  add_blocks (y, &b12, &b11);
+  winograd (&c22, x, y, level - 1, workspace, tables);
+  add_blocks (y, &b22, y);
+  add_blocks (x, x, &a11);
+  winograd (&c12, x, y, level - 1, workspace, tables);
+  add_blocks (x, &a12, x);
+  winograd (&c11, &a11, &b11, level - 1, workspace, tables);
+
+  add_blocks (&c12, &c11, &c12);
+  add_blocks (&c21, &c12, &c21);
+  add_blocks (&c12, &c12, &c22);
+  add_blocks (&c22, &c21, &c22);
+
+  winograd_add (&c12, x, &b22, level, workspace, tables);
+  add_blocks (y, y, &b21);
+  winograd_add (&c21, &a22, y, level, workspace, tables);
+  winograd_add (&c11, &a12, &b21, level, workspace, tables);
+}
+
+/*
+ * Creates a block of whole words in the arena.
+ */
+static bool
+new_block (Arena     *arena,
+           BoolBlock *block,
+           int        n_rows,
+           int        n_cols)
+{
+  block->rows = bool_matrix_new_in (arena, n_rows, n_cols);
+  block->col = 0;
+  block->n_rows = n_rows;
+  block->n_cols = n_cols;
+
+  return block->rows != NULL;
+}
+
+/*
+ * Copies a block to the block of arena from the first column.
+ */
+static void
+copy_block (const BoolBlock *dst,
+            const BoolBlock *src)
+{
+  int i;
+
+  for (i = 0; i < src->n_rows; i++)
+    bool_array_move_bits (dst->rows[i], dst->col, src->rows[i], src->col,
+                          src->n_cols);
+}
+
+/*
+ * Multiplies by Strassen-Winograd the blocks copied to whole words. The
+ * sizes are padded by zeros to be halved @levels times.
+ */
+static bool
+mul_strassen (const BoolBlock *c,
+              const BoolBlock *a,
+              const BoolBlock *b,
+              int              levels,
+              word_t          *tables)
+{
+  Workspace  workspace[MAX_LEVELS + 1];
+  BoolBlock  a_pad, b_pad, c_pad;
+  Arena     *arena = arena_new (0);
+  int        unit  = WORD_BITS << levels;
+  int        m     = (a->n_rows + unit - 1) / unit * unit;
+  int        k     = (a->n_cols + unit - 1) / unit * unit;
+  int        n     = (b->n_cols + unit - 1) / unit * unit;
+  bool       success;
+  int        l, i, j, width;
+
+  success = arena != NULL &&
+            new_block (arena, &a_pad, m, k) &&
+            new_block (arena, &b_pad, k, n) &&
+            new_block (arena, &c_pad, m, n);
+
+  for (l = levels; l > 0 && success; l--)
+    {
+      m /= 2;
+      k /= 2;
+      n /= 2;
+      success = new_block (arena, &workspace[l].x, m, k) &&
+                new_block (arena, &workspace[l].y, k, n) &&
+                (l == 1 || new_block (arena, &workspace[l].z, m, n));
+    }
+
+  if (success)
+    {
+      copy_block (&a_pad, a);
+      copy_block (&b_pad, b);
+      winograd (&c_pad, &a_pad, &b_pad, levels, workspace, tables);
+
+      for (i = 0; i < c->n_rows; i++)
+        {
+          for (j = 0; j < c->n_cols; j += WORD_BITS)
+            {
+              width = c->n_cols - j < WORD_BITS ? c->n_cols - j : WORD_BITS;
+              bool_array_insert (c->rows[i], c->col + j, width,
+                                 bool_array_extract (c->rows[i], c->col + j,
+                                                     width) ^
+                                 c_pad.rows[i][j / WORD_BITS]);
+            }
+        }
+    }
+
+  if (arena != NULL)
+    arena_free (arena);
+
+  return success;
+}
+
+/*
+ * Xors the product of @a by @b into @c.
+ */
+bool
+bool_matrix_mul_add (const BoolBlock *c,
+                     const BoolBlock *a,
+                     const BoolBlock *b)
+{
+  BoolBlock  b_copy;
+  Arena     *arena   = NULL;
+  word_t    *tables;
+  bool       success = true;
+  int        size, levels;
+
+  if (a->n_rows == 0 || a->n_cols == 0 || b->n_cols == 0)
+    return true;
+
+  tables = malloc ((size_t) BOOL_MUL_N_TABLES * TABLE_SIZE * STRIP_WORDS *
+                   sizeof *tables);
+  if (tables == NULL)
+    return false;
+
+  size = a->n_rows;
+  if (a->n_cols < size)
+    size = a->n_cols;
+  if (b->n_cols < size)
+    size = b->n_cols;
+  for (levels = 0; levels < MAX_LEVELS && size >> levels >= BOOL_MUL_CUTOFF;
+       levels++)
+    ;
+
+  if (levels > 0)
+    success = mul_strassen (c, a, b, levels, tables);
+  else if (BIT_INDEX (b->col) == BIT_INDEX (c->col))
+    mul_four_russians (c, a, b, tables);
+  else
+    {
+      /* The rows of @b are tabled by words of @c */
+      arena = arena_new (0);
+      success = arena != NULL &&
+                new_block (arena, &b_copy, b->n_rows,
+                           BIT_INDEX (c->col) + b->n_cols);
+      if (success)
+        {
+          b_copy.col = BIT_INDEX (c->col);
+          b_copy.n_cols = b->n_cols;
+          copy_block (&b_copy, b);
+          mul_four_russians (c, a, &b_copy, tables);
+        }
+
+      if (arena != NULL)
+        arena_free (arena);
+    }
+
+  free (tables);
+
+  return success;
+}
@@ -0,0 +1,87 @@
+/*
+ * boolmul.h
+ *
+ * Copyright (C) 2017 - Pavel Nikitin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BOOL_MUL_H_
+#define BOOL_MUL_H_
+
+#include "boolmatrix.h"
+
+/* Number of rows of the right matrix combined by a table of Four Russians */
+#define BOOL_MUL_TABLE_BITS 8
+
+/* Number of tables looked up per pass over the rows of product */
+#define BOOL_MUL_N_TABLES   4
+
+/* Number of columns of product per pass, so the tables stay in cache */
+#define BOOL_MUL_STRIP_COLS 2048
+
+/* Least size of all dimensions, which is split by Strassen-Winograd */
+#define BOOL_MUL_CUTOFF     2048
+
+/**
+ * SECTION: boolmul
+ * @title: boolmul
+ * @short_description: Multiplies boolean matrices over GF(2)
+ *
+ * Multiplies boolean matrices over GF(2), where the addition is xor and the
+ * multiplication is and. The blocks of matrices are multiplied in place, so
+ * the elimination updates the columns of the system by its own rows.
+ */
+
+/**
+ * BoolBlock:
+ * @rows:   The rows of matrix from the first row of block
+ * @col:    The first column of block
+ * @n_rows: Number of rows
+ * @n_cols: Number of columns
+ *
+ * A block of boolean matrix. The rows are shared with the matrix, so the
+ * block of other rows is taken by offsetting @rows.
+ */
+typedef struct
+{
+  word_t **rows;
+  int      col;
+  int      n_rows;
+  int      n_cols;
+} BoolBlock;
+
+/**
+ * bool_matrix_mul_add:
+ * @c: A block of product, @a rows by @b columns
+ * @a: A block of left matrix
+ * @b: A block of right matrix, @a columns by @b columns
+ *
+ * Xors the product of @a by @b into @c. The blocks are multiplied by Four
+ * Russians: the sums of every %BOOL_MUL_TABLE_BITS rows of @b are tabled in
+ * the Gray code order, so a row of @c is updated by one xor of a tabled row
+ * per %BOOL_MUL_TABLE_BITS columns of @a. If all dimensions are at least
+ * %BOOL_MUL_CUTOFF, the blocks are copied to whole words and multiplied by
+ * the Strassen-Winograd recursion of 7 half products down to the cutoff.
+ *
+ * The block @c must not overlap @a and @b, but may share the rows.
+ *
+ * Returns: A success flag, %FALSE if out of memory
+ */
+bool
+bool_matrix_mul_add (const BoolBlock *c,
+                     const BoolBlock *a,
+                     const BoolBlock *b);
+
+#endif
@@ -0,0 +1,228 @@
+/*
+ * lightsoffcontext.c
+ *
+ * Copyright (C) 2017 - Pavel Nikitin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <time.h>
+#include "lightsoffcontext.h"
+#include "smallboard.h"
+
+struct _LightsoffContext
+{
+  Arena           *arena;
+  Progress        *progress;
+  LightsoffFactor *factor;
+  Stencil          stencil;
+  LightsoffStats   stats;
+  int              last_rows;
+  int              last_cols;
+  Stencil          last_stencil;
+};
+
+/*
+ * Reads a monotonic clock in nanoseconds.
+ */
+static uint64_t
+clock_ns (void)
+{
+  struct timespec time;
+
+  clock_gettime (CLOCK_MONOTONIC, &time);
+
+  return (uint64_t) time.tv_sec * 1000000000 + time.tv_nsec;
+}
+
+/*
+ * Creates a context.
+ */
+LightsoffContext *
+lightsoff_context_new (ProgressFunc  func,
+                       void         *data)
+{
+  LightsoffContext *context = calloc (1, sizeof *context);
+
+  if (context == NULL)
+    return NULL;
+
+  context->stencil = STENCIL_PLUS;
+  context->arena = arena_new (0);
+  context->progress = progress_new (func, data);
+  if (context->arena == NULL || context->progress == NULL)
+    {
+      lightsoff_context_free (context);
+      return NULL;
+    }
+
+  return context;
+}
+
+/*
+ * Releases a context.
+ */
+void
+lightsoff_context_free (LightsoffContext *context)
+{
+  if (context == NULL)
+    return;
+
+  lightsoff_factor_free (context->factor);
+  progress_free (context->progress);
+  arena_free (context->arena);
+  free (context);
+}
+
+/*
+ * Sets the stencil of the next solves.
+ */
+void
+lightsoff_context_set_stencil (LightsoffContext *context,
+                               Stencil           stencil)
+{
+  context->stencil = stencil;
+}
+
+/*
+ * Sets the time limit of the next solves.
+ */
+void
+lightsoff_context_set_limit (LightsoffContext *context,
+                             double            seconds)
+{
+  progress_set_limit (context->progress, seconds);
+}
+
+/*
+ * Gets the factor of the field size. The system is factorized when the size
+ * repeats, so a single solve of a size stays in the scratch memory.
+ */
+static const LightsoffFactor *
+context_factor (LightsoffContext *context,
+                int               n_rows,
+                int               n_cols)
+{
+  LightsoffFactor *factor = context->factor;
+
+  if (factor != NULL && factor->n_rows == n_rows &&
+      factor->n_cols == n_cols && factor->stencil == context->stencil)
+    return factor;
+
+  if (context->last_rows != n_rows || context->last_cols != n_cols ||
+      context->last_stencil != context->stencil)
+    return NULL;
+
+  lightsoff_factor_free (factor);
+  context->factor = lightsoff_factor_new (n_rows, n_cols, context->stencil,
+                                          context->progress);
+  context->stats.factored = context->factor != NULL;
+
+  return context->factor;
+}
+
+/*
+ * Solves a puzzle Lights Off in the scratch memory of the context.
+ */
+word_t **
+lightsoff_context_solve (LightsoffContext  *context,
+                         word_t           **field,
+                         int                n_rows,
+                         int                n_cols,
+                         int               *n_solutions,
+                         int               *min_weight)
+{
+  const LightsoffFactor *factor;
+  word_t               **solution = NULL;
+  uint64_t               counters[PROFILE_N_COUNTERS];
+  uint64_t               start;
+  int                    i;
+
+  *n_solutions = 0;
+  *min_weight = 0;
+
+  memcpy (counters, profile_counters, sizeof counters);
+  start = clock_ns ();
+  arena_reset (context->arena);
+  context->stats.factored = false;
+
+  if (!progress_start (context->progress))
+    return NULL;
+
+  /* The tables are generated for the plus stencil only */
+  if (context->stencil == STENCIL_PLUS && small_board_fits (n_rows, n_cols))
+    factor = NULL;
+  else
+    factor = context_factor (context, n_rows, n_cols);
+
+  if (factor != NULL)
+    solution = lightsoff_factor_solve_in (context->arena, factor, field,
+                                          n_solutions, min_weight,
+                                          context->progress);
+  else if (!progress_cancelled (context->progress))
+    solution = lightsoff_solve_in (context->arena, field, n_rows, n_cols,
+                                   context->stencil, n_solutions, min_weight,
+                                   context->progress);
+
+  progress_stop (context->progress);
+
+  context->last_rows = n_rows;
+  context->last_cols = n_cols;
+  context->last_stencil = context->stencil;
+
+  context->stats.n_solves++;
+  context->stats.wall = clock_ns () - start;
+  context->stats.bytes = arena_peak (context->arena);
+  for (i = 0; i < PROFILE_N_COUNTERS; i++)
+    context->stats.counters[i] = profile_counters[i] - counters[i];
+
+  return solution;
+}
+
+/*
+ * Cancels the current solve of the context.
+ */
+void
+lightsoff_context_cancel (LightsoffContext *context)
+{
+  progress_cancel (context->progress);
+}
+
+/*
+ * Clears the cancellation of the context.
+ */
+void
+lightsoff_context_reset (LightsoffContext *context)
+{
+  progress_reset (context->progress);
+}
+
+/*
+ * Checks if the last solve is cancelled.
+ */
+bool
+lightsoff_context_cancelled (LightsoffContext *context)
+{
+  return progress_cancelled (context->progress);
+}
+
+/*
+ * Gets the statistics of solves of the context.
+ */
+void
+lightsoff_context_get_stats (LightsoffContext *context,
+                             LightsoffStats   *stats)
+{
+  *stats = context->stats;
+}
@@ -0,0 +1,179 @@
+/*
+ * lightsoffcontext.h
+ *
+ * Copyright (C) 2017 - Pavel Nikitin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LIGHTSOFF_CONTEXT_H_
+#define LIGHTSOFF_CONTEXT_H_
+
+#include "lightsoffsolver.h"
+#include "profile.h"
+
+/**
+ * SECTION: lightsoffcontext
+ * @title: lightsoffcontext
+ * @short_description: Solves fields one by one with own memory and settings.
+ *
+ * A context owns everything a solve needs: an arena of scratch memory, the
+ * factorized system of the last size, the settings and the progress, and it
+ * keeps the statistics of its solves. The library has no other mutable state
+ * except the profile, so every thread of a process may solve by its own
+ * context at the same time. A context itself is used by one thread at once,
+ * only lightsoff_context_cancel() may be called from another thread.
+ */
+
+typedef struct _LightsoffContext LightsoffContext;
+
+/**
+ * LightsoffStats:
+ * @n_solves: Number of solves by the context
+ * @wall:     Wall time of the last solve in nanoseconds
+ * @factored: The last solve has factorized the system, the second solve of
+ *            a new size does
+ * @bytes:    High-water mark of the scratch memory in bytes, see
+ *            arena_peak()
+ * @counters: Counters of the last solve on the calling thread, they are
+ *            zero unless profile_enable() is called
+ *
+ * The statistics of solves of the context.
+ */
+typedef struct
+{
+  int      n_solves;
+  uint64_t wall;
+  bool     factored;
+  size_t   bytes;
+  uint64_t counters[PROFILE_N_COUNTERS];
+} LightsoffStats;
+
+/**
+ * lightsoff_context_new:
+ * @func: A callback to report progress of solves or %NULL
+ * @data: The data to pass to callback
+ *
+ * Creates a context to solve fields by the plus stencil without time limit.
+ *
+ * Returns: A new context or %NULL if out of memory
+ **/
+LightsoffContext *
+lightsoff_context_new (ProgressFunc  func,
+                       void         *data);
+
+/**
+ * lightsoff_context_free:
+ * @context: A context or %NULL
+ *
+ * Releases a context with its scratch memory, so the last solution too.
+ **/
+void
+lightsoff_context_free (LightsoffContext *context);
+
+/**
+ * lightsoff_context_set_stencil:
+ * @context: A context
+ * @stencil: The neighbourhood of a click
+ *
+ * Sets the stencil of the next solves.
+ **/
+void
+lightsoff_context_set_stencil (LightsoffContext *context,
+                               Stencil           stencil);
+
+/**
+ * lightsoff_context_set_limit:
+ * @context: A context
+ * @seconds: Time limit of a solve in seconds, 0 for no limit
+ *
+ * Sets the time limit of the next solves, a solve out of time is cancelled.
+ **/
+void
+lightsoff_context_set_limit (LightsoffContext *context,
+                             double            seconds);
+
+/**
+ * lightsoff_context_solve:
+ * @context:            A context
+ * @field:              The puzzle field as the boolean matrix
+ * @n_rows:             Number of rows in the field
+ * @n_cols:             Number of columns in the field
+ * @n_solutions: (out): Number of all solutions, %INT_MAX if there are more
+ * @min_weight:  (out): The weight of solution as number of ones, -1 if
+ *                      there are too many solutions to search
+ *
+ * Solves a puzzle Lights Off. The small boards are solved by tables. A field
+ * of a new size is solved by the system in the scratch memory, the second
+ * field of the same size factorizes the system into the heap and keeps the
+ * factor for the next fields of the size. The factorization takes about twice
+ * the time and memory of a single solve, so it is paid only by the repeated
+ * sizes. All other memory of the solve is taken from the scratch memory of
+ * the context, so the solves of the same size do not call malloc.
+ *
+ * Returns: The solution as the boolean matrix, valid until the next solve by
+ * the context, or %NULL if there is no one or the solve is cancelled
+ **/
+word_t **
+lightsoff_context_solve (LightsoffContext  *context,
+                         word_t           **field,
+                         int                n_rows,
+                         int                n_cols,
+                         int               *n_solutions,
+                         int               *min_weight);
+
+/**
+ * lightsoff_context_cancel:
+ * @context: A context
+ *
+ * Cancels the current solve of the context from any thread. The solve
+ * returns %NULL. The cancellation is kept, so a cancel before the solve
+ * starts is not lost, and the next solves return %NULL too until
+ * lightsoff_context_reset().
+ **/
+void
+lightsoff_context_cancel (LightsoffContext *context);
+
+/**
+ * lightsoff_context_reset:
+ * @context: A context
+ *
+ * Clears the cancellation of the context, so the next solves run again.
+ **/
+void
+lightsoff_context_reset (LightsoffContext *context);
+
+/**
+ * lightsoff_context_cancelled:
+ * @context: A context
+ *
+ * Checks if the last solve is cancelled or out of time.
+ *
+ * Returns: %TRUE if the last solve is cancelled
+ **/
+bool
+lightsoff_context_cancelled (LightsoffContext *context);
+
+/**
+ * lightsoff_context_get_stats:
+ * @context:     A context
+ * @stats: (out): The statistics of solves
+ *
+ * Gets the statistics of solves of the context.
+ **/
+void
+lightsoff_context_get_stats (LightsoffContext *context,
+                             LightsoffStats   *stats);
+
+#endif
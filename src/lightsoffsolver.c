@@ -17,100 +17,216 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <limits.h>
 #include "lightsoffsolver.h"
+#include "profile.h"
+#include "smallboard.h"
+
+/* Number of candidates between the checks of progress in the coset walk */
+#define COSET_BLOCK_SIZE ((uint64_t) 1 << 16)
 
 /*
- * Calculates of the index in the system matrix by row and column in the field.
- * Returns -1 if out of field range.
+ * Counts 2^nullity solutions saturated at INT_MAX.
  */
 static int
-matrix_index (int row,
-              int col,
-              int n_rows,
-              int n_cols)
+count_solutions (int nullity)
 {
-  return (0 <= row && row < n_rows && 0 <= col && col < n_cols) ?
-         n_cols * row + col : -1;
+  return nullity < 31 ? 1 << nullity : INT_MAX;
 }
 
 /*
- * Creates a system of logical equations by puzzle field.
+ * Gets the order of variables for bool_gauss(). The free columns of the plus
+ * stencil are the last ones, so they are skipped in place: the order is the
+ * identity and the ties of solutions are broken by the order of cells.
+ * Returns %NULL for the plus stencil, otherwise @order to be filled.
+ */
+static int *
+gauss_order (Stencil  stencil,
+             int     *order,
+             int      n)
+{
+  int i;
+
+  if (stencil != STENCIL_PLUS)
+    return order;
+
+  for (i = 0; i < n; i++)
+    order[i] = i;
+
+  return NULL;
+}
+
+/*
+ * Moves the flat solution to the rows of result. The variable i of the
+ * flat solution is the click of the cell order[i].
+ */
+static void
+unpack_solution (word_t       **result,
+                 const word_t  *flat,
+                 const int     *order,
+                 int            n_rows,
+                 int            n_cols)
+{
+  int i;
+
+  for (i = 0; i < n_rows * n_cols; i++)
+    {
+      if (bool_array_get ((word_t *) flat, i))
+        bool_array_set (result[order[i] / n_cols], order[i] % n_cols, true);
+    }
+}
+
+/*
+ * Creates a system of logical equations by puzzle field. The right part is
+ * filled by the ones of field rows found word by word, the bits of the last
+ * word past the columns are skipped.
  */
 static word_t **
-create_system (word_t **field,
+create_system (Arena   *arena,
+               word_t **field,
                int      n_rows,
-               int      n_cols)
+               int      n_cols,
+               Stencil  stencil)
 {
-  int      n      = n_rows * n_cols;
-  word_t **system = bool_matrix_new (n, n + 1);
-  int      himself, neighbor, row, col;
+  int      n       = n_rows * n_cols;
+  int      n_words = bool_array_n_words (n_cols);
+  word_t **system  = bool_matrix_new_in (arena, n, n + 1);
+  word_t   word;
+  int      row, k;
+
+  if (system == NULL)
+    return NULL;
+
+  stencil_fill_system (stencil, system, n_rows, n_cols);
 
   for (row = 0; row < n_rows; row++)
     {
-      for (col = 0; col < n_cols; col++)
+      for (k = 0; k < n_words; k++)
         {
-          himself = matrix_index (row, col, n_rows, n_cols);
-          bool_array_set (system[himself], himself, true);
+          word = field[row][k];
+          if (k == n_words - 1 && BIT_INDEX (n_cols) != 0)
+            word &= BIT_MASK (n_cols) - 1;
 
-          neighbor = matrix_index (row, col + 1, n_rows, n_cols);
-          if (neighbor >= 0)
-            bool_array_set (system[himself], neighbor, true);
+          for (; word != 0; word &= word - 1)
+            bool_array_set (system[n_cols * row + k * WORD_BITS +
+                                   __builtin_ctzl (word)], n, true);
+        }
+    }
 
-          neighbor = matrix_index (row, col - 1, n_rows, n_cols);
-          if (neighbor >= 0)
-            bool_array_set (system[himself], neighbor, true);
+  return system;
+}
 
-          neighbor = matrix_index (row + 1, col, n_rows, n_cols);
-          if (neighbor >= 0)
-            bool_array_set (system[neighbor], himself, true);
+/*
+ * Solves a small puzzle Lights Off by tables.
+ */
+static word_t **
+small_solve (Arena   *arena,
+             word_t **field,
+             int      n_rows,
+             int      n_cols,
+             int     *n_solutions,
+             int     *min_weight)
+{
+  uint64_t board = small_board_pack (field, n_rows, n_cols);
+  uint64_t solution;
+  word_t **result = NULL;
 
-          neighbor = matrix_index (row - 1, col, n_rows, n_cols);
-          if (neighbor >= 0)
-            bool_array_set (system[neighbor], himself, true);
+  *n_solutions = 0;
+  *min_weight = 0;
 
-          bool_array_set (system[himself], n, bool_array_get (field[row], col));
-        }
+  if (small_board_solve (n_rows, n_cols, board, &solution,
+                         n_solutions, min_weight))
+    {
+      result = bool_matrix_new_in (arena, n_rows, n_cols);
+      if (result != NULL)
+        small_board_unpack (solution, result, n_rows, n_cols);
     }
 
-  return system;
+  return result;
 }
 
 /*
  * Solves a puzzle Lights Off.
  */
 word_t **
-lightsoff_solve (word_t **field,
-                 int      n_rows,
-                 int      n_cols,
-                 int     *n_solutions,
-                 int     *min_weight,
-                 bool     progress_sign)
-{
-  int      n        = n_rows * n_cols;
-  word_t **system   = create_system (field, n_rows, n_cols);
-  int      rank     = bool_gauss (system, n, n + 1, progress_sign);
-  word_t  *solution = find_shortest_solution (system, n, n + 1, rank);
-  word_t **result   = NULL;
-  int      row, col;
+lightsoff_solve (word_t  **field,
+                 int       n_rows,
+                 int       n_cols,
+                 Stencil   stencil,
+                 int      *n_solutions,
+                 int      *min_weight,
+                 Progress *progress)
+{
+  return lightsoff_solve_in (NULL, field, n_rows, n_cols, stencil,
+                             n_solutions, min_weight, progress);
+}
 
-  *n_solutions = (solution == NULL) ? 0 : 1 << (n - rank);
-  *min_weight = bool_array_count (solution, bool_array_n_words (n));
+/*
+ * Solves a puzzle Lights Off with all memory allocated from the arena.
+ */
+word_t **
+lightsoff_solve_in (Arena    *arena,
+                    word_t  **field,
+                    int       n_rows,
+                    int       n_cols,
+                    Stencil   stencil,
+                    int      *n_solutions,
+                    int      *min_weight,
+                    Progress *progress)
+{
+  int      n = n_rows * n_cols;
+  word_t **system, **result = NULL;
+  word_t  *solution = NULL;
+  int     *order;
+  int      rank = 0;
+
+  /* The tables are generated for the plus stencil only */
+  if (stencil == STENCIL_PLUS && small_board_fits (n_rows, n_cols))
+    {
+      profile_begin (PROFILE_SEARCH);
+      result = small_solve (arena, field, n_rows, n_cols,
+                            n_solutions, min_weight);
+      profile_end (PROFILE_SEARCH);
+      return result;
+    }
+
+  profile_begin (PROFILE_CREATE_SYSTEM);
+  system = create_system (arena, field, n_rows, n_cols, stencil);
+  order = arena != NULL ? arena_alloc (arena, n * sizeof *order) :
+                          malloc (n * sizeof *order);
+  profile_end (PROFILE_CREATE_SYSTEM);
+  if (system != NULL && order != NULL)
+    {
+      profile_begin (PROFILE_GAUSS);
+      rank = bool_gauss (system, n, n + 1, gauss_order (stencil, order, n),
+                         progress);
+      profile_end (PROFILE_GAUSS);
+
+      profile_begin (PROFILE_SEARCH);
+      if (rank >= 0)
+        solution = find_shortest_solution_in (arena, system, n, n + 1, rank,
+                                              progress);
+      profile_end (PROFILE_SEARCH);
+    }
+
+  *n_solutions = (solution == NULL) ? 0 : count_solutions (n - rank);
+  *min_weight = (solution == NULL) ? 0 :
+                (n - rank > BOOL_GAUSS_MAX_FREE) ? -1 :
+                bool_array_count (solution, bool_array_n_words (n));
 
   if (solution != NULL)
     {
-      result = bool_matrix_new (n_rows, n_cols);
-      for (row = 0; row < n_rows; row++)
-        {
-          for (col = 0; col < n_cols; col++)
-            {
-              if (bool_array_get (solution, n_cols * row + col))
-                bool_array_set (result[row], col, true);
-            }
-        }
-      free (solution);
+      result = bool_matrix_new_in (arena, n_rows, n_cols);
+      if (result != NULL)
+        unpack_solution (result, solution, order, n_rows, n_cols);
     }
 
-  bool_matrix_free (system, n);
+  if (arena == NULL)
+    {
+      free (order);
+      free (solution);
+      bool_matrix_free (system, n);
+    }
 
   return result;
 }
@@ -118,33 +234,981 @@ lightsoff_solve (word_t **field,
 /*
  * Applies the solution to the puzzle Lights Off field.
  */
-void
+bool
 lightsoff_apply (word_t **field,
                  word_t **solution,
                  int      n_rows,
-                 int      n_cols)
+                 int      n_cols,
+                 Stencil  stencil)
 {
-  int row, col;
+  int     n_words = bool_array_n_words (n_cols);
+  word_t *clicks  = malloc (n_words * sizeof *clicks);
+  int     row, k;
+
+  if (clicks == NULL)
+    return false;
+
   for (row = 0; row < n_rows; row++)
     {
-      for (col = 0; col < n_cols; col++)
+      stencil_click_row (stencil, clicks, solution, row, n_rows, n_cols);
+
+      for (k = 0; k < n_words; k++)
+        field[row][k] ^= clicks[k];
+    }
+
+  free (clicks);
+
+  return true;
+}
+
+/*
+ * Checks that the solution turns off all of the tiles of the field.
+ */
+int
+lightsoff_verify (word_t **field,
+                  word_t **solution,
+                  int      n_rows,
+                  int      n_cols,
+                  Stencil  stencil)
+{
+  int     n_words = bool_array_n_words (n_cols);
+  word_t *clicks  = malloc (n_words * sizeof *clicks);
+  bool    solved  = true;
+  int     row, k;
+
+  if (clicks == NULL)
+    return -1;
+
+  for (row = 0; row < n_rows && solved; row++)
+    {
+      stencil_click_row (stencil, clicks, solution, row, n_rows, n_cols);
+
+      for (k = 0; k < n_words; k++)
+        solved &= clicks[k] == field[row][k];
+    }
+
+  free (clicks);
+
+  return solved;
+}
+
+/*
+ * Factorizes the system of logical equations for the field of given size.
+ */
+LightsoffFactor *
+lightsoff_factor_new (int       n_rows,
+                      int       n_cols,
+                      Stencil   stencil,
+                      Progress *progress)
+{
+  int              n = n_rows * n_cols;
+  int              n_kernel, i, j;
+  word_t         **system;
+  LightsoffFactor *factor;
+
+  /* The left part is the system, the right part is the identity matrix,
+   * which accumulates the row operations of the Gauss method */
+  profile_begin (PROFILE_CREATE_SYSTEM);
+  system = bool_matrix_new (n, 2 * n);
+  if (system != NULL)
+    {
+      stencil_fill_system (stencil, system, n_rows, n_cols);
+      for (i = 0; i < n; i++)
+        bool_array_set (system[i], n + i, true);
+    }
+  profile_end (PROFILE_CREATE_SYSTEM);
+
+  if (system == NULL)
+    return NULL;
+
+  factor = malloc (sizeof *factor);
+  if (factor != NULL)
+    factor->order = malloc (n * sizeof *factor->order);
+  if (factor == NULL || factor->order == NULL)
+    {
+      bool_matrix_free (system, n);
+      free (factor);
+      return NULL;
+    }
+
+  factor->n_rows  = n_rows;
+  factor->n_cols  = n_cols;
+  factor->stencil = stencil;
+  profile_begin (PROFILE_GAUSS);
+  factor->rank    = bool_gauss (system, n, 2 * n,
+                                gauss_order (stencil, factor->order, n),
+                                progress);
+  n_kernel        = n - factor->rank;
+  profile_end (PROFILE_GAUSS);
+  if (factor->rank < 0)
+    {
+      bool_matrix_free (system, n);
+      free (factor->order);
+      free (factor);
+      return NULL;
+    }
+
+  factor->transform = bool_matrix_new (n, n);
+  factor->kernel    = bool_matrix_new (n_kernel, n);
+  if (factor->transform == NULL || (factor->kernel == NULL && n_kernel > 0))
+    {
+      bool_matrix_free (system, n);
+      lightsoff_factor_free (factor);
+      return NULL;
+    }
+
+  for (i = 0; i < n; i++)
+    bool_array_move_bits (factor->transform[i], 0, system[i], n, n);
+
+  /* Every free variable gives a vector of the kernel, its bits are moved
+   * from the variables to the cells */
+  for (i = 0; i < n_kernel; i++)
+    {
+      for (j = 0; j < factor->rank; j++)
+        bool_array_set (factor->kernel[i], factor->order[j],
+                        bool_array_get (system[j], factor->rank + i));
+      bool_array_set (factor->kernel[i], factor->order[factor->rank + i],
+                      true);
+    }
+
+  bool_matrix_free (system, n);
+
+  return factor;
+}
+
+/*
+ * Releases a factorized system.
+ */
+void
+lightsoff_factor_free (LightsoffFactor *factor)
+{
+  int n;
+
+  if (factor == NULL)
+    return;
+
+  n = factor->n_rows * factor->n_cols;
+  if (factor->transform != NULL)
+    bool_matrix_free (factor->transform, n);
+  if (factor->kernel != NULL)
+    bool_matrix_free (factor->kernel, n - factor->rank);
+  free (factor->order);
+  free (factor);
+}
+
+/*
+ * Finds a particular solution of the field by the row operations of factor.
+ * The variables are moved to their cells. Returns %FALSE if the field has
+ * no solution.
+ */
+static bool
+factor_particular (const LightsoffFactor *factor,
+                   word_t               **field,
+                   word_t                *flat,
+                   word_t                *solution)
+{
+  int    n       = factor->n_rows * factor->n_cols;
+  int    n_words = bool_array_n_words (n);
+  int    parity, i, k;
+  word_t word;
+
+  for (i = 0; i < factor->n_rows; i++)
+    bool_array_move_bits (flat, factor->n_cols * i, field[i], 0,
+                          factor->n_cols);
+
+  /* Apply the row operations to the right part of system */
+  for (i = 0; i < n; i++)
+    {
+      parity = 0;
+      for (k = 0; k < n_words; k++)
+        {
+          word = factor->transform[i][k] & flat[k];
+          parity ^= bool_array_count (&word, 1) & 1;
+        }
+
+      /* Zero rows of the gaussed system must have zero right part */
+      if (i >= factor->rank && parity)
+        return false;
+      bool_array_set (solution, factor->order[i], parity);
+    }
+
+  return true;
+}
+
+/*
+ * Walks the coset of solution in the Gray code order and copies the lightest
+ * one to best. On equal weights the least Gray code index over the free
+ * variables is preferred, as find_shortest_solution() does over the same
+ * free columns, so the factor and the plain solve give the same solution.
+ * Returns the weight of best or -1 if the walk is cancelled. A kernel over
+ * LIGHTSOFF_MAX_NULLITY is not walked, the solution itself is best.
+ */
+static int
+coset_lightest (word_t        *solution,
+                word_t *const *kernel,
+                int            n_kernel,
+                int            n_words,
+                word_t        *best,
+                Progress      *progress)
+{
+  int      min_weight = bool_array_count (solution, n_words);
+  int      weight, j, k;
+  uint64_t step, gray, best_gray = 0;
+
+  memcpy (best, solution, n_words * sizeof *best);
+  if (n_kernel > LIGHTSOFF_MAX_NULLITY)
+    return min_weight;
+
+  profile_begin (PROFILE_SEARCH);
+  progress_stage (progress, "Searching solution",
+                  n_kernel < 63 ? (int64_t) 1 << n_kernel : 0);
+
+  for (step = 1; step < (uint64_t) 1 << n_kernel; step++)
+    {
+      /* Report and check cancellation by blocks of candidates */
+      if (step % COSET_BLOCK_SIZE == 0)
+        {
+          progress_step (progress, COSET_BLOCK_SIZE);
+          if (progress_cancelled (progress))
+            break;
+        }
+
+      j = __builtin_ctzll (step);
+      for (k = 0; k < n_words; k++)
+        solution[k] ^= kernel[j][k];
+
+      gray = step ^ (step >> 1);
+      weight = bool_array_count (solution, n_words);
+      if (weight < min_weight || (weight == min_weight && gray < best_gray))
+        {
+          min_weight = weight;
+          best_gray = gray;
+          memcpy (best, solution, n_words * sizeof *best);
+        }
+    }
+
+  PROFILE_COUNT (PROFILE_CANDIDATES, step);
+  PROFILE_COUNT (PROFILE_WORDS, step * 2 * n_words);
+  progress_step (progress, step % COSET_BLOCK_SIZE);
+  profile_end (PROFILE_SEARCH);
+
+  return step < (uint64_t) 1 << n_kernel ? -1 : min_weight;
+}
+
+/*
+ * Solves a puzzle Lights Off with the factorized system.
+ */
+word_t **
+lightsoff_factor_solve (const LightsoffFactor *factor,
+                        word_t               **field,
+                        int                   *n_solutions,
+                        int                   *min_weight)
+{
+  return lightsoff_factor_solve_in (NULL, factor, field,
+                                    n_solutions, min_weight, NULL);
+}
+
+/*
+ * Solves a puzzle Lights Off with the factorized system, all memory is
+ * allocated from the arena.
+ */
+word_t **
+lightsoff_factor_solve_in (Arena                 *arena,
+                           const LightsoffFactor *factor,
+                           word_t               **field,
+                           int                   *n_solutions,
+                           int                   *min_weight,
+                           Progress              *progress)
+{
+  int      n_rows     = factor->n_rows;
+  int      n_cols     = factor->n_cols;
+  int      n          = n_rows * n_cols;
+  int      n_words    = bool_array_n_words (n);
+  int      n_kernel   = n - factor->rank;
+  int      weight     = -1;
+  bool     consistent;
+  int      i;
+  word_t  *flat, *solution, *best;
+  word_t **result     = NULL;
+
+  *n_solutions = 0;
+  *min_weight = 0;
+
+  flat     = bool_array_new_in (arena, n);
+  solution = bool_array_new_in (arena, n);
+  best     = bool_array_new_in (arena, n);
+
+  consistent = flat != NULL && solution != NULL && best != NULL &&
+               factor_particular (factor, field, flat, solution);
+
+  if (consistent)
+    weight = coset_lightest (solution, factor->kernel, n_kernel, n_words,
+                             best, progress);
+
+  if (weight >= 0)
+    {
+      *n_solutions = count_solutions (n_kernel);
+      *min_weight = n_kernel > LIGHTSOFF_MAX_NULLITY ? -1 : weight;
+
+      result = bool_matrix_new_in (arena, n_rows, n_cols);
+      if (result != NULL)
+        {
+          for (i = 0; i < n_rows; i++)
+            bool_array_move_bits (result[i], 0, best, n_cols * i, n_cols);
+        }
+    }
+
+  if (arena == NULL)
+    {
+      free (flat);
+      free (solution);
+      free (best);
+    }
+
+  return result;
+}
+
+/*
+ * Starts the enumeration of all solutions of the field.
+ */
+LightsoffIter *
+lightsoff_iter_new (const LightsoffFactor *factor,
+                    word_t               **field)
+{
+  int            n       = factor->n_rows * factor->n_cols;
+  int            nullity = n - factor->rank;
+  LightsoffIter *iter;
+  word_t        *flat;
+
+  if (nullity > LIGHTSOFF_MAX_NULLITY)
+    return NULL;
+
+  iter = malloc (sizeof *iter);
+  flat = bool_array_new (n);
+  if (iter != NULL)
+    {
+      iter->factor = factor;
+      iter->solution = bool_array_new (n);
+      iter->index = 0;
+      iter->n_solutions = (uint64_t) 1 << nullity;
+    }
+
+  if (iter == NULL || flat == NULL || iter->solution == NULL ||
+      !factor_particular (factor, field, flat, iter->solution))
+    {
+      lightsoff_iter_free (iter);
+      iter = NULL;
+    }
+
+  free (flat);
+
+  return iter;
+}
+
+/*
+ * Moves the flat solution to the next one of the coset in the Gray code
+ * order. The first call leaves the particular solution.
+ */
+static bool
+iter_step (LightsoffIter *iter)
+{
+  const LightsoffFactor *factor  = iter->factor;
+  int                    n_words = bool_array_n_words (factor->n_rows *
+                                                       factor->n_cols);
+  int                    j, k;
+
+  if (iter->index >= iter->n_solutions)
+    return false;
+
+  if (iter->index > 0)
+    {
+      j = __builtin_ctzll (iter->index);
+      for (k = 0; k < n_words; k++)
+        iter->solution[k] ^= factor->kernel[j][k];
+    }
+  iter->index++;
+
+  return true;
+}
+
+/*
+ * Gets the next solution of the enumeration.
+ */
+bool
+lightsoff_iter_next (LightsoffIter *iter,
+                     word_t       **solution,
+                     int           *weight)
+{
+  int n_rows = iter->factor->n_rows;
+  int n_cols = iter->factor->n_cols;
+  int i;
+
+  if (!iter_step (iter))
+    return false;
+
+  for (i = 0; i < n_rows; i++)
+    {
+      bool_array_clear (solution[i], bool_array_n_words (n_cols));
+      bool_array_move_bits (solution[i], 0, iter->solution, n_cols * i,
+                            n_cols);
+    }
+
+  if (weight != NULL)
+    *weight = bool_array_count (iter->solution,
+                                bool_array_n_words (n_rows * n_cols));
+
+  return true;
+}
+
+/*
+ * Releases the enumeration.
+ */
+void
+lightsoff_iter_free (LightsoffIter *iter)
+{
+  if (iter == NULL)
+    return;
+
+  free (iter->solution);
+  free (iter);
+}
+
+/*
+ * Compares solutions by weight, then by the Gray code index as
+ * find_shortest_solution() prefers.
+ */
+static bool
+heavier (const int      *weights,
+         const uint64_t *grays,
+         int             a,
+         int             b)
+{
+  return weights[a] > weights[b] ||
+         (weights[a] == weights[b] && grays[a] > grays[b]);
+}
+
+/*
+ * Restores the order of heap with the heaviest solution on the top.
+ */
+static void
+sift_down (int            *heap,
+           int             size,
+           int             i,
+           const int      *weights,
+           const uint64_t *grays)
+{
+  int child, swap;
+
+  for (; (child = 2 * i + 1) < size; i = child)
+    {
+      if (child + 1 < size && heavier (weights, grays, heap[child + 1], heap[child]))
+        child++;
+      if (!heavier (weights, grays, heap[child], heap[i]))
+        break;
+
+      swap = heap[i];
+      heap[i] = heap[child];
+      heap[child] = swap;
+    }
+}
+
+/*
+ * Finds the k lightest solutions keeping them in a bounded heap. The
+ * cancellation is checked by blocks of solutions as in coset_lightest().
+ */
+word_t ***
+lightsoff_factor_lightest (const LightsoffFactor *factor,
+                           word_t               **field,
+                           int                    k,
+                           int                   *n_found,
+                           int                   *weights,
+                           Progress              *progress)
+{
+  int            n_rows  = factor->n_rows;
+  int            n_cols  = factor->n_cols;
+  int            n_words = bool_array_n_words (n_rows * n_cols);
+  LightsoffIter *iter;
+  word_t       **slots;
+  word_t      ***result  = NULL;
+  uint64_t      *grays;
+  uint64_t       gray;
+  int           *heap, *keys;
+  int            size    = 0;
+  int            weight, top, row, i;
+
+  *n_found = 0;
+
+  iter = k > 0 ? lightsoff_iter_new (factor, field) : NULL;
+  if (iter == NULL)
+    return NULL;
+
+  if ((uint64_t) k > iter->n_solutions)
+    k = iter->n_solutions;
+
+  slots = bool_matrix_new (k, n_rows * n_cols);
+  grays = malloc (k * sizeof *grays);
+  heap  = malloc (k * sizeof *heap);
+  keys  = malloc (k * sizeof *keys);
+
+  progress_stage (progress, "Searching solutions", iter->n_solutions);
+  while (slots != NULL && grays != NULL && heap != NULL && keys != NULL &&
+         iter_step (iter))
+    {
+      if (iter->index % COSET_BLOCK_SIZE == 0)
         {
-          if (bool_array_get (solution[row], col))
+          progress_step (progress, COSET_BLOCK_SIZE);
+          if (progress_cancelled (progress))
             {
-              bool_array_xor (field[row], col, true);
+              size = 0;
+              break;
+            }
+        }
 
-              if (col < n_cols - 1)
-                bool_array_xor (field[row], col + 1, true);
+      weight = bool_array_count (iter->solution, n_words);
+      gray = (iter->index - 1) ^ ((iter->index - 1) >> 1);
 
-              if (col > 0)
-                bool_array_xor (field[row], col - 1, true);
+      /* Replace the heaviest of k solutions by a lighter one */
+      if (size == k)
+        {
+          top = heap[0];
+          if (weight > keys[top] || (weight == keys[top] && gray > grays[top]))
+            continue;
+        }
+      else
+        top = size;
 
-              if (row < n_rows - 1)
-                bool_array_xor (field[row + 1], col, true);
+      keys[top] = weight;
+      grays[top] = gray;
+      memcpy (slots[top], iter->solution, n_words * sizeof **slots);
 
-              if (row > 0)
-                bool_array_xor (field[row - 1], col, true);
+      if (size < k)
+        {
+          heap[size] = top;
+          for (i = size++; i > 0 && heavier (keys, grays, heap[i], heap[(i - 1) / 2]);
+               i = (i - 1) / 2)
+            {
+              top = heap[i];
+              heap[i] = heap[(i - 1) / 2];
+              heap[(i - 1) / 2] = top;
             }
         }
+      else
+        sift_down (heap, size, 0, keys, grays);
+    }
+
+  /* Pop the heaviest solutions to the end of result */
+  if (size > 0)
+    result = calloc (size, sizeof *result);
+  for (i = size - 1; i >= 0 && result != NULL; i--)
+    {
+      top = heap[0];
+      result[i] = bool_matrix_new (n_rows, n_cols);
+      if (result[i] == NULL)
+        {
+          lightsoff_solutions_free (result, size, n_rows);
+          result = NULL;
+          break;
+        }
+
+      for (row = 0; row < n_rows; row++)
+        bool_array_move_bits (result[i][row], 0, slots[top], n_cols * row,
+                              n_cols);
+      weights[i] = keys[top];
+
+      heap[0] = heap[i];
+      sift_down (heap, i, 0, keys, grays);
+    }
+
+  if (result != NULL)
+    *n_found = size;
+
+  bool_matrix_free (slots, k);
+  free (grays);
+  free (heap);
+  free (keys);
+  lightsoff_iter_free (iter);
+
+  return result;
+}
+
+/*
+ * Releases the array of solutions.
+ */
+void
+lightsoff_solutions_free (word_t ***solutions,
+                          int       n_solutions,
+                          int       n_rows)
+{
+  int i;
+
+  if (solutions == NULL)
+    return;
+
+  for (i = 0; i < n_solutions; i++)
+    bool_matrix_free (solutions[i], n_rows);
+  free (solutions);
+}
+
+/*
+ * Creates a problem of the field without constraints.
+ */
+LightsoffProblem *
+lightsoff_problem_new (const LightsoffFactor *factor,
+                       word_t               **field)
+{
+  int               n        = factor->n_rows * factor->n_cols;
+  int               n_kernel = n - factor->rank;
+  int               n_words  = bool_array_n_words (n);
+  LightsoffProblem *problem;
+  word_t           *flat;
+  bool              success;
+  int               i;
+
+  problem = calloc (1, sizeof *problem);
+  flat = bool_array_new (n);
+  success = problem != NULL && flat != NULL;
+  if (success)
+    {
+      problem->factor = factor;
+      problem->n_kernel = n_kernel;
+      problem->solution = bool_array_new (n);
+      problem->kernel = bool_matrix_new (n_kernel, n);
+      problem->coeffs = bool_array_new (n_kernel + 1);
+      success = problem->solution != NULL && problem->coeffs != NULL &&
+                (problem->kernel != NULL || n_kernel == 0) &&
+                factor_particular (factor, field, flat, problem->solution);
+    }
+
+  for (i = 0; success && i < n_kernel; i++)
+    memcpy (problem->kernel[i], factor->kernel[i], n_words * sizeof *flat);
+
+  free (flat);
+  if (!success)
+    {
+      lightsoff_problem_free (problem);
+      problem = NULL;
+    }
+
+  return problem;
+}
+
+/*
+ * Releases a problem.
+ */
+void
+lightsoff_problem_free (LightsoffProblem *problem)
+{
+  const LightsoffFactor *factor;
+
+  if (problem == NULL)
+    return;
+
+  factor = problem->factor;
+  if (factor != NULL)
+    bool_matrix_free (problem->kernel, factor->n_rows * factor->n_cols -
+                                       factor->rank);
+  free (problem->solution);
+  free (problem->coeffs);
+  free (problem);
+}
+
+/*
+ * Eliminates a kernel vector by the constraint given as its products with
+ * the kernel vectors in coeffs and the residual of the current solution.
+ * The vectors of kernel are kept in the first n_kernel rows, the eliminated
+ * one is swapped to the end.
+ */
+static bool
+problem_eliminate (LightsoffProblem *problem,
+                   bool              residual)
+{
+  int     n_words = bool_array_n_words (problem->factor->n_rows *
+                                         problem->factor->n_cols);
+  int     last    = problem->n_kernel - 1;
+  int     pivot, i, k;
+  word_t *swap;
+
+  pivot = bool_array_next (problem->coeffs, problem->n_kernel, 0);
+  if (pivot < 0)
+    return !residual;
+
+  /* Satisfy the constraint by the pivot vector */
+  if (residual)
+    {
+      for (k = 0; k < n_words; k++)
+        problem->solution[k] ^= problem->kernel[pivot][k];
+    }
+
+  /* The other vectors of kernel are made orthogonal to the constraint */
+  for (i = bool_array_next (problem->coeffs, problem->n_kernel, pivot + 1);
+       i >= 0; i = bool_array_next (problem->coeffs, problem->n_kernel, i + 1))
+    {
+      for (k = 0; k < n_words; k++)
+        problem->kernel[i][k] ^= problem->kernel[pivot][k];
     }
+
+  swap = problem->kernel[pivot];
+  problem->kernel[pivot] = problem->kernel[last];
+  problem->kernel[last] = swap;
+  problem->n_kernel--;
+
+  return true;
+}
+
+/*
+ * Adds a constraint on the sum of clicks.
+ */
+bool
+lightsoff_problem_add (LightsoffProblem *problem,
+                       const word_t     *equation,
+                       bool              value)
+{
+  int    n_words  = bool_array_n_words (problem->factor->n_rows *
+                                        problem->factor->n_cols);
+  bool   residual = value;
+  int    i, k;
+  word_t word;
+
+  bool_array_clear (problem->coeffs, bool_array_n_words (problem->n_kernel + 1));
+
+  word = 0;
+  for (k = 0; k < n_words; k++)
+    word ^= equation[k] & problem->solution[k];
+  residual ^= bool_array_count (&word, 1) & 1;
+
+  for (i = 0; i < problem->n_kernel; i++)
+    {
+      word = 0;
+      for (k = 0; k < n_words; k++)
+        word ^= equation[k] & problem->kernel[i][k];
+      bool_array_set (problem->coeffs, i, bool_array_count (&word, 1) & 1);
+    }
+
+  return problem_eliminate (problem, residual);
+}
+
+/*
+ * Adds a constraint on the single click.
+ */
+bool
+lightsoff_problem_fix (LightsoffProblem *problem,
+                       int               row,
+                       int               col,
+                       bool              click)
+{
+  int index = problem->factor->n_cols * row + col;
+  int i;
+
+  if (row < 0 || row >= problem->factor->n_rows ||
+      col < 0 || col >= problem->factor->n_cols)
+    return false;
+
+  bool_array_clear (problem->coeffs, bool_array_n_words (problem->n_kernel + 1));
+  for (i = 0; i < problem->n_kernel; i++)
+    bool_array_set (problem->coeffs, i,
+                    bool_array_get (problem->kernel[i], index));
+
+  return problem_eliminate (problem,
+                            bool_array_get (problem->solution, index) != click);
+}
+
+/*
+ * Finds the solution with the minimum of ones under the constraints.
+ */
+word_t **
+lightsoff_problem_solve (const LightsoffProblem *problem,
+                         int                    *n_solutions,
+                         int                    *min_weight)
+{
+  int      n_rows   = problem->factor->n_rows;
+  int      n_cols   = problem->factor->n_cols;
+  int      n_words  = bool_array_n_words (n_rows * n_cols);
+  int      n_kernel = problem->n_kernel;
+  int      k;
+  word_t  *solution, *best;
+  word_t **result   = NULL;
+
+  *n_solutions = 0;
+  *min_weight = 0;
+
+  solution = bool_array_new (n_rows * n_cols);
+  best = bool_array_new (n_rows * n_cols);
+  if (solution != NULL && best != NULL)
+    {
+      memcpy (solution, problem->solution, n_words * sizeof *solution);
+      *min_weight = coset_lightest (solution, problem->kernel, n_kernel,
+                                    n_words, best, NULL);
+      if (n_kernel > LIGHTSOFF_MAX_NULLITY)
+        *min_weight = -1;
+
+      result = bool_matrix_new (n_rows, n_cols);
+      for (k = 0; k < n_rows && result != NULL; k++)
+        bool_array_move_bits (result[k], 0, best, n_cols * k, n_cols);
+      *n_solutions = result != NULL ? count_solutions (n_kernel) : 0;
+    }
+
+  free (solution);
+  free (best);
+
+  return result;
+}
+
+/*
+ * Counts prime^nullity solutions saturated at INT_MAX.
+ */
+static int
+count_mod_solutions (int prime,
+                     int nullity)
+{
+  int n_solutions = 1;
+
+  for (; nullity > 0 && n_solutions <= INT_MAX / prime; nullity--)
+    n_solutions *= prime;
+
+  return nullity > 0 ? INT_MAX : n_solutions;
+}
+
+/*
+ * Solves a puzzle of states modulo a prime. The coefficients are the ones of
+ * the boolean system, they are copied to the plane of ones by words.
+ */
+ModMatrix *
+lightsoff_mod_solve (const ModMatrix *field,
+                     Stencil          stencil,
+                     int             *n_solutions,
+                     int             *min_weight,
+                     Progress        *progress)
+{
+  int        prime    = field->prime;
+  int        n_rows   = field->n_rows;
+  int        n_cols   = field->n_cols;
+  int        n        = n_rows * n_cols;
+  int        rank     = -1;
+  ModMatrix *system   = NULL;
+  ModMatrix *result   = NULL;
+  uint8_t   *solution = NULL;
+  int       *pivots;
+  word_t   **ones;
+  int        i;
+
+  *n_solutions = 0;
+  *min_weight = 0;
+
+  profile_begin (PROFILE_CREATE_SYSTEM);
+  ones = bool_matrix_new (n, n + 1);
+  pivots = malloc (n * sizeof *pivots);
+  if (ones != NULL && pivots != NULL)
+    system = mod_matrix_new (prime, n, n + 1);
+
+  if (system != NULL)
+    {
+      stencil_fill_system (stencil, ones, n_rows, n_cols);
+      for (i = 0; i < n; i++)
+        {
+          mod_matrix_set_ones (system, i, ones[i]);
+          mod_matrix_set (system, i, n,
+                          (prime - mod_matrix_get (field, i / n_cols,
+                                                   i % n_cols)) % prime);
+        }
+    }
+  bool_matrix_free (ones, n);
+  profile_end (PROFILE_CREATE_SYSTEM);
+
+  if (system != NULL)
+    {
+      profile_begin (PROFILE_GAUSS);
+      rank = mod_gauss (system, pivots, progress);
+      profile_end (PROFILE_GAUSS);
+
+      profile_begin (PROFILE_SEARCH);
+      if (rank >= 0)
+        solution = mod_find_lightest (system, pivots, rank, min_weight,
+                                      progress);
+      profile_end (PROFILE_SEARCH);
+    }
+
+  if (solution != NULL)
+    result = mod_matrix_new (prime, n_rows, n_cols);
+
+  if (result != NULL)
+    {
+      for (i = 0; i < n; i++)
+        mod_matrix_set (result, i / n_cols, i % n_cols, solution[i]);
+      *n_solutions = count_mod_solutions (prime, n - rank);
+    }
+  else if (*min_weight < 0)
+    *n_solutions = count_mod_solutions (prime, n - rank);
+  else
+    *min_weight = 0;
+
+  mod_matrix_free (system);
+  free (solution);
+  free (pivots);
+
+  return result;
+}
+
+/*
+ * Sums the clicks of the cells, which toggle the cell. The stencils are
+ * symmetric, so these are the cells toggled by the cell.
+ */
+static int
+mod_clicks (const ModMatrix *solution,
+            int              row,
+            int              col,
+            Stencil          stencil)
+{
+  int cells[STENCIL_MAX_CELLS];
+  int n_cells, clicks = 0, i;
+
+  n_cells = stencil_cells (stencil, row, col, solution->n_rows,
+                           solution->n_cols, cells);
+  for (i = 0; i < n_cells; i++)
+    clicks += mod_matrix_get (solution, cells[i] / solution->n_cols,
+                              cells[i] % solution->n_cols);
+
+  return clicks;
+}
+
+/*
+ * Applies the clicks to the field of states.
+ */
+void
+lightsoff_mod_apply (ModMatrix       *field,
+                     const ModMatrix *solution,
+                     Stencil          stencil)
+{
+  int row, col;
+
+  for (row = 0; row < field->n_rows; row++)
+    {
+      for (col = 0; col < field->n_cols; col++)
+        mod_matrix_set (field, row, col,
+                        (mod_matrix_get (field, row, col) +
+                         mod_clicks (solution, row, col, stencil)) %
+                        field->prime);
+    }
+}
+
+/*
+ * Checks that the clicks turn all of the cells to zero.
+ */
+bool
+lightsoff_mod_verify (const ModMatrix *field,
+                      const ModMatrix *solution,
+                      Stencil          stencil)
+{
+  int row, col;
+
+  for (row = 0; row < field->n_rows; row++)
+    {
+      for (col = 0; col < field->n_cols; col++)
+        {
+          if ((mod_matrix_get (field, row, col) +
+               mod_clicks (solution, row, col, stencil)) % field->prime != 0)
+            return false;
+        }
+    }
+
+  return true;
 }
@@ -21,6 +21,12 @@
 #define LIGHTSOFF_SOLVER_H_
 
 #include "boolgauss.h"
+#include "modgauss.h"
+#include "stencil.h"
+
+/* Largest dimension of the kernel, which 2^nullity solutions are walked in a
+ * reasonable time, so they are enumerated or searched for the lightest one */
+#define LIGHTSOFF_MAX_NULLITY BOOL_GAUSS_MAX_FREE
 
 /**
  * SECTION: lightsoffsolver
@@ -29,29 +35,134 @@
  *
  * The program solves the puzzle Lights Off. It is a puzzle game, where the
  * objective is to turn off all of the tiles on the board. Each click toggles
- * the state of the clicked tile and its non-diagonal neighbors.
+ * the state of the clicked tile and its non-diagonal neighbors, or the cells
+ * of another #Stencil.
+ */
+
+/**
+ * LightsoffFactor:
+ * @n_rows:    Number of rows in the field
+ * @n_cols:    Number of columns in the field
+ * @stencil:   The neighbourhood of a click
+ * @rank:      The rank of system
+ * @order:     The cell of every variable of the gaussed system
+ * @transform: Row operations of the Gauss method as the boolean matrix
+ * @kernel:    The basis of the kernel of system, @n_rows * @n_cols - @rank
+ *             vectors by cells
+ *
+ * The factorized system of logical equations for the field of given size.
+ * It does not depend on the field state and can be reused for any field of
+ * the same size.
+ */
+typedef struct _LightsoffFactor LightsoffFactor;
+
+struct _LightsoffFactor
+{
+  int      n_rows;
+  int      n_cols;
+  Stencil  stencil;
+  int      rank;
+  int     *order;
+  word_t **transform;
+  word_t **kernel;
+};
+
+/**
+ * LightsoffIter:
+ * @factor:      The factorized system of the field size
+ * @solution:    The current solution as flat boolean array
+ * @index:       Number of solutions passed
+ * @n_solutions: Number of all solutions
+ *
+ * The enumeration of all solutions of a field in the Gray code order, so the
+ * next solution differs from the previous one by a vector of the kernel.
+ */
+typedef struct _LightsoffIter LightsoffIter;
+
+struct _LightsoffIter
+{
+  const LightsoffFactor *factor;
+  word_t                *solution;
+  uint64_t               index;
+  uint64_t               n_solutions;
+};
+
+/**
+ * LightsoffProblem:
+ * @factor:     The factorized system of the field size
+ * @n_kernel:   Number of vectors in the kernel under the constraints
+ * @solution:   A solution satisfying the constraints as flat boolean array
+ * @kernel:     The basis of solutions of the homogeneous constraints
+ * @coeffs:     Scratch of a constraint over the kernel vectors
+ *
+ * A field with extra linear constraints on the clicks. The constraints are
+ * added incrementally: every one cuts the coset of solutions in half by
+ * eliminating a vector of the kernel, the system is not gaussed again.
  */
+typedef struct _LightsoffProblem LightsoffProblem;
+
+struct _LightsoffProblem
+{
+  const LightsoffFactor *factor;
+  int                    n_kernel;
+  word_t                *solution;
+  word_t               **kernel;
+  word_t                *coeffs;
+};
 
 /**
  * lightsoff_solve:
  * @field:              The puzzle field as the boolean matrix
  * @n_rows:             Number of rows in the field
  * @n_cols:             Number of columns in the field
- * @n_solutions: (out): Number of all solutions
- * @min_weight:  (out): The weight of solution as number of ones
- * @progress_sign:      Shows progress bar
+ * @stencil:            The neighbourhood of a click
+ * @n_solutions: (out): Number of all solutions, %INT_MAX if there are more
+ * @min_weight:  (out): The weight of solution as number of ones, -1 if
+ *                      there are too many solutions to search
+ * @progress:           A progress to report and cancel the solve or %NULL
  *
  * Solves a puzzle Lights Off.
  * 
- * Returns: The solution as the boolean matrix
+ * Returns: The solution as the boolean matrix or %NULL if there is no one
+ * or the solve is cancelled
  **/
 word_t **
-lightsoff_solve (word_t **field,
-                 int      n_rows,
-                 int      n_cols,
-                 int     *n_solutions,
-                 int     *min_weight,
-                 bool     progress_sign);
+lightsoff_solve (word_t  **field,
+                 int       n_rows,
+                 int       n_cols,
+                 Stencil   stencil,
+                 int      *n_solutions,
+                 int      *min_weight,
+                 Progress *progress);
+
+/**
+ * lightsoff_solve_in:
+ * @arena:              An arena to allocate from or %NULL to allocate from heap
+ * @field:              The puzzle field as the boolean matrix
+ * @n_rows:             Number of rows in the field
+ * @n_cols:             Number of columns in the field
+ * @stencil:            The neighbourhood of a click
+ * @n_solutions: (out): Number of all solutions, %INT_MAX if there are more
+ * @min_weight:  (out): The weight of solution as number of ones, -1 if
+ *                      there are too many solutions to search
+ * @progress:           A progress to report and cancel the solve or %NULL
+ *
+ * Solves a puzzle Lights Off. The system, the temporaries and the solution
+ * are allocated from the arena, so a solve after arena_reset() of the same
+ * size does not call malloc. If there are more than %BOOL_GAUSS_MAX_FREE free
+ * variables, any solution is returned instead of the lightest one.
+ *
+ * Returns: The solution as the boolean matrix, released with the arena
+ **/
+word_t **
+lightsoff_solve_in (Arena    *arena,
+                    word_t  **field,
+                    int       n_rows,
+                    int       n_cols,
+                    Stencil   stencil,
+                    int      *n_solutions,
+                    int      *min_weight,
+                    Progress *progress);
 
 /**
  * lightsoff_apply:
@@ -59,13 +170,324 @@ lightsoff_solve (word_t **field,
  * @solution: The solution to apply as the boolean matrix
  * @n_rows:   Number of rows in the field
  * @n_cols:   Number of columns in the field
+ * @stencil:  The neighbourhood of a click
  * 
- * Applies the solution to the puzzle Lights Off field
+ * Applies the solution to the puzzle Lights Off field. Every row of clicks is
+ * calculated by whole words from three rows of the solution.
+ *
+ * Returns: %FALSE if out of memory, the field is not modified then
  **/
-void
+bool
 lightsoff_apply (word_t **field,
                  word_t **solution,
                  int      n_rows,
-                 int      n_cols);
+                 int      n_cols,
+                 Stencil  stencil);
+
+/**
+ * lightsoff_verify:
+ * @field:    The puzzle Lights Off field as the boolean matrix
+ * @solution: The solution to check as the boolean matrix
+ * @n_rows:   Number of rows in the field
+ * @n_cols:   Number of columns in the field
+ * @stencil:  The neighbourhood of a click
+ *
+ * Checks that the solution turns off all of the tiles of the field. The field
+ * is not modified.
+ *
+ * Returns: 1 if the solution solves the field, 0 if it does not or -1 if out
+ * of memory
+ **/
+int
+lightsoff_verify (word_t **field,
+                  word_t **solution,
+                  int      n_rows,
+                  int      n_cols,
+                  Stencil  stencil);
+
+/**
+ * lightsoff_factor_new:
+ * @n_rows:        Number of rows in the field
+ * @n_cols:        Number of columns in the field
+ * @stencil:       The neighbourhood of a click
+ * @progress:      A progress to report and cancel the Gauss method or %NULL
+ *
+ * Factorizes the system of logical equations for the field of given size.
+ *
+ * Returns: The factorized system or %NULL if out of memory or cancelled
+ **/
+LightsoffFactor *
+lightsoff_factor_new (int       n_rows,
+                      int       n_cols,
+                      Stencil   stencil,
+                      Progress *progress);
+
+/**
+ * lightsoff_factor_free:
+ * @factor: The factorized system
+ *
+ * Releases a factorized system.
+ **/
+void
+lightsoff_factor_free (LightsoffFactor *factor);
+
+/**
+ * lightsoff_factor_solve:
+ * @factor:             The factorized system
+ * @field:              The puzzle field of the factor size as the boolean matrix
+ * @n_solutions: (out): Number of all solutions, %INT_MAX if there are more
+ * @min_weight:  (out): The weight of solution as number of ones, -1 if
+ *                      there are too many solutions to search
+ *
+ * Solves a puzzle Lights Off with the factorized system. The factor is not
+ * modified, so it can be shared between threads.
+ *
+ * Returns: The solution as the boolean matrix or %NULL if there is no one
+ **/
+word_t **
+lightsoff_factor_solve (const LightsoffFactor *factor,
+                        word_t               **field,
+                        int                   *n_solutions,
+                        int                   *min_weight);
+
+/**
+ * lightsoff_factor_solve_in:
+ * @arena:              An arena to allocate from or %NULL to allocate from heap
+ * @factor:             The factorized system
+ * @field:              The puzzle field of the factor size as the boolean matrix
+ * @n_solutions: (out): Number of all solutions, %INT_MAX if there are more
+ * @min_weight:  (out): The weight of solution as number of ones, -1 if
+ *                      there are too many solutions to search
+ * @progress:           A progress to report and cancel the search or %NULL
+ *
+ * Solves a puzzle Lights Off with the factorized system. The temporaries and
+ * the solution are allocated from the arena. If the kernel has more than
+ * %LIGHTSOFF_MAX_NULLITY dimensions, the coset is not searched and the
+ * particular solution is returned instead of the lightest one.
+ *
+ * Returns: The solution as the boolean matrix, released with the arena, or
+ * %NULL if there is no one or the search is cancelled
+ **/
+word_t **
+lightsoff_factor_solve_in (Arena                 *arena,
+                           const LightsoffFactor *factor,
+                           word_t               **field,
+                           int                   *n_solutions,
+                           int                   *min_weight,
+                           Progress              *progress);
+
+/**
+ * lightsoff_iter_new:
+ * @factor: The factorized system
+ * @field:  The puzzle field of the factor size as the boolean matrix
+ *
+ * Starts the enumeration of all solutions of the field. The factor must
+ * outlive the enumeration. The kernel of more than %LIGHTSOFF_MAX_NULLITY
+ * dimensions is not enumerated, the caller may check the nullity of @factor
+ * before.
+ *
+ * Returns: The enumeration or %NULL if there is no solution, there are too
+ * many solutions or out of memory
+ **/
+LightsoffIter *
+lightsoff_iter_new (const LightsoffFactor *factor,
+                    word_t               **field);
+
+/**
+ * lightsoff_iter_next:
+ * @iter:            The enumeration
+ * @solution: (out): The boolean matrix of the field size for the solution
+ * @weight:   (out): The weight of solution or %NULL
+ *
+ * Gets the next solution of the enumeration.
+ *
+ * Returns: %FALSE if all solutions are passed
+ **/
+bool
+lightsoff_iter_next (LightsoffIter *iter,
+                     word_t       **solution,
+                     int           *weight);
+
+/**
+ * lightsoff_iter_free:
+ * @iter: The enumeration
+ *
+ * Releases the enumeration.
+ **/
+void
+lightsoff_iter_free (LightsoffIter *iter);
+
+/**
+ * lightsoff_factor_lightest:
+ * @factor:           The factorized system
+ * @field:            The puzzle field of the factor size as the boolean matrix
+ * @k:                Number of solutions to find
+ * @n_found:   (out): Number of found solutions, less than @k if there are
+ *                    no more
+ * @weights:   (out): Array of @k weights of the solutions
+ * @progress:         A progress to report and cancel the search or %NULL
+ *
+ * Finds the @k lightest solutions of the field. All solutions are enumerated
+ * once, the lightest are kept in a heap of @k solutions. The equal weights
+ * are ordered as lightsoff_factor_solve() prefers, so the first solution is
+ * the one it returns.
+ *
+ * Returns: Array of solutions from the lightest, released by
+ * lightsoff_solutions_free(), or %NULL if there is no one, the kernel has
+ * more than %LIGHTSOFF_MAX_NULLITY dimensions or the search is cancelled
+ **/
+word_t ***
+lightsoff_factor_lightest (const LightsoffFactor *factor,
+                           word_t               **field,
+                           int                    k,
+                           int                   *n_found,
+                           int                   *weights,
+                           Progress              *progress);
+
+/**
+ * lightsoff_solutions_free:
+ * @solutions:   Array of solutions
+ * @n_solutions: Number of solutions
+ * @n_rows:      Number of rows in the field
+ *
+ * Releases the array of solutions.
+ **/
+void
+lightsoff_solutions_free (word_t ***solutions,
+                          int       n_solutions,
+                          int       n_rows);
+
+/**
+ * lightsoff_problem_new:
+ * @factor: The factorized system
+ * @field:  The puzzle field of the factor size as the boolean matrix
+ *
+ * Creates a problem of the field without constraints. The factor must
+ * outlive the problem.
+ *
+ * Returns: The problem or %NULL if the field has no solution or out of memory
+ **/
+LightsoffProblem *
+lightsoff_problem_new (const LightsoffFactor *factor,
+                       word_t               **field);
+
+/**
+ * lightsoff_problem_free:
+ * @problem: The problem
+ *
+ * Releases a problem.
+ **/
+void
+lightsoff_problem_free (LightsoffProblem *problem);
+
+/**
+ * lightsoff_problem_add:
+ * @problem:  The problem
+ * @equation: Flat boolean array of the clicks in the equation, the click of
+ *            row and column is @n_cols * row + column
+ * @value:    The right part of equation, the parity of the clicks
+ *
+ * Adds a constraint, that the sum of clicks of @equation is @value. It takes
+ * a dot product with every vector of the kernel. A contradicting constraint
+ * is not added.
+ *
+ * Returns: %FALSE if the constraint contradicts the previous ones
+ **/
+bool
+lightsoff_problem_add (LightsoffProblem *problem,
+                       const word_t     *equation,
+                       bool              value);
+
+/**
+ * lightsoff_problem_fix:
+ * @problem: The problem
+ * @row:     Row of the click
+ * @col:     Column of the click
+ * @click:   %TRUE to force the click, %FALSE to forbid it
+ *
+ * Adds a constraint on the single click. It takes a bit of every vector of
+ * the kernel. A contradicting constraint or a cell out of the field is not
+ * added.
+ *
+ * Returns: %FALSE if the cell is out of the field or the constraint
+ * contradicts the previous ones
+ **/
+bool
+lightsoff_problem_fix (LightsoffProblem *problem,
+                       int               row,
+                       int               col,
+                       bool              click);
+
+/**
+ * lightsoff_problem_solve:
+ * @problem:            The problem
+ * @n_solutions: (out): Number of solutions under the constraints, %INT_MAX
+ *                      if there are more
+ * @min_weight:  (out): The weight of solution as number of ones, -1 if
+ *                      there are too many solutions to search
+ *
+ * Finds the solution with the minimum of ones under the constraints by
+ * walking the remaining coset. If the remaining kernel has more than
+ * %LIGHTSOFF_MAX_NULLITY dimensions, the particular solution is returned.
+ *
+ * Returns: The solution as the boolean matrix or %NULL if out of memory
+ **/
+word_t **
+lightsoff_problem_solve (const LightsoffProblem *problem,
+                         int                    *n_solutions,
+                         int                    *min_weight);
+
+/**
+ * lightsoff_mod_solve:
+ * @field:              The puzzle field as the matrix of states modulo a prime
+ * @stencil:            The neighbourhood of a click
+ * @n_solutions: (out): Number of all solutions, %INT_MAX if there are more
+ * @min_weight:  (out): The number of clicks of solution
+ * @progress:           A progress to report and cancel the solve or %NULL
+ *
+ * Solves a puzzle, where a click cycles the states of the cell and its
+ * neighbors 0, 1, ..., prime - 1, 0. The solution turns all of the cells to
+ * zero by the least number of clicks. If there are more than
+ * %MOD_GAUSS_MAX_CANDIDATES solutions, they are not searched and @min_weight
+ * is -1.
+ *
+ * Returns: The clicks of cells as the matrix of the field size or %NULL if
+ * there is no solution, too many of them or the solve is cancelled
+ **/
+ModMatrix *
+lightsoff_mod_solve (const ModMatrix *field,
+                     Stencil          stencil,
+                     int             *n_solutions,
+                     int             *min_weight,
+                     Progress        *progress);
+
+/**
+ * lightsoff_mod_apply:
+ * @field:    The puzzle field to apply solution as the matrix of states
+ * @solution: The clicks of cells as the matrix of the field size
+ * @stencil:  The neighbourhood of a click
+ *
+ * Applies the clicks to the field of states.
+ **/
+void
+lightsoff_mod_apply (ModMatrix       *field,
+                     const ModMatrix *solution,
+                     Stencil          stencil);
+
+/**
+ * lightsoff_mod_verify:
+ * @field:    The puzzle field as the matrix of states
+ * @solution: The clicks of cells as the matrix of the field size
+ * @stencil:  The neighbourhood of a click
+ *
+ * Checks that the clicks turn all of the cells to zero. The field is not
+ * modified.
+ *
+ * Returns: %TRUE if the solution solves the field
+ **/
+bool
+lightsoff_mod_verify (const ModMatrix *field,
+                      const ModMatrix *solution,
+                      Stencil          stencil);
 
 #endif
@@ -21,9 +21,14 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
-#include <gdk-pixbuf/gdk-pixbuf.h>
+#include <inttypes.h>
+#include <signal.h>
 #include <time.h>
+#include <unistd.h>
 #include "lightsoffsolver.h"
+#include "pngimage.h"
+#include "profile.h"
+#include "solverd.h"
 
 /*
  * Prints usage into console. 
@@ -42,9 +47,26 @@ print_usage (char *program_name)
           "<Switches>\n"
           "  -r4 : number of rows in the field of ones\n"
           "  -c5 : number of columns in the field of ones\n"
-          "  -p  : create image of solution to file \"lightsoff_4x5.png\"\n"
+          "  -p8 : create image of solution to file \"lightsoff_4x5.png\", 8 pixels per cell\n"
           "  -a  : apply solution to field of ones\n"
+          "  -ffield.txt : read field from file: text, PBM image, click list, run lengths\n"
+          "                or binary\n"
+          "  -osolution.los : save solution or applied field to file\n"
+          "  -mtext : output format: text, los (binary), pbm (P4 image), p1 (plain image),\n"
+          "           clicks (list of row and column), rle (run lengths of rows)\n"
           "  -i  : print info: field size, number of solutions, weight of solution, time\n"
+          "  -v  : verify solution by applying it to the field\n"
+          "  -e  : write all solutions in the Gray code order, as click lists by default\n"
+          "  -k5 : write 5 lightest solutions, as click lists by default\n"
+          "  -n2,3 : never click the cell of row 2 and column 3 counting from 0\n"
+          "  -y2,3 : always click the cell of row 2 and column 3 counting from 0\n"
+          "  -jprofile.json : write time and counters of the phases of solving as JSON\n"
+          "  -ttrace.json : write the phases of solving as Chrome trace events\n"
+          "  -d/tmp/los.sock : serve solve requests on the Unix domain socket\n"
+          "  -w4 : number of worker threads of the daemon, by processors if no one\n"
+          "  -l10 : cancel a solve or a request of the daemon after 10 seconds\n"
+          "  -s3 : number of states of a cell cycled by a click: 2, 3, 5 or 7\n"
+          "  -gking : cells toggled by a click: plus, cross, king or torus\n"
           "  -h  : print this help\n",
           program_name);
 }
@@ -59,7 +81,7 @@ create_field (int n_rows,
   word_t **field = bool_matrix_new (n_rows, n_cols);
   int      i, j;
 
-  for (i = 0; i < n_rows; i++)
+  for (i = 0; i < n_rows && field != NULL; i++)
     {
       for (j = 0; j < n_cols; j++)
         bool_array_set (field[i], j, true);
@@ -69,45 +91,463 @@ create_field (int n_rows,
 }
 
 /*
- * Converts a boolean matrix to image as #GdkPixbuf.
+ * Formats of the solution output.
  */
-static GdkPixbuf *
-bool_matrix_image (word_t **matrix,
-                   int      n_rows,
-                   int      n_cols)
+typedef enum
 {
-  int x, y, rowstride, n_channels;
-  guchar *pixels, *p;
-  GdkPixbuf *pixbuf;
+  OUTPUT_DEFAULT,
+  OUTPUT_TEXT,
+  OUTPUT_BINARY,
+  OUTPUT_PBM,
+  OUTPUT_PLAIN_PBM,
+  OUTPUT_CLICKS,
+  OUTPUT_RLE
+} OutputFormat;
 
-  pixbuf     = gdk_pixbuf_new (GDK_COLORSPACE_RGB, TRUE, 8, n_cols, n_rows);
-  pixels     = gdk_pixbuf_get_pixels (pixbuf);
-  rowstride  = gdk_pixbuf_get_rowstride (pixbuf);
-  n_channels = gdk_pixbuf_get_n_channels (pixbuf);
+/* The progress of solve, cancelled by the interrupt signal */
+static Progress *solve_progress = NULL;
 
-  for (y = 0; y < n_rows; y++)
+/*
+ * Parses the name of output format. Returns %OUTPUT_DEFAULT if unknown.
+ */
+static OutputFormat
+parse_output_format (const char *name)
+{
+  if (strcmp (name, "text") == 0)
+    return OUTPUT_TEXT;
+  if (strcmp (name, "los") == 0)
+    return OUTPUT_BINARY;
+  if (strcmp (name, "pbm") == 0)
+    return OUTPUT_PBM;
+  if (strcmp (name, "p1") == 0)
+    return OUTPUT_PLAIN_PBM;
+  if (strcmp (name, "clicks") == 0)
+    return OUTPUT_CLICKS;
+  if (strcmp (name, "rle") == 0)
+    return OUTPUT_RLE;
+
+  return OUTPUT_DEFAULT;
+}
+
+/*
+ * Writes a boolean matrix to a stream in the format, except binary.
+ */
+static bool
+write_matrix (FILE        *stream,
+              word_t     **matrix,
+              int          n_rows,
+              int          n_cols,
+              OutputFormat format)
+{
+  if (format == OUTPUT_TEXT)
+    return bool_matrix_write_text (stream, matrix, n_rows, n_cols);
+  if (format == OUTPUT_CLICKS)
+    return bool_matrix_write_clicks (stream, matrix, n_rows, n_cols);
+  if (format == OUTPUT_RLE)
+    return bool_matrix_write_rle (stream, matrix, n_rows, n_cols);
+
+  return bool_matrix_write_pbm (stream, matrix, n_rows, n_cols,
+                                format == OUTPUT_PBM);
+}
+
+/*
+ * Prints a boolean matrix into console or writes it to file in the format.
+ * The default format is text for console and is chosen by the extension for
+ * a file: ".pbm" is PBM image, ".txt" is text, others are binary.
+ */
+static void
+output_matrix (word_t     **matrix,
+               int          n_rows,
+               int          n_cols,
+               OutputFormat format,
+               const char  *output_name)
+{
+  const char *ext    = output_name != NULL ? strrchr (output_name, '.') : NULL;
+  FILE       *stream = stdout;
+  bool        success;
+
+  if (format == OUTPUT_DEFAULT && ext != NULL && strcmp (ext, ".pbm") == 0)
+    format = OUTPUT_PBM;
+  else if (format == OUTPUT_DEFAULT && ext != NULL && strcmp (ext, ".txt") == 0)
+    format = OUTPUT_TEXT;
+  else if (format == OUTPUT_DEFAULT)
+    format = output_name != NULL ? OUTPUT_BINARY : OUTPUT_TEXT;
+
+  if (format == OUTPUT_TEXT && output_name == NULL)
+    {
+      bool_matrix_print (matrix, n_rows, n_cols);
+      return;
+    }
+
+  if (format == OUTPUT_BINARY)
+    {
+      if (output_name == NULL)
+        fprintf (stderr, "Binary output requires a file name\n");
+      else if (!bool_matrix_save (output_name, matrix, n_rows, n_cols))
+        fprintf (stderr, "Unable to save file: %s\n", output_name);
+      return;
+    }
+
+  if (output_name != NULL)
+    stream = fopen (output_name, "wb");
+
+  if (stream == NULL)
     {
-      for (x = 0; x < n_cols; x++)
+      perror (output_name);
+      return;
+    }
+
+  success = write_matrix (stream, matrix, n_rows, n_cols, format);
+
+  if (output_name != NULL && fclose (stream) != 0)
+    success = false;
+
+  if (!success)
+    fprintf (stderr, "Unable to save file: %s\n",
+             output_name != NULL ? output_name : "stdout");
+}
+
+/*
+ * Streams all solutions of the field or the @k lightest of them to console
+ * or file. The solutions are written as click lists by default, the text
+ * ones are separated by empty lines. Returns the number of solutions or -1
+ * if there are too many to enumerate or search.
+ */
+static int
+output_solutions (word_t     **field,
+                  int          n_rows,
+                  int          n_cols,
+                  Stencil      stencil,
+                  int          k,
+                  OutputFormat format,
+                  const char  *output_name,
+                  Progress    *progress)
+{
+  LightsoffFactor *factor;
+  LightsoffIter   *iter      = NULL;
+  word_t        ***lightest  = NULL;
+  word_t         **solution  = NULL;
+  int             *weights   = NULL;
+  FILE            *stream    = stdout;
+  bool             success   = true;
+  int              n_written = 0;
+
+  if (format == OUTPUT_DEFAULT || format == OUTPUT_BINARY)
+    format = OUTPUT_CLICKS;
+
+  factor = lightsoff_factor_new (n_rows, n_cols, stencil, progress);
+  if (factor == NULL)
+    return 0;
+
+  if (n_rows * n_cols - factor->rank > LIGHTSOFF_MAX_NULLITY)
+    {
+      fprintf (stderr, "Too many solutions to %s: 2^%i\n",
+               k > 0 ? "search" : "enumerate", n_rows * n_cols - factor->rank);
+      lightsoff_factor_free (factor);
+      return -1;
+    }
+
+  if (k > 0)
+    {
+      weights = malloc (k * sizeof *weights);
+      if (weights != NULL)
+        lightest = lightsoff_factor_lightest (factor, field, k, &k, weights,
+                                              progress);
+    }
+  else
+    {
+      iter = lightsoff_iter_new (factor, field);
+      solution = bool_matrix_new (n_rows, n_cols);
+    }
+
+  if (output_name != NULL)
+    stream = fopen (output_name, "wb");
+
+  profile_begin (PROFILE_OUTPUT);
+  if (stream == NULL)
+    perror (output_name);
+  else if (lightest != NULL)
+    {
+      for (; n_written < k && success; n_written++)
+        success = write_matrix (stream, lightest[n_written], n_rows, n_cols,
+                                format) &&
+                  (format != OUTPUT_TEXT || putc ('\n', stream) != EOF);
+    }
+  else if (iter != NULL && solution != NULL)
+    {
+      while (success && !progress_cancelled (progress) &&
+             lightsoff_iter_next (iter, solution, NULL))
         {
-          p = pixels + rowstride * y + n_channels * x;
-          if (bool_array_get (matrix[y], x))
-            {
-              p[0] = 50;
-              p[1] = 99;
-              p[2] = 183;
-              p[3] = 255;
-            }
-          else
-            {
-              p[0] = 226;
-              p[1] = 224;
-              p[2] = 233;
-              p[3] = 255;
-            }
+          success = write_matrix (stream, solution, n_rows, n_cols, format) &&
+                    (format != OUTPUT_TEXT || putc ('\n', stream) != EOF);
+          n_written++;
         }
     }
 
-  return pixbuf;
+  if (stream != NULL && output_name != NULL && fclose (stream) != 0)
+    success = false;
+  profile_end (PROFILE_OUTPUT);
+
+  if (stream != NULL && !success)
+    fprintf (stderr, "Unable to save file: %s\n",
+             output_name != NULL ? output_name : "stdout");
+
+  lightsoff_solutions_free (lightest, k, n_rows);
+  lightsoff_iter_free (iter);
+  bool_matrix_free (solution, n_rows);
+  lightsoff_factor_free (factor);
+  free (weights);
+
+  return n_written;
+}
+
+/*
+ * Solves the field with the clicks fixed by triples of row, column and the
+ * click value. A fix out of the field or contradicting the previous ones is
+ * reported and skipped.
+ */
+static word_t **
+solve_constrained (word_t    **field,
+                   int         n_rows,
+                   int         n_cols,
+                   Stencil     stencil,
+                   const int  *fixes,
+                   int         n_fixes,
+                   int        *n_solutions,
+                   int        *weight,
+                   Progress   *progress)
+{
+  LightsoffFactor  *factor;
+  LightsoffProblem *problem  = NULL;
+  word_t          **solution = NULL;
+  const int        *fix;
+  int               i;
+
+  *n_solutions = 0;
+  *weight = 0;
+
+  factor = lightsoff_factor_new (n_rows, n_cols, stencil, progress);
+  if (factor != NULL)
+    problem = lightsoff_problem_new (factor, field);
+
+  for (i = 0; i < n_fixes && problem != NULL; i++)
+    {
+      fix = fixes + 3 * i;
+      if (fix[0] < 0 || fix[0] >= n_rows || fix[1] < 0 || fix[1] >= n_cols)
+        fprintf (stderr, "Click %i,%i is out of the field\n", fix[0], fix[1]);
+      else if (!lightsoff_problem_fix (problem, fix[0], fix[1], fix[2]))
+        fprintf (stderr, "Click %i,%i can not be %s, the constraint is skipped\n",
+                 fix[0], fix[1], fix[2] ? "forced" : "forbidden");
+    }
+
+  if (problem != NULL)
+    solution = lightsoff_problem_solve (problem, n_solutions, weight);
+
+  lightsoff_problem_free (problem);
+  lightsoff_factor_free (factor);
+
+  return solution;
+}
+
+/*
+ * Writes the profile as JSON summary and as Chrome trace to the files, which
+ * are given.
+ */
+static void
+write_profile (const char *json_name,
+               const char *trace_name)
+{
+  FILE *stream;
+  bool  success;
+  int   i;
+
+  for (i = 0; i < 2; i++)
+    {
+      const char *name = i == 0 ? json_name : trace_name;
+
+      if (name == NULL)
+        continue;
+
+      stream = fopen (name, "w");
+      if (stream == NULL)
+        {
+          perror (name);
+          continue;
+        }
+
+      success = i == 0 ? profile_write_json (stream) :
+                         profile_write_trace (stream);
+      if (fclose (stream) != 0 || !success)
+        fprintf (stderr, "Unable to save file: %s\n", name);
+    }
+}
+
+/*
+ * Creates a field of ones of states modulo a prime or reads it as digits.
+ */
+static ModMatrix *
+read_states (int         prime,
+             int         n_rows,
+             int         n_cols,
+             const char *input_name)
+{
+  ModMatrix *field;
+  FILE      *input = stdin;
+  int        row, col;
+
+  if (n_rows > 0 && n_cols > 0)
+    {
+      field = mod_matrix_new (prime, n_rows, n_cols);
+      for (row = 0; row < n_rows && field != NULL; row++)
+        {
+          for (col = 0; col < n_cols; col++)
+            mod_matrix_set (field, row, col, 1);
+        }
+      return field;
+    }
+
+  if (input_name != NULL)
+    input = fopen (input_name, "r");
+
+  if (input == NULL)
+    {
+      perror (input_name);
+      return NULL;
+    }
+
+  field = mod_matrix_read (input, prime);
+  if (input != stdin)
+    fclose (input);
+
+  return field;
+}
+
+/*
+ * Solves a puzzle, where a cell has more than two states, or applies the
+ * clicks to the field of ones. The matrices are written as digits.
+ */
+static int
+solve_states (int         prime,
+              int         n_rows,
+              int         n_cols,
+              Stencil     stencil,
+              const char *input_name,
+              const char *output_name,
+              bool        apply_mode,
+              bool        verify,
+              bool        print_info)
+{
+  ModMatrix *field;
+  ModMatrix *solution    = NULL;
+  FILE      *stream      = stdout;
+  int        status      = EXIT_SUCCESS;
+  int        n_solutions = 0;
+  int        weight      = 0;
+  clock_t    start       = 0;
+  clock_t    end         = 0;
+
+  profile_begin (PROFILE_PARSE);
+  field = read_states (prime, n_rows, n_cols, input_name);
+  profile_end (PROFILE_PARSE);
+  if (field == NULL)
+    return EXIT_FAILURE;
+
+  /* The input is the clicks to apply to the field of ones */
+  if (apply_mode)
+    {
+      solution = field;
+      field = read_states (prime, solution->n_rows, solution->n_cols, NULL);
+      if (field == NULL)
+        {
+          mod_matrix_free (solution);
+          return EXIT_FAILURE;
+        }
+      lightsoff_mod_apply (field, solution, stencil);
+    }
+  else
+    {
+      start = clock ();
+      progress_start (solve_progress);
+      solution = lightsoff_mod_solve (field, stencil, &n_solutions, &weight,
+                                      solve_progress);
+      progress_stop (solve_progress);
+      end = clock ();
+    }
+
+  profile_begin (PROFILE_OUTPUT);
+  if (output_name != NULL)
+    stream = fopen (output_name, "w");
+
+  if (progress_cancelled (solve_progress))
+    {
+      fprintf (stderr, "Solving is cancelled\n");
+      status = EXIT_FAILURE;
+    }
+  else if (!apply_mode && solution == NULL && weight < 0)
+    {
+      fprintf (stderr, "Too many solutions to search: over %" PRIu64 "\n",
+               MOD_GAUSS_MAX_CANDIDATES);
+      status = EXIT_FAILURE;
+    }
+  else if (!apply_mode && solution == NULL)
+    printf ("0\n\n");
+  else if (stream == NULL ||
+           !mod_matrix_write_text (stream, apply_mode ? field : solution))
+    {
+      fprintf (stderr, "Unable to save file: %s\n", output_name);
+      status = EXIT_FAILURE;
+    }
+
+  if (stream != NULL && stream != stdout)
+    fclose (stream);
+  profile_end (PROFILE_OUTPUT);
+
+  if (!apply_mode && verify && solution != NULL &&
+      !lightsoff_mod_verify (field, solution, stencil))
+    {
+      fprintf (stderr, "Verification failed\n");
+      status = EXIT_FAILURE;
+    }
+
+  if (!apply_mode && print_info)
+    {
+      printf ("\nSize      : %i x %i\n", field->n_rows, field->n_cols);
+      printf ("States    : %i\n",      prime);
+      printf ("Solutions : %i\n",      n_solutions);
+      printf ("Weight    : %i\n",      weight);
+      printf ("Time      : %ld\n",     end - start);
+    }
+
+  mod_matrix_free (field);
+  mod_matrix_free (solution);
+
+  return status;
+}
+
+/*
+ * Cancels the running solve on interrupt, so the profile is still written.
+ * The next interrupt terminates the program.
+ */
+static void
+cancel_solve (int signum)
+{
+  progress_cancel (solve_progress);
+  signal (signum, SIG_DFL);
+}
+
+/*
+ * Releases a boolean matrix, which may be mapped from binary file.
+ */
+static void
+release_matrix (word_t **matrix,
+                word_t **mapped,
+                int      n_rows,
+                int      n_cols)
+{
+  if (matrix != NULL && matrix == mapped)
+    bool_matrix_unload (matrix, n_rows, n_cols);
+  else if (matrix != NULL)
+    bool_matrix_free (matrix, n_rows);
 }
 
 /*
@@ -117,20 +557,39 @@ int
 main (int    argc,
       char **argv)
 {
-  bool       print_info   = false;
-  bool       apply_mode   = false;
-  bool       create_image = false;
-  int        n_rows       = 0;
-  int        n_cols       = 0;
-  int        n_solutions  = 0;
-  int        weight       = 0;
-  word_t   **field        = NULL;
-  word_t   **solution     = NULL;
-  GError    *error        = NULL;
-  GdkPixbuf *image        = NULL;
-  char      *filename     = malloc (64);
-  int        optind;
-  clock_t    start, end;
+  bool           print_info   = false;
+  bool           apply_mode   = false;
+  bool           create_image = false;
+  bool           verify       = false;
+  int            verified     = 0;
+  bool           enumerate    = false;
+  int            n_lightest   = 0;
+  int           *fixes        = malloc (3 * argc * sizeof *fixes);
+  int            n_fixes      = 0;
+  int            status       = EXIT_SUCCESS;
+  int            n_rows       = 0;
+  int            n_cols       = 0;
+  int            n_solutions  = 0;
+  int            weight       = 0;
+  word_t       **field        = NULL;
+  word_t       **solution     = NULL;
+  word_t       **mapped       = NULL;
+  FILE          *input        = stdin;
+  char          *input_name   = NULL;
+  char          *output_name  = NULL;
+  OutputFormat   format       = OUTPUT_DEFAULT;
+  FILE          *image        = NULL;
+  int            scale        = 1;
+  char          *filename     = malloc (64);
+  char          *socket_path  = NULL;
+  char          *json_name    = NULL;
+  char          *trace_name   = NULL;
+  int            n_workers    = sysconf (_SC_NPROCESSORS_ONLN);
+  int            n_states     = 2;
+  Stencil        stencil      = STENCIL_PLUS;
+  double         time_limit   = 0;
+  int            optind;
+  clock_t        start, end;
 
   /* Reading command line arguments */
   for (optind = 1; optind < argc && argv[optind][0] == '-'; optind++)
@@ -145,6 +604,8 @@ main (int    argc,
           break;
         case 'p':
           create_image = true;
+          if (argv[optind][2] != '\0')
+            scale = atoi (&(argv[optind][2]));
           break;
         case 'a':
           apply_mode = true;
@@ -152,6 +613,73 @@ main (int    argc,
         case 'i':
           print_info = true;
           break;
+        case 'v':
+          verify = true;
+          break;
+        case 'e':
+          enumerate = true;
+          break;
+        case 'n':
+        case 'y':
+          if (fixes == NULL ||
+              sscanf (&(argv[optind][2]), "%i,%i", &fixes[3 * n_fixes],
+                      &fixes[3 * n_fixes + 1]) != 2)
+            {
+              print_usage (argv[0]);
+              exit (EXIT_FAILURE);
+            }
+          fixes[3 * n_fixes + 2] = argv[optind][1] == 'y';
+          n_fixes++;
+          break;
+        case 'k':
+          n_lightest = atoi (&(argv[optind][2]));
+          if (n_lightest < 1)
+            {
+              print_usage (argv[0]);
+              exit (EXIT_FAILURE);
+            }
+          break;
+        case 'f':
+          input_name = &(argv[optind][2]);
+          break;
+        case 'o':
+          output_name = &(argv[optind][2]);
+          break;
+        case 'm':
+          format = parse_output_format (&(argv[optind][2]));
+          if (format == OUTPUT_DEFAULT)
+            {
+              print_usage (argv[0]);
+              exit (EXIT_FAILURE);
+            }
+          break;
+        case 'g':
+          if (!stencil_parse (&(argv[optind][2]), &stencil))
+            {
+              print_usage (argv[0]);
+              exit (EXIT_FAILURE);
+            }
+          break;
+        case 'd':
+          socket_path = &(argv[optind][2]);
+          break;
+        case 'j':
+          json_name = &(argv[optind][2]);
+          profile_enable ();
+          break;
+        case 't':
+          trace_name = &(argv[optind][2]);
+          profile_enable ();
+          break;
+        case 'w':
+          n_workers = atoi (&(argv[optind][2]));
+          break;
+        case 'l':
+          time_limit = atof (&(argv[optind][2]));
+          break;
+        case 's':
+          n_states = atoi (&(argv[optind][2]));
+          break;
         case 'h':
           print_usage (argv[0]);
           exit (EXIT_SUCCESS);
@@ -162,6 +690,27 @@ main (int    argc,
         }
     }
 
+  /* The constraints apply to a single solve of two states only */
+  if (n_fixes > 0 && (apply_mode || enumerate || n_lightest > 0 ||
+                      n_states != 2 || socket_path != NULL))
+    {
+      fprintf (stderr, "Switches -n and -y do not work with -a, -e, -k, -s "
+                       "or -d\n");
+      free (filename);
+      free (fixes);
+      exit (EXIT_FAILURE);
+    }
+
+  /* Serve solve requests until an error */
+  if (socket_path != NULL)
+    {
+      free (filename);
+      free (fixes);
+      solverd_run (socket_path, n_workers, time_limit);
+      write_profile (json_name, trace_name);
+      exit (EXIT_FAILURE);
+    }
+
   /* Setup square field if one of size is present */
   if (n_rows == 0 && n_cols > 0)
     n_rows = n_cols;
@@ -169,36 +718,144 @@ main (int    argc,
   if (n_cols == 0 && n_rows > 0)
     n_cols = n_rows;
 
+  /* The progress bar is shown with info, the interrupt cancels the solve */
+  solve_progress = progress_new (print_info ? progress_print : NULL, NULL);
+  if (solve_progress == NULL)
+    exit (EXIT_FAILURE);
+  progress_set_limit (solve_progress, time_limit);
+  signal (SIGINT, cancel_solve);
+
+  /* Cells of more than two states are solved modulo a prime */
+  if (n_states != 2)
+    {
+      if (mod_prime_supported (n_states))
+        status = solve_states (n_states, n_rows, n_cols, stencil, input_name,
+                               output_name, apply_mode, verify, print_info);
+      else
+        {
+          fprintf (stderr, "Number of states must be 2, 3, 5 or 7\n");
+          status = EXIT_FAILURE;
+        }
+
+      write_profile (json_name, trace_name);
+      free (filename);
+      free (fixes);
+      signal (SIGINT, SIG_DFL);
+      progress_free (solve_progress);
+
+      return status;
+    }
+
   /* Construct the field */
+  profile_begin (PROFILE_PARSE);
   if (n_rows > 0 && n_cols > 0)
     {
       field = create_field (n_rows, n_cols);
+      if (field == NULL)
+        exit (EXIT_FAILURE);
+    }
+  /* Map the board state from the binary file */
+  else if (input_name != NULL && bool_matrix_is_binary (input_name))
+    {
+      field = mapped = bool_matrix_load (input_name, &n_rows, &n_cols);
+      if (field == NULL)
+        exit (EXIT_FAILURE);
     }
   /* Read the board state from the console to the Bool matrix */
   else
     {
-      field = bool_matrix_read (stdin, &n_rows, &n_cols);
+      if (input_name != NULL)
+        input = fopen (input_name, "r");
+
+      if (input == NULL)
+        {
+          perror (input_name);
+          exit (EXIT_FAILURE);
+        }
+
+      field = bool_matrix_read (input, &n_rows, &n_cols);
+      if (input != stdin)
+        fclose (input);
+
       if (field == NULL)
         {
           print_usage (argv[0]);
           exit (EXIT_FAILURE);
         }
     }
+  profile_end (PROFILE_PARSE);
+
+  /* Stream all solutions or the lightest ones */
+  if (!apply_mode && (enumerate || n_lightest > 0))
+    {
+      start = clock();
+      progress_start (solve_progress);
+      n_solutions = output_solutions (field, n_rows, n_cols, stencil,
+                                      enumerate ? 0 : n_lightest,
+                                      format, output_name, solve_progress);
+      progress_stop (solve_progress);
+      end = clock();
 
+      if (progress_cancelled (solve_progress))
+        {
+          fprintf (stderr, "Solving is cancelled\n");
+          status = EXIT_FAILURE;
+        }
+      else if (n_solutions < 0)
+        status = EXIT_FAILURE;
+      else if (n_solutions == 0)
+        printf ("0\n\n");
+
+      if (print_info)
+        {
+          printf ("Size      : %i x %i\n", n_rows, n_cols);
+          printf ("Written   : %i\n",      n_solutions > 0 ? n_solutions : 0);
+          printf ("Time      : %ld\n",     end - start);
+        }
+    }
   /* Solve the puzzle */
-  if (!apply_mode)
+  else if (!apply_mode)
     {
       start = clock(); 
-      solution = lightsoff_solve (field, n_rows, n_cols,
-                                  &n_solutions, &weight,
-                                  print_info);
+      progress_start (solve_progress);
+      if (n_fixes > 0)
+        solution = solve_constrained (field, n_rows, n_cols, stencil,
+                                      fixes, n_fixes, &n_solutions, &weight,
+                                      solve_progress);
+      else
+        solution = lightsoff_solve (field, n_rows, n_cols, stencil,
+                                    &n_solutions, &weight,
+                                    solve_progress);
+      progress_stop (solve_progress);
       end = clock();
 
       /* Print solution to the console */
-      if (solution != NULL)
-        bool_matrix_print (solution, n_rows, n_cols);
+      profile_begin (PROFILE_OUTPUT);
+      if (progress_cancelled (solve_progress))
+        {
+          fprintf (stderr, "Solving is cancelled\n");
+          status = EXIT_FAILURE;
+        }
+      else if (solution != NULL)
+        output_matrix (solution, n_rows, n_cols, format, output_name);
       else
         printf ("0\n\n");
+      profile_end (PROFILE_OUTPUT);
+
+      if (solution != NULL && weight < 0)
+        fprintf (stderr, "Too many solutions to search, "
+                         "the solution is not the lightest\n");
+
+      /* Check the solution on the field */
+      if (verify && solution != NULL)
+        verified = lightsoff_verify (field, solution, n_rows, n_cols,
+                                     stencil);
+      if (verify && solution != NULL && verified <= 0)
+        {
+          fprintf (stderr, verified < 0 ? "Out of memory to verify\n" :
+                                          "Verification failed\n");
+          status = EXIT_FAILURE;
+        }
 
       if (print_info)
         {
@@ -206,6 +863,12 @@ main (int    argc,
           printf ("Solutions : %i\n",      n_solutions);
           printf ("Weight    : %i\n",      weight);
           printf ("Time      : %ld\n",     end - start);
+          if (verify && solution != NULL)
+            printf ("Verified  : %s\n", verified > 0 ? "yes" :
+                                         verified == 0 ? "no" :
+                                         "out of memory");
+          else if (verify)
+            printf ("Verified  : no solution\n");
         }
     }
   /* Apply the solution to the puzzle */
@@ -213,34 +876,42 @@ main (int    argc,
     {
       solution = field;
       field = create_field (n_rows, n_cols);
-      lightsoff_apply (field, solution, n_rows, n_cols);
-      bool_matrix_print (field, n_rows, n_cols);
+      if (field == NULL ||
+          !lightsoff_apply (field, solution, n_rows, n_cols, stencil))
+        {
+          fprintf (stderr, "Out of memory to apply\n");
+          status = EXIT_FAILURE;
+        }
+      else
+        {
+          profile_begin (PROFILE_OUTPUT);
+          output_matrix (field, n_rows, n_cols, format, output_name);
+          profile_end (PROFILE_OUTPUT);
+        }
     }
 
   /* Save solution to image file */
-  if (create_image)
+  if (create_image && solution != NULL)
     {
-      /* Convert bool matrix to image */
-      image = bool_matrix_image (solution, n_rows, n_cols);
-
-      /* Save image to file */
       sprintf (filename, "lightsoff_%ix%i.png", n_rows, n_cols);
-      error = NULL;
-      gdk_pixbuf_savev (image, filename, "png", NULL, NULL, &error);
-      if (error != NULL)
-        {
-          fprintf (stderr, "Unable to save file: %s\n", error->message);
-          g_object_unref (error);
-        }
+      image = fopen (filename, "wb");
+      if (image == NULL ||
+          !bool_matrix_write_png (image, solution, n_rows, n_cols, scale))
+        fprintf (stderr, "Unable to save file: %s\n", filename);
 
-      /* Release memory */
-      g_object_unref (image);
+      if (image != NULL)
+        fclose (image);
     }
 
+  write_profile (json_name, trace_name);
+
   /* Release memory */
-  bool_matrix_free (field, n_rows);
-  bool_matrix_free (solution, n_rows);
+  release_matrix (field, mapped, n_rows, n_cols);
+  release_matrix (solution, mapped, n_rows, n_cols);
   free (filename);
+  free (fixes);
+  signal (SIGINT, SIG_DFL);
+  progress_free (solve_progress);
 
-  return 0;
+  return status;
 }
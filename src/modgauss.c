@@ -0,0 +1,205 @@
+/*
+ * modgauss.c
+ *
+ * Copyright (C) 2017 - Pavel Nikitin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "modgauss.h"
+#include "profile.h"
+
+/* Number of candidates between the checks of progress in the search */
+#define SEARCH_BLOCK_SIZE ((uint64_t) 1 << 16)
+
+/*
+ * Reduces the system to the row echelon form. The pivot row is zero before
+ * its column, so the rows are subtracted from that column.
+ */
+int
+mod_gauss (ModMatrix *system,
+           int       *pivots,
+           Progress  *progress)
+{
+  int prime  = system->prime;
+  int n_vars = system->n_cols - 1;
+  int rank   = 0;
+  int inverse[MOD_MATRIX_MAX_PRIME];
+  int col, row, value, i;
+
+  for (i = 1; i < prime; i++)
+    {
+      for (value = 1; (i * value) % prime != 1; value++)
+        ;
+      inverse[i] = value;
+    }
+
+  progress_stage (progress, "Gaussing system", n_vars);
+  for (col = 0; col < n_vars && rank < system->n_rows; col++)
+    {
+      progress_step (progress, 1);
+      if (progress_cancelled (progress))
+        return -1;
+
+      for (row = rank; row < system->n_rows; row++)
+        {
+          if (mod_matrix_get (system, row, col) != 0)
+            break;
+        }
+
+      /* Skip column, if it does not contain a pivot */
+      if (row == system->n_rows)
+        continue;
+
+      mod_matrix_swap_rows (system, rank, row);
+      mod_matrix_scale_row (system, rank,
+                            inverse[mod_matrix_get (system, rank, col)]);
+      PROFILE_COUNT (PROFILE_PIVOTS, 1);
+
+      for (row = 0; row < system->n_rows; row++)
+        {
+          value = row != rank ? mod_matrix_get (system, row, col) : 0;
+          if (value != 0)
+            mod_matrix_sub_row (system, row, rank, value, col);
+        }
+
+      pivots[rank++] = col;
+    }
+
+  return rank;
+}
+
+/*
+ * Finds the solution with the least sum of residues. The walk keeps the
+ * candidate in row 0, the best one in row 1 and the vectors of kernel in
+ * the following rows, so a step is a bitsliced sum of rows over GF(3).
+ */
+uint8_t *
+mod_find_lightest (const ModMatrix *system,
+                   const int       *pivots,
+                   int              rank,
+                   int             *min_weight,
+                   Progress        *progress)
+{
+  int        prime     = system->prime;
+  int        n_vars    = system->n_cols - 1;
+  int        n_free    = n_vars - rank;
+  bool       cancelled = false;
+  uint64_t   total     = 1;
+  uint8_t   *solution  = NULL;
+  ModMatrix *walk;
+  int       *frees, *digits;
+  bool      *is_pivot;
+  uint64_t   step;
+  int        weight, value, d, i, j, k;
+
+  *min_weight = 0;
+
+  /* Check the system for inconsistency */
+  for (i = rank; i < system->n_rows; i++)
+    {
+      if (mod_matrix_get (system, i, n_vars) != 0)
+        return NULL;
+    }
+
+  for (k = 0; k < n_free && total <= MOD_GAUSS_MAX_CANDIDATES; k++)
+    total *= prime;
+
+  if (total > MOD_GAUSS_MAX_CANDIDATES)
+    {
+      *min_weight = -1;
+      return NULL;
+    }
+
+  walk = mod_matrix_new (prime, n_free + 2, n_vars);
+  frees = malloc ((n_free + 1) * sizeof *frees);
+  digits = calloc (n_free + 1, sizeof *digits);
+  is_pivot = calloc (n_vars + 1, sizeof *is_pivot);
+  if (walk == NULL || frees == NULL || digits == NULL || is_pivot == NULL)
+    {
+      mod_matrix_free (walk);
+      free (frees);
+      free (digits);
+      free (is_pivot);
+      return NULL;
+    }
+
+  /* The particular solution has zero free variables */
+  for (i = 0; i < rank; i++)
+    {
+      is_pivot[pivots[i]] = true;
+      mod_matrix_set (walk, 0, pivots[i], mod_matrix_get (system, i, n_vars));
+    }
+
+  /* A vector of kernel has one free variable */
+  for (j = 0, k = 0; j < n_vars; j++)
+    {
+      if (!is_pivot[j])
+        frees[k++] = j;
+    }
+
+  for (k = 0; k < n_free; k++)
+    {
+      mod_matrix_set (walk, k + 2, frees[k], 1);
+      for (i = 0; i < rank; i++)
+        {
+          value = mod_matrix_get (system, i, frees[k]);
+          if (value != 0)
+            mod_matrix_set (walk, k + 2, pivots[i], prime - value);
+        }
+    }
+
+  mod_matrix_copy_row (walk, 1, 0);
+  *min_weight = mod_matrix_row_weight (walk, 0);
+
+  /* The count in base prime changes its lowest nonzero digit by one, so
+     does the modular Gray code of the count */
+  progress_stage (progress, "Searching solution", total);
+  for (step = 1; !cancelled; step++)
+    {
+      for (d = 0; d < n_free && digits[d] == prime - 1; d++)
+        digits[d] = 0;
+      if (d == n_free)
+        break;
+      digits[d]++;
+
+      mod_matrix_sub_row (walk, 0, d + 2, prime - 1, 0);
+      weight = mod_matrix_row_weight (walk, 0);
+      if (weight < *min_weight)
+        {
+          *min_weight = weight;
+          mod_matrix_copy_row (walk, 1, 0);
+        }
+
+      if (step % SEARCH_BLOCK_SIZE == 0)
+        {
+          progress_step (progress, SEARCH_BLOCK_SIZE);
+          cancelled = progress_cancelled (progress);
+        }
+    }
+
+  PROFILE_COUNT (PROFILE_CANDIDATES, step);
+
+  if (!cancelled)
+    solution = malloc (n_vars);
+  for (j = 0; j < n_vars && solution != NULL; j++)
+    solution[j] = mod_matrix_get (walk, 1, j);
+
+  mod_matrix_free (walk);
+  free (frees);
+  free (digits);
+  free (is_pivot);
+
+  return solution;
+}
@@ -0,0 +1,80 @@
+/*
+ * modgauss.h
+ *
+ * Copyright (C) 2017 - Pavel Nikitin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MOD_GAUSS_H_
+#define MOD_GAUSS_H_
+
+#include "modmatrix.h"
+#include "progress.h"
+
+/* Most solutions, which are walked to search for the lightest one */
+#define MOD_GAUSS_MAX_CANDIDATES ((uint64_t) 1 << 32)
+
+/**
+ * SECTION: modgauss
+ * @title: modgauss
+ * @short_description: Solves a linear equations modulo a prime
+ *
+ * Solves a linear equations modulo a prime by the Gauss method and searches
+ * the solution with the least sum of residues among all of them.
+ */
+
+/**
+ * mod_gauss:
+ * @system:         A system of linear equations with the right part in the
+ *                  last column
+ * @pivots:  (out): Array of @system->n_rows indexes of the pivot columns
+ * @progress:       A progress to report the columns or %NULL
+ *
+ * Reduces the system to the row echelon form by the Gauss-Jordan method.
+ * The pivot of row i is one in the column @pivots[i] and the other rows are
+ * zero in that column.
+ *
+ * Returns: The rank of system or -1 if cancelled
+ */
+int
+mod_gauss (ModMatrix *system,
+           int       *pivots,
+           Progress  *progress);
+
+/**
+ * mod_find_lightest:
+ * @system:             A system reduced by mod_gauss()
+ * @pivots:             The pivot columns found by mod_gauss()
+ * @rank:               The rank of system
+ * @min_weight:  (out): The sum of residues of solution
+ * @progress:           A progress to report the candidates or %NULL
+ *
+ * Finds the solution with the least sum of residues. The free variables are
+ * walked in the modular Gray code, so every next candidate differs from the
+ * previous one by a vector of the kernel. Of the equally light solutions the
+ * first one of the walk is taken. More than %MOD_GAUSS_MAX_CANDIDATES
+ * solutions are not searched, @min_weight is -1 then.
+ *
+ * Returns: Array of residues of the variables or %NULL if there is no
+ * solution, too many of them or the search is cancelled
+ */
+uint8_t *
+mod_find_lightest (const ModMatrix *system,
+                   const int       *pivots,
+                   int              rank,
+                   int             *min_weight,
+                   Progress        *progress);
+
+#endif
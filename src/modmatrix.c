@@ -0,0 +1,411 @@
+/*
+ * modmatrix.c
+ *
+ * Copyright (C) 2017 - Pavel Nikitin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "modmatrix.h"
+#include "profile.h"
+
+/*
+ * Checks whether the number is an odd prime up to the maximum.
+ */
+bool
+mod_prime_supported (int prime)
+{
+  return prime == 3 || prime == 5 || prime == 7;
+}
+
+/*
+ * Creates a matrix of residues and zeros it.
+ */
+ModMatrix *
+mod_matrix_new (int prime,
+                int n_rows,
+                int n_cols)
+{
+  ModMatrix *matrix;
+  bool       success = true;
+  int        i;
+
+  matrix = calloc (1, sizeof *matrix);
+  if (matrix == NULL)
+    return NULL;
+
+  matrix->prime = prime;
+  matrix->n_rows = n_rows;
+  matrix->n_cols = n_cols;
+  for (i = 0; i < prime * prime; i++)
+    matrix->reduce[i] = i % prime;
+
+  if (prime == 3)
+    {
+      matrix->ones = bool_matrix_new (n_rows, n_cols);
+      matrix->twos = bool_matrix_new (n_rows, n_cols);
+      success = matrix->ones != NULL && matrix->twos != NULL;
+    }
+  else
+    {
+      matrix->cells = calloc (n_rows, sizeof *matrix->cells);
+      PROFILE_COUNT (PROFILE_ALLOCATED, (size_t) n_rows * n_cols);
+      for (i = 0; i < n_rows && matrix->cells != NULL && success; i++)
+        {
+          matrix->cells[i] = calloc (n_cols, sizeof *matrix->cells[i]);
+          success = matrix->cells[i] != NULL;
+        }
+      success = success && matrix->cells != NULL;
+    }
+
+  if (!success)
+    {
+      mod_matrix_free (matrix);
+      return NULL;
+    }
+
+  return matrix;
+}
+
+/*
+ * Releases a matrix of residues.
+ */
+void
+mod_matrix_free (ModMatrix *matrix)
+{
+  int i;
+
+  if (matrix == NULL)
+    return;
+
+  bool_matrix_free (matrix->ones, matrix->n_rows);
+  bool_matrix_free (matrix->twos, matrix->n_rows);
+  if (matrix->cells != NULL)
+    {
+      for (i = 0; i < matrix->n_rows; i++)
+        free (matrix->cells[i]);
+      free (matrix->cells);
+    }
+  free (matrix);
+}
+
+/*
+ * Gets an element of matrix.
+ */
+int
+mod_matrix_get (const ModMatrix *matrix,
+                int              row,
+                int              col)
+{
+  if (matrix->cells != NULL)
+    return matrix->cells[row][col];
+
+  return bool_array_get (matrix->ones[row], col) |
+         bool_array_get (matrix->twos[row], col) << 1;
+}
+
+/*
+ * Sets an element of matrix.
+ */
+void
+mod_matrix_set (ModMatrix *matrix,
+                int        row,
+                int        col,
+                int        value)
+{
+  if (matrix->cells != NULL)
+    {
+      matrix->cells[row][col] = value;
+      return;
+    }
+
+  bool_array_set (matrix->ones[row], col, value == 1);
+  bool_array_set (matrix->twos[row], col, value == 2);
+}
+
+/*
+ * Sets the elements of zero row to ones, where the boolean array has ones.
+ */
+void
+mod_matrix_set_ones (ModMatrix    *matrix,
+                     int           row,
+                     const word_t *bits)
+{
+  int col;
+
+  if (matrix->cells == NULL)
+    {
+      memcpy (matrix->ones[row], bits,
+              bool_array_n_words (matrix->n_cols) * sizeof *bits);
+      return;
+    }
+
+  for (col = bool_array_next (bits, matrix->n_cols, 0); col >= 0;
+       col = bool_array_next (bits, matrix->n_cols, col + 1))
+    matrix->cells[row][col] = 1;
+}
+
+/*
+ * Swaps two rows of matrix by pointers.
+ */
+void
+mod_matrix_swap_rows (ModMatrix *matrix,
+                      int        row1,
+                      int        row2)
+{
+  word_t  *swap;
+  uint8_t *cells;
+
+  if (matrix->cells != NULL)
+    {
+      cells = matrix->cells[row1];
+      matrix->cells[row1] = matrix->cells[row2];
+      matrix->cells[row2] = cells;
+      return;
+    }
+
+  swap = matrix->ones[row1];
+  matrix->ones[row1] = matrix->ones[row2];
+  matrix->ones[row2] = swap;
+  swap = matrix->twos[row1];
+  matrix->twos[row1] = matrix->twos[row2];
+  matrix->twos[row2] = swap;
+}
+
+/*
+ * Copies a row of matrix to another one.
+ */
+void
+mod_matrix_copy_row (ModMatrix *matrix,
+                     int        dst,
+                     int        src)
+{
+  int n_words = bool_array_n_words (matrix->n_cols);
+
+  if (matrix->cells != NULL)
+    {
+      memcpy (matrix->cells[dst], matrix->cells[src], matrix->n_cols);
+      return;
+    }
+
+  memcpy (matrix->ones[dst], matrix->ones[src], n_words * sizeof (word_t));
+  memcpy (matrix->twos[dst], matrix->twos[src], n_words * sizeof (word_t));
+}
+
+/*
+ * Multiplies a row by the residue.
+ */
+void
+mod_matrix_scale_row (ModMatrix *matrix,
+                      int        row,
+                      int        factor)
+{
+  word_t  *swap;
+  uint8_t *cells;
+  int      col;
+
+  if (matrix->cells != NULL)
+    {
+      cells = matrix->cells[row];
+      for (col = 0; col < matrix->n_cols; col++)
+        cells[col] = matrix->reduce[cells[col] * factor];
+      return;
+    }
+
+  /* Twice one is two and twice two is one */
+  if (factor == 2)
+    {
+      swap = matrix->ones[row];
+      matrix->ones[row] = matrix->twos[row];
+      matrix->twos[row] = swap;
+    }
+}
+
+/*
+ * Subtracts a multiple of row from another row. Over GF(3) the subtrahend is
+ * negated by swapping its planes and added by the bitsliced sum.
+ */
+void
+mod_matrix_sub_row (ModMatrix *matrix,
+                    int        dst,
+                    int        src,
+                    int        factor,
+                    int        first)
+{
+  int            n_words = bool_array_n_words (matrix->n_cols);
+  int            addend  = (matrix->prime - factor) % matrix->prime;
+  const word_t  *b_ones, *b_twos;
+  word_t        *a_ones, *a_twos;
+  uint8_t       *a;
+  const uint8_t *b;
+  word_t         t, ones;
+  int            k;
+
+  if (addend == 0)
+    return;
+
+  PROFILE_COUNT (PROFILE_ROW_XORS, 1);
+
+  if (matrix->cells != NULL)
+    {
+      a = matrix->cells[dst];
+      b = matrix->cells[src];
+      PROFILE_COUNT (PROFILE_WORDS, (matrix->n_cols - first) / sizeof (word_t));
+      for (k = first; k < matrix->n_cols; k++)
+        a[k] = matrix->reduce[a[k] + addend * b[k]];
+      return;
+    }
+
+  a_ones = matrix->ones[dst];
+  a_twos = matrix->twos[dst];
+  b_ones = addend == 1 ? matrix->ones[src] : matrix->twos[src];
+  b_twos = addend == 1 ? matrix->twos[src] : matrix->ones[src];
+
+  PROFILE_COUNT (PROFILE_WORDS, 2 * (n_words - ARRAY_INDEX (first)));
+  for (k = ARRAY_INDEX (first); k < n_words; k++)
+    {
+      t = (a_ones[k] | b_twos[k]) ^ (a_twos[k] | b_ones[k]);
+      ones = (a_twos[k] | b_twos[k]) ^ t;
+      a_twos[k] = (a_ones[k] | b_ones[k]) ^ t;
+      a_ones[k] = ones;
+    }
+}
+
+/*
+ * Sums the residues of row as integers.
+ */
+int
+mod_matrix_row_weight (const ModMatrix *matrix,
+                       int              row)
+{
+  int n_words = bool_array_n_words (matrix->n_cols);
+  int weight  = 0;
+  int col;
+
+  if (matrix->cells == NULL)
+    return bool_array_count (matrix->ones[row], n_words) +
+           2 * bool_array_count (matrix->twos[row], n_words);
+
+  for (col = 0; col < matrix->n_cols; col++)
+    weight += matrix->cells[row][col];
+
+  return weight;
+}
+
+/*
+ * Reads a matrix of digits until an empty line. The lines are kept until the
+ * size of matrix is known.
+ */
+ModMatrix *
+mod_matrix_read (FILE *stream,
+                 int   prime)
+{
+  ModMatrix *matrix   = NULL;
+  char     **lines    = NULL;
+  char      *line     = NULL;
+  size_t     size     = 0;
+  bool       success  = true;
+  int        n_rows   = 0;
+  int        n_cols   = 0;
+  int        capacity = 0;
+  ssize_t    len;
+  char     **grown;
+  int        row, col;
+
+  while (success && (len = getline (&line, &size, stream)) > 0)
+    {
+      while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r'))
+        line[--len] = '\0';
+
+      /* An empty line ends the matrix */
+      if (len == 0)
+        break;
+
+      if (n_rows == 0)
+        n_cols = len;
+
+      if (len != n_cols)
+        {
+          fprintf (stderr, "Line %i: %i columns instead of %i\n",
+                   n_rows + 1, (int) len, n_cols);
+          success = false;
+          break;
+        }
+
+      for (col = 0; col < n_cols && success; col++)
+        {
+          success = line[col] >= '0' && line[col] < '0' + prime;
+          if (!success)
+            fprintf (stderr, "Line %i: symbols other than '0'-'%c'\n",
+                     n_rows + 1, '0' + prime - 1);
+        }
+
+      /* Grow the array of lines twice */
+      if (success && n_rows == capacity)
+        {
+          capacity += capacity > 0 ? capacity : 64;
+          grown = realloc (lines, capacity * sizeof *lines);
+          success = grown != NULL;
+          if (success)
+            lines = grown;
+        }
+
+      if (success)
+        {
+          lines[n_rows++] = line;
+          line = NULL;
+          size = 0;
+        }
+    }
+
+  if (success && n_rows > 0)
+    matrix = mod_matrix_new (prime, n_rows, n_cols);
+
+  for (row = 0; row < n_rows; row++)
+    {
+      for (col = 0; col < n_cols && matrix != NULL; col++)
+        mod_matrix_set (matrix, row, col, lines[row][col] - '0');
+      free (lines[row]);
+    }
+
+  free (lines);
+  free (line);
+
+  return matrix;
+}
+
+/*
+ * Writes a matrix as rows of digits, a row by a call of fwrite.
+ */
+bool
+mod_matrix_write_text (FILE            *stream,
+                       const ModMatrix *matrix)
+{
+  char *line    = malloc (matrix->n_cols + 1);
+  bool  success = line != NULL;
+  int   row, col;
+
+  for (row = 0; row < matrix->n_rows && success; row++)
+    {
+      for (col = 0; col < matrix->n_cols; col++)
+        line[col] = '0' + mod_matrix_get (matrix, row, col);
+      line[matrix->n_cols] = '\n';
+      success = fwrite (line, 1, matrix->n_cols + 1, stream) ==
+                (size_t) matrix->n_cols + 1;
+    }
+
+  free (line);
+
+  return success;
+}
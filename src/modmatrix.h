@@ -0,0 +1,243 @@
+/*
+ * modmatrix.h
+ *
+ * Copyright (C) 2017 - Pavel Nikitin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MOD_MATRIX_H_
+#define MOD_MATRIX_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include "boolmatrix.h"
+
+#define MOD_MATRIX_MAX_PRIME 7
+
+/**
+ * SECTION: modmatrix
+ * @title: modmatrix
+ * @short_description: A matrix over the field of residues modulo a prime
+ *
+ * A matrix of residues modulo a small prime for the puzzles, where a click
+ * cycles the cells through more than two states. The matrix over GF(3) is
+ * bitsliced to two boolean matrices: the plane of ones and the plane of
+ * twos. A row operation over GF(3) takes a few logical operations per word,
+ * so 64 cells are added, subtracted or scaled at once. The matrix over
+ * a greater prime keeps an element per byte.
+ */
+
+/**
+ * ModMatrix:
+ * @prime:  The modulus
+ * @n_rows: Number of rows
+ * @n_cols: Number of columns
+ * @ones:   The plane of ones, if @prime is 3
+ * @twos:   The plane of twos, if @prime is 3
+ * @cells:  The rows of elements by bytes, if @prime is greater than 3
+ * @reduce: The residues of the sums of products
+ *
+ * A matrix of residues modulo @prime.
+ */
+typedef struct
+{
+  int       prime;
+  int       n_rows;
+  int       n_cols;
+  word_t  **ones;
+  word_t  **twos;
+  uint8_t **cells;
+  uint8_t   reduce[MOD_MATRIX_MAX_PRIME * MOD_MATRIX_MAX_PRIME];
+} ModMatrix;
+
+/**
+ * mod_prime_supported:
+ * @prime: A number
+ *
+ * Checks whether the number is an odd prime up to %MOD_MATRIX_MAX_PRIME.
+ *
+ * Returns: %TRUE if the matrices modulo the number are supported
+ */
+bool
+mod_prime_supported (int prime);
+
+/**
+ * mod_matrix_new:
+ * @prime:  The modulus, see mod_prime_supported()
+ * @n_rows: Number of rows
+ * @n_cols: Number of columns
+ *
+ * Creates a matrix of residues and zeros it.
+ *
+ * Returns: A new matrix or %NULL if out of memory
+ */
+ModMatrix *
+mod_matrix_new (int prime,
+                int n_rows,
+                int n_cols);
+
+/**
+ * mod_matrix_free:
+ * @matrix: A matrix or %NULL
+ *
+ * Releases a matrix of residues.
+ */
+void
+mod_matrix_free (ModMatrix *matrix);
+
+/**
+ * mod_matrix_get:
+ * @matrix: A matrix
+ * @row:    Index of row
+ * @col:    Index of column
+ *
+ * Gets an element of matrix.
+ *
+ * Returns: The residue
+ */
+int
+mod_matrix_get (const ModMatrix *matrix,
+                int              row,
+                int              col);
+
+/**
+ * mod_matrix_set:
+ * @matrix: A matrix
+ * @row:    Index of row
+ * @col:    Index of column
+ * @value:  A residue
+ *
+ * Sets an element of matrix.
+ */
+void
+mod_matrix_set (ModMatrix *matrix,
+                int        row,
+                int        col,
+                int        value);
+
+/**
+ * mod_matrix_set_ones:
+ * @matrix: A matrix
+ * @row:    Index of a zero row
+ * @bits:   A boolean array of @matrix->n_cols booleans
+ *
+ * Sets the elements of zero row to ones, where the boolean array has ones.
+ * Over GF(3) the array is copied to the plane of ones by words.
+ */
+void
+mod_matrix_set_ones (ModMatrix    *matrix,
+                     int           row,
+                     const word_t *bits);
+
+/**
+ * mod_matrix_swap_rows:
+ * @matrix: A matrix
+ * @row1:   Index of row
+ * @row2:   Index of row
+ *
+ * Swaps two rows of matrix by pointers.
+ */
+void
+mod_matrix_swap_rows (ModMatrix *matrix,
+                      int        row1,
+                      int        row2);
+
+/**
+ * mod_matrix_copy_row:
+ * @matrix: A matrix
+ * @dst:    Index of row to overwrite
+ * @src:    Index of row to copy
+ *
+ * Copies a row of matrix to another one.
+ */
+void
+mod_matrix_copy_row (ModMatrix *matrix,
+                     int        dst,
+                     int        src);
+
+/**
+ * mod_matrix_scale_row:
+ * @matrix: A matrix
+ * @row:    Index of row
+ * @factor: A nonzero residue
+ *
+ * Multiplies a row by the residue. Over GF(3) the factor 2 swaps the planes
+ * of row.
+ */
+void
+mod_matrix_scale_row (ModMatrix *matrix,
+                      int        row,
+                      int        factor);
+
+/**
+ * mod_matrix_sub_row:
+ * @matrix: A matrix
+ * @dst:    Index of row to subtract from
+ * @src:    Index of row to subtract
+ * @factor: A residue to multiply @src by
+ * @first:  Index of column, the elements of @src before it are zero
+ *
+ * Subtracts a multiple of row from another row. Over GF(3) the sum is
+ * bitsliced, it takes six logical operations per word of the planes.
+ */
+void
+mod_matrix_sub_row (ModMatrix *matrix,
+                    int        dst,
+                    int        src,
+                    int        factor,
+                    int        first);
+
+/**
+ * mod_matrix_row_weight:
+ * @matrix: A matrix
+ * @row:    Index of row
+ *
+ * Sums the residues of row as integers. Over GF(3) it is the number of ones
+ * and twice the number of twos counted by words.
+ *
+ * Returns: The sum of row
+ */
+int
+mod_matrix_row_weight (const ModMatrix *matrix,
+                       int              row);
+
+/**
+ * mod_matrix_read:
+ * @stream: A stream to read as #FILE
+ * @prime:  The modulus
+ *
+ * Reads a matrix of digits from 0 to @prime - 1 from a stream until an empty
+ * line or the end of stream.
+ *
+ * Returns: A new matrix or %NULL on error
+ */
+ModMatrix *
+mod_matrix_read (FILE *stream,
+                 int   prime);
+
+/**
+ * mod_matrix_write_text:
+ * @stream: A stream to write as #FILE
+ * @matrix: A matrix
+ *
+ * Writes a matrix as rows of digits.
+ *
+ * Returns: A success flag
+ */
+bool
+mod_matrix_write_text (FILE            *stream,
+                       const ModMatrix *matrix);
+
+#endif
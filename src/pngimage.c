@@ -0,0 +1,211 @@
+/*
+ * pngimage.c
+ *
+ * Copyright (C) 2017 - Pavel Nikitin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <zlib.h>
+#include "pngimage.h"
+
+#define PNG_CHUNK_SIZE 65536
+
+/*
+ * Stores a 32-bit number in the network byte order.
+ */
+static void
+put_uint32 (unsigned char *bytes,
+            uint32_t       value)
+{
+  bytes[0] = value >> 24;
+  bytes[1] = value >> 16;
+  bytes[2] = value >> 8;
+  bytes[3] = value;
+}
+
+/*
+ * Writes a chunk of PNG image with its length and checksum.
+ */
+static bool
+write_chunk (FILE                *stream,
+             const char          *type,
+             const unsigned char *data,
+             uint32_t             size)
+{
+  unsigned char bytes[4];
+  uLong         crc;
+
+  crc = crc32 (0, (const Bytef *) type, 4);
+  if (size > 0)
+    crc = crc32 (crc, data, size);
+
+  put_uint32 (bytes, size);
+  if (fwrite (bytes, 1, 4, stream) != 4 || fwrite (type, 1, 4, stream) != 4)
+    return false;
+
+  if (size > 0 && fwrite (data, 1, size, stream) != size)
+    return false;
+
+  put_uint32 (bytes, crc);
+
+  return fwrite (bytes, 1, 4, stream) == 4;
+}
+
+/*
+ * Compresses a scanline and writes the full output buffers as IDAT chunks.
+ */
+static bool
+deflate_scanline (FILE          *stream,
+                  z_stream      *zstream,
+                  unsigned char *chunk,
+                  unsigned char *scanline,
+                  size_t         size,
+                  int            flush)
+{
+  int status;
+
+  zstream->next_in = scanline;
+  zstream->avail_in = size;
+
+  do
+    {
+      status = deflate (zstream, flush);
+      if (status == Z_STREAM_ERROR)
+        return false;
+
+      if (zstream->avail_out == 0 || (flush == Z_FINISH && status == Z_STREAM_END))
+        {
+          if (!write_chunk (stream, "IDAT", chunk,
+                            PNG_CHUNK_SIZE - zstream->avail_out))
+            return false;
+
+          zstream->next_out = chunk;
+          zstream->avail_out = PNG_CHUNK_SIZE;
+        }
+    }
+  while (zstream->avail_in > 0 || (flush == Z_FINISH && status != Z_STREAM_END));
+
+  return true;
+}
+
+/*
+ * Packs a row of matrix to a scanline, every cell becomes @scale pixels.
+ * The first byte is the filter type.
+ */
+static void
+pack_scanline (const word_t  *row,
+               unsigned char *scanline,
+               int            n_cols,
+               int            scale)
+{
+  int width = n_cols * scale;
+  int col, x;
+
+  scanline[0] = 0;
+  if (scale == 1)
+    {
+      bool_array_pack_msb (row, scanline + 1, n_cols);
+      return;
+    }
+
+  memset (scanline + 1, 0, (width + 7) / 8);
+  for (col = 0; col < n_cols; col++)
+    {
+      if (bool_array_get ((word_t *) row, col))
+        {
+          for (x = col * scale; x < (col + 1) * scale; x++)
+            scanline[1 + x / 8] |= 0x80 >> (x % 8);
+        }
+    }
+}
+
+/*
+ * Writes a boolean matrix as 1-bit palette PNG image.
+ */
+bool
+bool_matrix_write_png (FILE     *stream,
+                       word_t  **matrix,
+                       int       n_rows,
+                       int       n_cols,
+                       int       scale)
+{
+  static const unsigned char signature[8] = { 0x89, 'P', 'N', 'G',
+                                              '\r', '\n', 0x1A, '\n' };
+  unsigned char  header[13];
+  unsigned char  palette[6];
+  unsigned char *scanline;
+  unsigned char *chunk;
+  size_t         n_bytes;
+  z_stream       zstream;
+  bool           success;
+  int            row, i;
+
+  if (scale < 1)
+    scale = 1;
+
+  n_bytes = 1 + ((size_t) n_cols * scale + 7) / 8;
+  scanline = malloc (n_bytes);
+  chunk = malloc (PNG_CHUNK_SIZE);
+
+  memset (&zstream, 0, sizeof zstream);
+  success = scanline != NULL && chunk != NULL &&
+            deflateInit (&zstream, Z_DEFAULT_COMPRESSION) == Z_OK;
+  if (!success)
+    {
+      free (scanline);
+      free (chunk);
+      return false;
+    }
+
+  zstream.next_out = chunk;
+  zstream.avail_out = PNG_CHUNK_SIZE;
+
+  /* Width, height, bit depth 1, palette color type, no interlace */
+  put_uint32 (header, n_cols * scale);
+  put_uint32 (header + 4, n_rows * scale);
+  header[8] = 1;
+  header[9] = 3;
+  header[10] = 0;
+  header[11] = 0;
+  header[12] = 0;
+
+  for (i = 0; i < 3; i++)
+    {
+      palette[i] = PNG_IMAGE_OFF_COLOR >> (16 - 8 * i);
+      palette[3 + i] = PNG_IMAGE_ON_COLOR >> (16 - 8 * i);
+    }
+
+  success = fwrite (signature, 1, sizeof signature, stream) == sizeof signature &&
+            write_chunk (stream, "IHDR", header, sizeof header) &&
+            write_chunk (stream, "PLTE", palette, sizeof palette);
+
+  for (row = 0; row < n_rows && success; row++)
+    {
+      pack_scanline (matrix[row], scanline, n_cols, scale);
+      for (i = 0; i < scale && success; i++)
+        success = deflate_scanline (stream, &zstream, chunk, scanline, n_bytes,
+                                    Z_NO_FLUSH);
+    }
+
+  if (success)
+    success = deflate_scanline (stream, &zstream, chunk, scanline, 0, Z_FINISH) &&
+              write_chunk (stream, "IEND", NULL, 0);
+
+  deflateEnd (&zstream);
+  free (scanline);
+  free (chunk);
+
+  return success;
+}
@@ -0,0 +1,58 @@
+/*
+ * pngimage.h
+ *
+ * Copyright (C) 2017 - Pavel Nikitin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PNG_IMAGE_H_
+#define PNG_IMAGE_H_
+
+#include "boolmatrix.h"
+
+#define PNG_IMAGE_ON_COLOR  0x3263B7
+#define PNG_IMAGE_OFF_COLOR 0xE2E0E9
+
+/**
+ * SECTION: pngimage
+ * @title: pngimage
+ * @short_description: Writes a boolean matrix as PNG image.
+ *
+ * Writes a boolean matrix as 1-bit palette PNG image. The rows are packed to
+ * scanlines and compressed one by one, so the image takes no memory except
+ * a scanline and the buffer of compressor.
+ */
+
+/**
+ * bool_matrix_write_png:
+ * @stream: A stream to write as #FILE
+ * @matrix: A boolean matrix
+ * @n_rows: Number of rows
+ * @n_cols: Number of columns
+ * @scale:  Number of pixels per side of a cell
+ *
+ * Writes a boolean matrix as 1-bit palette PNG image. The ones are drawn by
+ * %PNG_IMAGE_ON_COLOR, the zeros by %PNG_IMAGE_OFF_COLOR.
+ *
+ * Returns: A success flag
+ **/
+bool
+bool_matrix_write_png (FILE     *stream,
+                       word_t  **matrix,
+                       int       n_rows,
+                       int       n_cols,
+                       int       scale);
+
+#endif
@@ -0,0 +1,341 @@
+/*
+ * profile.c
+ *
+ * Copyright (C) 2017 - Pavel Nikitin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <linux/perf_event.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#include "profile.h"
+
+#define PROFILE_MAX_DEPTH 16
+
+/*
+ * A recorded span of phase.
+ */
+typedef struct
+{
+  ProfilePhase phase;
+  int          thread;
+  uint64_t     start;
+  uint64_t     wall;
+  uint64_t     cpu;
+  uint64_t     counters[PROFILE_N_COUNTERS];
+} ProfileSpan;
+
+/*
+ * The state of thread: the open spans and the hardware counters.
+ */
+typedef struct
+{
+  int         thread;
+  int         depth;
+  int         perf_fds[2];
+  ProfileSpan open[PROFILE_MAX_DEPTH];
+} ProfileThread;
+
+static const char *phase_names[PROFILE_N_PHASES] = {
+  "parse", "create_system", "bool_gauss", "find_shortest_solution", "output"
+};
+
+static const char *counter_names[PROFILE_N_COUNTERS] = {
+  "pivots", "row_xors", "words", "candidates", "allocated", "cycles",
+  "cache_misses"
+};
+
+bool                  profile_enabled = false;
+_Thread_local uint64_t profile_counters[PROFILE_N_COUNTERS];
+
+static _Thread_local ProfileThread *profile_thread = NULL;
+static pthread_mutex_t              profile_lock   = PTHREAD_MUTEX_INITIALIZER;
+static ProfileSpan                 *profile_spans  = NULL;
+static int                          n_spans        = 0;
+static int                          spans_capacity = 0;
+static int                          n_threads      = 0;
+static uint64_t                     profile_origin = 0;
+
+/*
+ * Reads a clock in nanoseconds.
+ */
+static uint64_t
+clock_ns (clockid_t clock)
+{
+  struct timespec ts;
+
+  clock_gettime (clock, &ts);
+
+  return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/*
+ * Opens a hardware counter of the calling thread. Returns -1 if it is not
+ * allowed.
+ */
+static int
+perf_open (uint64_t config)
+{
+  struct perf_event_attr attr;
+
+  memset (&attr, 0, sizeof attr);
+  attr.size = sizeof attr;
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.config = config;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+
+  return syscall (SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+/*
+ * Gets the state of the calling thread, creates it at the first call.
+ */
+static ProfileThread *
+get_thread (void)
+{
+  ProfileThread *thread = profile_thread;
+
+  if (thread != NULL)
+    return thread;
+
+  thread = calloc (1, sizeof *thread);
+  if (thread == NULL)
+    return NULL;
+
+  pthread_mutex_lock (&profile_lock);
+  thread->thread = ++n_threads;
+  pthread_mutex_unlock (&profile_lock);
+
+  thread->perf_fds[0] = perf_open (PERF_COUNT_HW_CPU_CYCLES);
+  thread->perf_fds[1] = perf_open (PERF_COUNT_HW_CACHE_MISSES);
+  profile_thread = thread;
+
+  return thread;
+}
+
+/*
+ * Copies the counters of thread with the current hardware counters.
+ */
+static void
+read_counters (ProfileThread *thread,
+               uint64_t      *counters)
+{
+  uint64_t value;
+  int      i;
+
+  for (i = 0; i < 2; i++)
+    {
+      if (thread->perf_fds[i] >= 0 &&
+          read (thread->perf_fds[i], &value, sizeof value) == sizeof value)
+        profile_counters[PROFILE_CYCLES + i] = value;
+    }
+
+  memcpy (counters, profile_counters, sizeof profile_counters);
+}
+
+/*
+ * Enables recording of spans.
+ */
+void
+profile_enable (void)
+{
+  profile_origin = clock_ns (CLOCK_MONOTONIC);
+  profile_enabled = true;
+}
+
+/*
+ * Starts a span of the phase on the calling thread.
+ */
+void
+profile_begin (ProfilePhase phase)
+{
+  ProfileThread *thread;
+  ProfileSpan   *span;
+
+  if (!profile_enabled || (thread = get_thread ()) == NULL)
+    return;
+
+  if (thread->depth++ >= PROFILE_MAX_DEPTH)
+    return;
+
+  span = &thread->open[thread->depth - 1];
+  span->phase = phase;
+  span->thread = thread->thread;
+  read_counters (thread, span->counters);
+  span->cpu = clock_ns (CLOCK_THREAD_CPUTIME_ID);
+  span->start = clock_ns (CLOCK_MONOTONIC);
+}
+
+/*
+ * Ends the innermost span of the calling thread and records it.
+ */
+void
+profile_end (ProfilePhase phase)
+{
+  ProfileThread *thread = profile_thread;
+  ProfileSpan   *span, *spans;
+  uint64_t       counters[PROFILE_N_COUNTERS];
+  int            i;
+
+  if (!profile_enabled || thread == NULL || thread->depth == 0)
+    return;
+
+  if (--thread->depth >= PROFILE_MAX_DEPTH)
+    return;
+
+  span = &thread->open[thread->depth];
+  span->wall = clock_ns (CLOCK_MONOTONIC) - span->start;
+  span->cpu = clock_ns (CLOCK_THREAD_CPUTIME_ID) - span->cpu;
+  read_counters (thread, counters);
+  for (i = 0; i < PROFILE_N_COUNTERS; i++)
+    span->counters[i] = counters[i] - span->counters[i];
+
+  if (span->phase != phase)
+    fprintf (stderr, "Profile: %s ends the span of %s\n",
+             phase_names[phase], phase_names[span->phase]);
+
+  pthread_mutex_lock (&profile_lock);
+  if (n_spans == spans_capacity)
+    {
+      spans = realloc (profile_spans, (spans_capacity + 64) * 2 *
+                                      sizeof *profile_spans);
+      if (spans != NULL)
+        {
+          profile_spans = spans;
+          spans_capacity = (spans_capacity + 64) * 2;
+        }
+    }
+
+  if (n_spans < spans_capacity)
+    profile_spans[n_spans++] = *span;
+  pthread_mutex_unlock (&profile_lock);
+}
+
+/*
+ * Forgets the recorded spans.
+ */
+void
+profile_reset (void)
+{
+  pthread_mutex_lock (&profile_lock);
+  n_spans = 0;
+  pthread_mutex_unlock (&profile_lock);
+}
+
+/*
+ * Sums the wall time of the recorded spans of the phase.
+ */
+uint64_t
+profile_phase_wall (ProfilePhase phase)
+{
+  uint64_t wall = 0;
+  int      i;
+
+  pthread_mutex_lock (&profile_lock);
+  for (i = 0; i < n_spans; i++)
+    {
+      if (profile_spans[i].phase == phase)
+        wall += profile_spans[i].wall;
+    }
+  pthread_mutex_unlock (&profile_lock);
+
+  return wall;
+}
+
+/*
+ * Gets the name of the phase.
+ */
+const char *
+profile_phase_name (ProfilePhase phase)
+{
+  return phase_names[phase];
+}
+
+/*
+ * Writes the summary of spans per phase as JSON.
+ */
+bool
+profile_write_json (FILE *stream)
+{
+  uint64_t sums[PROFILE_N_PHASES][PROFILE_N_COUNTERS + 2];
+  int      calls[PROFILE_N_PHASES];
+  int      phase, i, j;
+
+  memset (sums, 0, sizeof sums);
+  memset (calls, 0, sizeof calls);
+
+  pthread_mutex_lock (&profile_lock);
+  for (i = 0; i < n_spans; i++)
+    {
+      phase = profile_spans[i].phase;
+      calls[phase]++;
+      sums[phase][0] += profile_spans[i].wall;
+      sums[phase][1] += profile_spans[i].cpu;
+      for (j = 0; j < PROFILE_N_COUNTERS; j++)
+        sums[phase][j + 2] += profile_spans[i].counters[j];
+    }
+  pthread_mutex_unlock (&profile_lock);
+
+  fprintf (stream, "{\n  \"phases\": [");
+  for (phase = 0; phase < PROFILE_N_PHASES; phase++)
+    {
+      fprintf (stream, "%s\n    { \"name\": \"%s\", \"calls\": %i, "
+               "\"wall_ms\": %.3f, \"cpu_ms\": %.3f",
+               phase > 0 ? "," : "", phase_names[phase], calls[phase],
+               sums[phase][0] / 1e6, sums[phase][1] / 1e6);
+      for (j = 0; j < PROFILE_N_COUNTERS; j++)
+        fprintf (stream, ", \"%s\": %llu", counter_names[j],
+                 (unsigned long long) sums[phase][j + 2]);
+      fprintf (stream, " }");
+    }
+
+  return fprintf (stream, "\n  ]\n}\n") > 0;
+}
+
+/*
+ * Writes every span as complete event of Chrome trace format.
+ */
+bool
+profile_write_trace (FILE *stream)
+{
+  const ProfileSpan *span;
+  int                i, j;
+
+  fprintf (stream, "{\"traceEvents\":[");
+
+  pthread_mutex_lock (&profile_lock);
+  for (i = 0; i < n_spans; i++)
+    {
+      span = &profile_spans[i];
+      fprintf (stream, "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,"
+               "\"tid\":%i,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"cpu_us\":%.3f",
+               i > 0 ? "," : "", phase_names[span->phase], span->thread,
+               (span->start - profile_origin) / 1e3, span->wall / 1e3,
+               span->cpu / 1e3);
+      for (j = 0; j < PROFILE_N_COUNTERS; j++)
+        fprintf (stream, ",\"%s\":%llu", counter_names[j],
+                 (unsigned long long) span->counters[j]);
+      fprintf (stream, "}}");
+    }
+  pthread_mutex_unlock (&profile_lock);
+
+  return fprintf (stream, "\n],\"displayTimeUnit\":\"ms\"}\n") > 0;
+}
@@ -0,0 +1,184 @@
+/*
+ * profile.h
+ *
+ * Copyright (C) 2017 - Pavel Nikitin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PROFILE_H_
+#define PROFILE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * SECTION: profile
+ * @title: profile
+ * @short_description: Measures the phases of solving.
+ *
+ * Records spans of the phases of solving with wall and CPU time, counters of
+ * work and, if the kernel allows, cycles and cache misses of the thread. The
+ * spans are exported as JSON summary or as Chrome trace events. Disabled
+ * profiling costs a test of flag per span and counter.
+ */
+
+/**
+ * ProfilePhase:
+ * @PROFILE_PARSE:         Reading of the field
+ * @PROFILE_CREATE_SYSTEM: Construction of the system of equations
+ * @PROFILE_GAUSS:         Gauss elimination
+ * @PROFILE_SEARCH:        Search of the shortest solution in the coset
+ * @PROFILE_OUTPUT:        Writing of the solution
+ *
+ * The phases of solving.
+ */
+typedef enum
+{
+  PROFILE_PARSE,
+  PROFILE_CREATE_SYSTEM,
+  PROFILE_GAUSS,
+  PROFILE_SEARCH,
+  PROFILE_OUTPUT,
+  PROFILE_N_PHASES
+} ProfilePhase;
+
+/**
+ * ProfileCounter:
+ * @PROFILE_PIVOTS:       Pivots found by Gauss elimination
+ * @PROFILE_ROW_XORS:     Rows xored by another row
+ * @PROFILE_WORDS:        Words of rows touched by xors
+ * @PROFILE_CANDIDATES:   Solutions of coset weighed
+ * @PROFILE_ALLOCATED:    Bytes allocated for matrices, arrays and blocks of
+ *                        arenas, a sum rather than the peak of memory
+ * @PROFILE_CYCLES:       Processor cycles of the thread
+ * @PROFILE_CACHE_MISSES: Cache misses of the thread
+ *
+ * The counters of work. The last two are hardware counters.
+ */
+typedef enum
+{
+  PROFILE_PIVOTS,
+  PROFILE_ROW_XORS,
+  PROFILE_WORDS,
+  PROFILE_CANDIDATES,
+  PROFILE_ALLOCATED,
+  PROFILE_CYCLES,
+  PROFILE_CACHE_MISSES,
+  PROFILE_N_COUNTERS
+} ProfileCounter;
+
+extern bool profile_enabled;
+extern _Thread_local uint64_t profile_counters[PROFILE_N_COUNTERS];
+
+/**
+ * PROFILE_COUNT:
+ * @counter: A #ProfileCounter
+ * @n:       The amount to add
+ *
+ * Adds to the counter of the calling thread, if profiling is enabled.
+ */
+#define PROFILE_COUNT(counter, n)              \
+  do                                           \
+    {                                          \
+      if (profile_enabled)                     \
+        profile_counters[counter] += (n);      \
+    }                                          \
+  while (0)
+
+/**
+ * profile_enable:
+ *
+ * Enables recording of spans. The hardware counters are opened for every
+ * thread at its first span, they stay zero if perf events are not allowed.
+ **/
+void
+profile_enable (void);
+
+/**
+ * profile_begin:
+ * @phase: The phase
+ *
+ * Starts a span of the phase on the calling thread. The spans of a thread
+ * are nested.
+ **/
+void
+profile_begin (ProfilePhase phase);
+
+/**
+ * profile_end:
+ * @phase: The phase started by profile_begin()
+ *
+ * Ends the innermost span of the calling thread and records it with the
+ * times and the counters since its start.
+ **/
+void
+profile_end (ProfilePhase phase);
+
+/**
+ * profile_reset:
+ *
+ * Forgets the recorded spans.
+ **/
+void
+profile_reset (void);
+
+/**
+ * profile_phase_wall:
+ * @phase: The phase
+ *
+ * Sums the wall time of the recorded spans of the phase.
+ *
+ * Returns: The wall time in nanoseconds
+ **/
+uint64_t
+profile_phase_wall (ProfilePhase phase);
+
+/**
+ * profile_phase_name:
+ * @phase: The phase
+ *
+ * Gets the name of the phase as in the exported profiles.
+ *
+ * Returns: The name of the phase
+ **/
+const char *
+profile_phase_name (ProfilePhase phase);
+
+/**
+ * profile_write_json:
+ * @stream: A stream to write as #FILE
+ *
+ * Writes the summary of spans per phase as JSON: number of calls, wall and
+ * CPU time in milliseconds and the counters.
+ *
+ * Returns: A success flag
+ **/
+bool
+profile_write_json (FILE *stream);
+
+/**
+ * profile_write_trace:
+ * @stream: A stream to write as #FILE
+ *
+ * Writes every span as complete event of Chrome trace format, the thread of
+ * the span is its "tid" and the counters are its "args".
+ *
+ * Returns: A success flag
+ **/
+bool
+profile_write_trace (FILE *stream);
+
+#endif
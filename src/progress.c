@@ -17,50 +17,331 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <pthread.h>
+#include <stdatomic.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include "progress.h"
 
-static int prev_percent = -1;
+struct _Progress
+{
+  _Atomic int64_t  done;
+  atomic_bool      cancelled;
+  atomic_bool      expired;
+  _Atomic uint64_t deadline;
+  ProgressFunc    func;
+  void           *data;
+  double          limit;
+  pthread_mutex_t lock;
+  pthread_cond_t  cond;
+  pthread_t       thread;
+  bool            running;
+  const char     *message;
+  int64_t         total;
+  int             stage;
+  uint64_t        start;
+  uint64_t        stage_start;
+};
 
 /*
- * Shows progress bar into console. Does not supports re-entry.
+ * Reads a monotonic clock in nanoseconds.
  */
-void
-show_progress (const char *message,
-               int         percent)
+static uint64_t
+clock_ns (void)
 {
-  int n_spaces, i, len;
+  struct timespec time;
 
-  if (prev_percent == percent)
-    {
-      return;
-    }
+  clock_gettime (CLOCK_MONOTONIC, &time);
 
-  prev_percent = percent;
-  printf ("%s", message);
-  n_spaces = PROGRESS_MESSAGE_WIDTH - strlen (message);
-  for (i = 0; i < n_spaces; i++)
-    {
-      printf (" ");
-    }
-  printf ("[");
-  len = percent * PROGRESS_BAR_LENGTH / 100;
-  for (i = 0; i < len; i++)
-    {
-      printf ("#");
-    }
-  len = PROGRESS_BAR_LENGTH - len;
-  for (i = 0; i < len; i++)
+  return (uint64_t) time.tv_sec * 1000000000 + time.tv_nsec;
+}
+
+/*
+ * Takes a snapshot of the current stage, the lock must be held.
+ */
+static void
+take_state (Progress      *progress,
+            ProgressState *state,
+            uint64_t       now)
+{
+  state->message = progress->message;
+  state->done = atomic_load_explicit (&progress->done, memory_order_relaxed);
+  state->total = progress->total;
+  state->seconds = (now - progress->stage_start) / 1e9;
+  state->finished = false;
+}
+
+/*
+ * Reports the snapshots until the progress is stopped. The callback is
+ * called out of the lock, so the stages are not held by the output. A stage
+ * replaced between the reports gets its last report as finished.
+ */
+static void *
+progress_reporter (void *data)
+{
+  Progress        *progress = data;
+  ProgressState    state, shown;
+  struct timespec  deadline;
+  uint64_t         now;
+  int              stage;
+  int              shown_stage = 0;
+  bool             running     = true;
+
+  shown.message = NULL;
+
+  pthread_mutex_lock (&progress->lock);
+  while (running)
     {
-      printf (" ");
+      /* The stop may come before the first wait */
+      if (progress->running)
+        {
+          clock_gettime (CLOCK_REALTIME, &deadline);
+          deadline.tv_nsec += PROGRESS_INTERVAL_MS * 1000000L;
+          deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+          deadline.tv_nsec %= 1000000000L;
+          pthread_cond_timedwait (&progress->cond, &progress->lock, &deadline);
+        }
+
+      running = progress->running;
+      now = clock_ns ();
+      take_state (progress, &state, now);
+      stage = progress->stage;
+      pthread_mutex_unlock (&progress->lock);
+
+      if (shown.message != NULL && shown_stage != stage)
+        {
+          shown.done = shown.total;
+          shown.finished = true;
+          progress->func (progress, &shown, progress->data);
+        }
+
+      state.finished = !running;
+      if (state.message != NULL)
+        progress->func (progress, &state, progress->data);
+
+      shown = state;
+      shown_stage = stage;
+      pthread_mutex_lock (&progress->lock);
     }
-  printf ("] %i%c\r", percent, '%');
+  pthread_mutex_unlock (&progress->lock);
+
+  return NULL;
+}
+
+/*
+ * Creates a progress of solve.
+ */
+Progress *
+progress_new (ProgressFunc  func,
+              void         *data)
+{
+  Progress *progress;
+
+  progress = calloc (1, sizeof *progress);
+  if (progress == NULL)
+    return NULL;
+
+  progress->func = func;
+  progress->data = data;
+  atomic_init (&progress->done, 0);
+  atomic_init (&progress->cancelled, false);
+  atomic_init (&progress->expired, false);
+  atomic_init (&progress->deadline, 0);
+  pthread_mutex_init (&progress->lock, NULL);
+  pthread_cond_init (&progress->cond, NULL);
+
+  return progress;
+}
+
+/*
+ * Stops the reporter thread and releases the progress.
+ */
+void
+progress_free (Progress *progress)
+{
+  if (progress == NULL)
+    return;
+
+  progress_stop (progress);
+  pthread_mutex_destroy (&progress->lock);
+  pthread_cond_destroy (&progress->cond);
+  free (progress);
+}
+
+/*
+ * Sets the time limit of the solve.
+ */
+void
+progress_set_limit (Progress *progress,
+                    double    seconds)
+{
+  progress->limit = seconds;
+}
+
+/*
+ * Starts a solve, its deadline and the reporter thread.
+ */
+bool
+progress_start (Progress *progress)
+{
+  if (progress == NULL)
+    return true;
+
+  progress_stop (progress);
+
+  progress->message = NULL;
+  progress->total = 0;
+  progress->stage = 0;
+  progress->start = clock_ns ();
+  progress->stage_start = progress->start;
+  atomic_store (&progress->done, 0);
+  atomic_store (&progress->expired, false);
+  atomic_store (&progress->deadline,
+                progress->limit > 0 ? progress->start +
+                                      (uint64_t) (progress->limit * 1e9) : 0);
+
+  if (progress->func == NULL)
+    return true;
 
-  if (percent == 100)
+  progress->running = true;
+  if (pthread_create (&progress->thread, NULL, progress_reporter, progress) != 0)
     {
-      prev_percent = -1;
-      printf ("\n");
+      progress->running = false;
+      return false;
     }
+
+  return true;
+}
+
+/*
+ * Stops the deadline and the reporter thread after the last report.
+ */
+void
+progress_stop (Progress *progress)
+{
+  if (progress == NULL)
+    return;
+
+  atomic_store (&progress->deadline, 0);
+  if (!progress->running)
+    return;
+
+  pthread_mutex_lock (&progress->lock);
+  progress->running = false;
+  pthread_cond_signal (&progress->cond);
+  pthread_mutex_unlock (&progress->lock);
+
+  pthread_join (progress->thread, NULL);
+}
+
+/*
+ * Begins the next stage of solve.
+ */
+void
+progress_stage (Progress   *progress,
+                const char *message,
+                int64_t     total)
+{
+  if (progress == NULL)
+    return;
+
+  pthread_mutex_lock (&progress->lock);
+  progress->message = message;
+  progress->total = total;
+  progress->stage++;
+  progress->stage_start = clock_ns ();
+  atomic_store_explicit (&progress->done, 0, memory_order_relaxed);
+  pthread_mutex_unlock (&progress->lock);
+}
+
+/*
+ * Adds the done steps to the counter of stage.
+ */
+void
+progress_step (Progress *progress,
+               int64_t   n_steps)
+{
+  if (progress != NULL)
+    atomic_fetch_add_explicit (&progress->done, n_steps, memory_order_relaxed);
 }
 
+/*
+ * Asks the solve to stop.
+ */
+void
+progress_cancel (Progress *progress)
+{
+  atomic_store_explicit (&progress->cancelled, true, memory_order_relaxed);
+}
+
+/*
+ * Clears the cancellation flag.
+ */
+void
+progress_reset (Progress *progress)
+{
+  atomic_store (&progress->cancelled, false);
+}
+
+/*
+ * Checks the cancellation flag and the deadline of the time limit. A passed
+ * deadline marks the solve expired, so it stays cancelled after it is
+ * stopped, but the next solve starts with a new deadline.
+ */
+bool
+progress_cancelled (Progress *progress)
+{
+  uint64_t deadline;
+
+  if (progress == NULL)
+    return false;
+
+  if (atomic_load_explicit (&progress->cancelled, memory_order_relaxed) ||
+      atomic_load_explicit (&progress->expired, memory_order_relaxed))
+    return true;
+
+  deadline = atomic_load_explicit (&progress->deadline, memory_order_relaxed);
+  if (deadline == 0 || clock_ns () < deadline)
+    return false;
+
+  atomic_store_explicit (&progress->expired, true, memory_order_relaxed);
+
+  return true;
+}
+
+/*
+ * Draws a progress bar to the standard error. The line is built in a buffer
+ * and written at once.
+ */
+void
+progress_print (Progress            *progress,
+                const ProgressState *state,
+                void                *data)
+{
+  char   line[PROGRESS_MESSAGE_WIDTH + PROGRESS_BAR_LENGTH + 64];
+  double rate    = state->seconds > 0 ? state->done / state->seconds : 0;
+  int    percent = 0;
+  int    len, n;
+
+  if (state->total > 0)
+    percent = state->done >= state->total ? 100 :
+              (int) (state->done * 100 / state->total);
+
+  n = snprintf (line, sizeof line, "%-*.*s[", PROGRESS_MESSAGE_WIDTH,
+                PROGRESS_MESSAGE_WIDTH, state->message);
+  len = percent * PROGRESS_BAR_LENGTH / 100;
+  memset (line + n, '#', len);
+  memset (line + n + len, ' ', PROGRESS_BAR_LENGTH - len);
+  n += PROGRESS_BAR_LENGTH;
+
+  n += snprintf (line + n, sizeof line - n, "] %3i%% %9.0f/s", percent, rate);
+  if (!state->finished && state->total > 0 && rate > 0)
+    snprintf (line + n, sizeof line - n, " ETA %5.0fs",
+              (state->total - state->done) / rate);
+  else
+    snprintf (line + n, sizeof line - n, "%11s", "");
+
+  fprintf (stderr, "%s%c", line, state->finished ? '\n' : '\r');
+}
@@ -20,24 +20,185 @@
 #ifndef PROGRESS_H_
 #define PROGRESS_H_
 
+#include <stdbool.h>
+#include <stdint.h>
+
 #define PROGRESS_MESSAGE_WIDTH 30
 #define PROGRESS_BAR_LENGTH    50
+#define PROGRESS_INTERVAL_MS   100
 
 /**
  * SECTION: progress
  * @title: progress
- * @short_description: Shows progress bar into console.
+ * @short_description: Reports progress of a solve and cancels it.
+ *
+ * The solver loops only add to an atomic counter of the current stage and
+ * check a cancellation flag. A reporter thread wakes every
+ * %PROGRESS_INTERVAL_MS milliseconds, takes a snapshot of the counter and
+ * passes it to a callback, so no output is done in the loops. The time limit
+ * needs no thread: the check of cancellation compares the clock with the
+ * deadline of the solve.
+ */
+
+typedef struct _Progress Progress;
+
+/**
+ * ProgressState:
+ * @message:  Message about the stage or %NULL before the first stage
+ * @done:     Number of done steps of the stage
+ * @total:    Number of all steps of the stage, 0 if unknown
+ * @seconds:  Seconds since the start of stage
+ * @finished: The stage is over, it is the last report of the stage
+ *
+ * A snapshot of progress passed to the callback.
+ */
+typedef struct
+{
+  const char *message;
+  int64_t     done;
+  int64_t     total;
+  double      seconds;
+  bool        finished;
+} ProgressState;
+
+/**
+ * ProgressFunc:
+ * @progress: The progress
+ * @state:    The snapshot of progress
+ * @data:     The data passed to progress_new()
+ *
+ * Reports progress, called from the reporter thread.
+ */
+typedef void (*ProgressFunc) (Progress            *progress,
+                              const ProgressState *state,
+                              void                *data);
+
+/**
+ * progress_new:
+ * @func: A callback to report progress or %NULL
+ * @data: The data to pass to callback
+ *
+ * Creates a progress of solve. Without callback and time limit the progress
+ * only counts the steps and keeps the cancellation flag.
+ *
+ * Returns: A new progress or %NULL if out of memory
+ */
+Progress *
+progress_new (ProgressFunc  func,
+              void         *data);
+
+/**
+ * progress_free:
+ * @progress: A progress or %NULL
+ *
+ * Stops the reporter thread and releases the progress.
+ */
+void
+progress_free (Progress *progress);
+
+/**
+ * progress_set_limit:
+ * @progress: A progress
+ * @seconds:  Time limit of the solve in seconds, 0 for no limit
+ *
+ * Sets the time limit of the next solves. A solve is cancelled by the first
+ * check of cancellation after the limit.
+ */
+void
+progress_set_limit (Progress *progress,
+                    double    seconds);
+
+/**
+ * progress_start:
+ * @progress: A progress or %NULL
+ *
+ * Starts a solve: clears the stage, sets the deadline of the time limit and
+ * starts the reporter thread, if there is a callback. The cancellation flag
+ * is kept, so a cancel coming before the start is not lost.
+ *
+ * Returns: A success flag
  */
+bool
+progress_start (Progress *progress);
 
 /**
- * show_progress:
- * @message: Message about progress
- * @percent: Percent of progress
+ * progress_stop:
+ * @progress: A progress or %NULL
  *
- * Shows progress bar into console.
- **/
+ * Stops the deadline of the solve and the reporter thread after the last
+ * report of the current stage.
+ */
+void
+progress_stop (Progress *progress);
+
+/**
+ * progress_stage:
+ * @progress: A progress or %NULL
+ * @message:  Message about the stage, a static string
+ * @total:    Number of steps of the stage, 0 if unknown
+ *
+ * Begins the next stage of solve and zeros the counter of steps.
+ */
+void
+progress_stage (Progress   *progress,
+                const char *message,
+                int64_t     total);
+
+/**
+ * progress_step:
+ * @progress: A progress or %NULL
+ * @n_steps:  Number of done steps
+ *
+ * Adds the done steps to the atomic counter of stage.
+ */
+void
+progress_step (Progress *progress,
+               int64_t   n_steps);
+
+/**
+ * progress_cancel:
+ * @progress: A progress
+ *
+ * Asks the solve to stop. It is safe to call from a signal handler. The
+ * flag stays set until progress_reset(), so the next solves stop too.
+ */
+void
+progress_cancel (Progress *progress);
+
+/**
+ * progress_reset:
+ * @progress: A progress
+ *
+ * Clears the cancellation flag, so the next solves run again.
+ */
+void
+progress_reset (Progress *progress);
+
+/**
+ * progress_cancelled:
+ * @progress: A progress or %NULL
+ *
+ * Checks the cancellation flag by a relaxed atomic load and the deadline of
+ * the time limit by the monotonic clock. A passed deadline cancels only the
+ * current solve.
+ *
+ * Returns: %TRUE if the solve should stop
+ */
+bool
+progress_cancelled (Progress *progress);
+
+/**
+ * progress_print:
+ * @progress: The progress
+ * @state:    The snapshot of progress
+ * @data:     Unused
+ *
+ * Draws a progress bar with the rate and the remaining time of stage to the
+ * standard error, a callback for progress_new().
+ */
 void
-show_progress (const char *message,
-               int         percent);
+progress_print (Progress            *progress,
+                const ProgressState *state,
+                void                *data);
 
 #endif
@@ -0,0 +1,129 @@
+/*
+ * smallboard.c
+ *
+ * Copyright (C) 2017 - Pavel Nikitin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "smallboard.h"
+
+/*
+ * The gaussed system of a size: n transform words, the first @rank of them
+ * give the solution, the rest must give zeros; then n - @rank kernel words.
+ */
+typedef struct
+{
+  int rank;
+  int offset;
+} SmallBoard;
+
+#include "smalltables.h"
+
+/*
+ * Checks whether the size is solved by tables.
+ */
+bool
+small_board_fits (int n_rows,
+                  int n_cols)
+{
+  return 0 < n_rows && n_rows <= SMALL_BOARD_MAX_SIZE &&
+         0 < n_cols && n_cols <= SMALL_BOARD_MAX_SIZE;
+}
+
+/*
+ * Packs a small field to a word, the bits past the columns are dropped.
+ */
+uint64_t
+small_board_pack (word_t **field,
+                  int      n_rows,
+                  int      n_cols)
+{
+  uint64_t mask  = ((uint64_t) 1 << n_cols) - 1;
+  uint64_t board = 0;
+  int      row;
+
+  for (row = 0; row < n_rows; row++)
+    board |= ((uint64_t) field[row][0] & mask) << (n_cols * row);
+
+  return board;
+}
+
+/*
+ * Unpacks a small field from a word.
+ */
+void
+small_board_unpack (uint64_t  board,
+                    word_t  **field,
+                    int       n_rows,
+                    int       n_cols)
+{
+  word_t mask = BIT_MASK (n_cols) - 1;
+  int    row;
+
+  for (row = 0; row < n_rows; row++)
+    field[row][0] = (board >> (n_cols * row)) & mask;
+}
+
+/*
+ * Solves a small puzzle Lights Off by tables.
+ */
+bool
+small_board_solve (int       n_rows,
+                   int       n_cols,
+                   uint64_t  field,
+                   uint64_t *solution,
+                   int      *n_solutions,
+                   int      *min_weight)
+{
+  const SmallBoard *board     = &small_boards[n_rows - 1][n_cols - 1];
+  const uint64_t   *transform = small_board_words + board->offset;
+  int               n         = n_rows * n_cols;
+  int               n_kernel  = n - board->rank;
+  const uint64_t   *kernel    = transform + n;
+  uint64_t          sum       = 0;
+  int               weight, i, gray, best;
+
+  /* Zero rows of the gaussed system must have zero right part */
+  for (i = board->rank; i < n; i++)
+    {
+      if (__builtin_parityll (transform[i] & field))
+        return false;
+    }
+
+  for (i = 0; i < board->rank; i++)
+    sum |= (uint64_t) __builtin_parityll (transform[i] & field) << i;
+
+  /* Walk the coset in the Gray code order, but prefer the least index of
+   * solution as find_shortest_solution() does */
+  *solution = sum;
+  *min_weight = __builtin_popcountll (sum);
+  best = 0;
+  for (i = 1; i < (1 << n_kernel); i++)
+    {
+      sum ^= kernel[__builtin_ctz (i)];
+      gray = i ^ (i >> 1);
+      weight = __builtin_popcountll (sum);
+      if (weight < *min_weight || (weight == *min_weight && gray < best))
+        {
+          *min_weight = weight;
+          *solution = sum;
+          best = gray;
+        }
+    }
+
+  *n_solutions = 1 << n_kernel;
+
+  return true;
+}
@@ -0,0 +1,105 @@
+/*
+ * smallboard.h
+ *
+ * Copyright (C) 2017 - Pavel Nikitin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SMALL_BOARD_H_
+#define SMALL_BOARD_H_
+
+#include <stdint.h>
+#include "boolmatrix.h"
+
+#define SMALL_BOARD_MAX_SIZE 8
+
+/**
+ * SECTION: smallboard
+ * @title: smallboard
+ * @short_description: Solves the boards of up to 8 x 8 cells by tables.
+ *
+ * A board of up to %SMALL_BOARD_MAX_SIZE x %SMALL_BOARD_MAX_SIZE cells is
+ * packed to a 64-bit word, the cell (row, col) is the bit n_cols * row + col.
+ * The transform of the Gauss method and the kernel of every size are
+ * generated at build time by tools/gensmall.c, so a board is solved by a few
+ * AND and parity operations without any allocation.
+ */
+
+/**
+ * small_board_fits:
+ * @n_rows: Number of rows in the field
+ * @n_cols: Number of columns in the field
+ *
+ * Checks whether the size is solved by tables.
+ *
+ * Returns: %TRUE if the board is small
+ */
+bool
+small_board_fits (int n_rows,
+                  int n_cols);
+
+/**
+ * small_board_pack:
+ * @field:  The puzzle field as the boolean matrix
+ * @n_rows: Number of rows in the field
+ * @n_cols: Number of columns in the field
+ *
+ * Packs a small field to a word, the bits past the columns are dropped.
+ *
+ * Returns: The packed field
+ */
+uint64_t
+small_board_pack (word_t **field,
+                  int      n_rows,
+                  int      n_cols);
+
+/**
+ * small_board_unpack:
+ * @board:  The packed field
+ * @field:  The boolean matrix to unpack to
+ * @n_rows: Number of rows in the field
+ * @n_cols: Number of columns in the field
+ *
+ * Unpacks a small field from a word.
+ */
+void
+small_board_unpack (uint64_t  board,
+                    word_t  **field,
+                    int       n_rows,
+                    int       n_cols);
+
+/**
+ * small_board_solve:
+ * @n_rows:             Number of rows in the field
+ * @n_cols:             Number of columns in the field
+ * @field:              The packed field
+ * @solution:    (out): The packed solution
+ * @n_solutions: (out): Number of all solutions
+ * @min_weight:  (out): The weight of solution as number of ones
+ *
+ * Solves a small puzzle Lights Off by tables. The solution is the same as
+ * lightsoff_solve() finds.
+ *
+ * Returns: %FALSE if there is no solution
+ */
+bool
+small_board_solve (int       n_rows,
+                   int       n_cols,
+                   uint64_t  field,
+                   uint64_t *solution,
+                   int      *n_solutions,
+                   int      *min_weight);
+
+#endif
@@ -0,0 +1,808 @@
+/*
+ * solverd.c
+ *
+ * Copyright (C) 2017 - Pavel Nikitin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "smallboard.h"
+#include "solverd.h"
+
+typedef struct _SolverdCache SolverdCache;
+
+struct _SolverdCache
+{
+  LightsoffFactor *factor;
+  int              n_rows;
+  int              n_cols;
+  size_t           bytes;
+  int              n_users;
+  bool             failed;
+  SolverdCache    *next;
+};
+
+/* A list of connections */
+typedef struct
+{
+  int *fds;
+  int  n_fds;
+  int  capacity;
+} FdList;
+
+struct _Solverd
+{
+  int             listen_fd;
+  int             wake_fds[2];
+  double          time_limit;
+  pthread_mutex_t lock;
+  pthread_cond_t  factored;
+  pthread_cond_t  queued;
+  FdList          ready;
+  FdList          idle;
+  bool            stopped;
+  SolverdCache   *cache;
+  size_t          cache_bytes;
+  size_t          cache_limit;
+  int             n_factorized;
+};
+
+/*
+ * Appends a connection to the list. Returns false if out of memory.
+ */
+static bool
+fd_list_push (FdList *list,
+              int     fd)
+{
+  int *fds;
+
+  if (list->n_fds == list->capacity)
+    {
+      fds = realloc (list->fds, (2 * list->capacity + 16) * sizeof *fds);
+      if (fds == NULL)
+        return false;
+      list->fds = fds;
+      list->capacity = 2 * list->capacity + 16;
+    }
+
+  list->fds[list->n_fds++] = fd;
+
+  return true;
+}
+
+/*
+ * Closes the connections of the list and releases it.
+ */
+static void
+fd_list_close (FdList *list)
+{
+  int i;
+
+  for (i = 0; i < list->n_fds; i++)
+    close (list->fds[i]);
+
+  free (list->fds);
+  list->fds = NULL;
+  list->n_fds = list->capacity = 0;
+}
+
+/*
+ * Reads exactly @size bytes from the socket.
+ */
+static bool
+read_all (int     fd,
+          void   *buf,
+          size_t  size)
+{
+  uint8_t *p = buf;
+  ssize_t  n;
+
+  while (size > 0)
+    {
+      n = read (fd, p, size);
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n <= 0)
+        return false;
+
+      p += n;
+      size -= n;
+    }
+
+  return true;
+}
+
+/*
+ * Writes exactly @size bytes to the socket.
+ */
+static bool
+write_all (int         fd,
+           const void *buf,
+           size_t      size)
+{
+  const uint8_t *p = buf;
+  ssize_t        n;
+
+  while (size > 0)
+    {
+      n = write (fd, p, size);
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n <= 0)
+        return false;
+
+      p += n;
+      size -= n;
+    }
+
+  return true;
+}
+
+/*
+ * Unpacks a row of bytes to the boolean array. The bits of the last byte
+ * past the columns are dropped, the client may leave them dirty.
+ */
+static void
+unpack_row (const uint8_t *bytes,
+            word_t        *row,
+            int            n_cols)
+{
+  int     n_bytes = (n_cols + 7) / 8;
+  uint8_t byte;
+  int     i;
+
+  for (i = 0; i < n_bytes; i++)
+    {
+      byte = bytes[i];
+      if (i == n_bytes - 1 && n_cols % 8 != 0)
+        byte &= (1U << n_cols % 8) - 1;
+      row[i / sizeof *row] |= (word_t) byte << (8 * (i % sizeof *row));
+    }
+}
+
+/*
+ * Packs the boolean array to a row of bytes.
+ */
+static void
+pack_row (const word_t *row,
+          uint8_t      *bytes,
+          int           n_bytes)
+{
+  int i;
+
+  for (i = 0; i < n_bytes; i++)
+    bytes[i] = row[i / sizeof *row] >> (8 * (i % sizeof *row));
+}
+
+/*
+ * Counts the memory of a factor.
+ */
+static size_t
+factor_bytes (const LightsoffFactor *factor)
+{
+  size_t n = (size_t) factor->n_rows * factor->n_cols;
+  size_t row_bytes = bool_array_n_words (n) * sizeof (word_t);
+
+  return sizeof (SolverdCache) + sizeof *factor + n * sizeof *factor->order +
+         n * (sizeof *factor->transform + row_bytes) +
+         (n - factor->rank) * (sizeof *factor->kernel + row_bytes);
+}
+
+/*
+ * Finds the entry of the field size and moves it to the head of the cache,
+ * so the cache is ordered from the recently used entries.
+ */
+static SolverdCache *
+cache_find (Solverd *solverd,
+            int      n_rows,
+            int      n_cols)
+{
+  SolverdCache **link, *entry;
+
+  for (link = &solverd->cache; *link != NULL; link = &(*link)->next)
+    {
+      entry = *link;
+      if (entry->n_rows == n_rows && entry->n_cols == n_cols)
+        {
+          *link = entry->next;
+          entry->next = solverd->cache;
+          solverd->cache = entry;
+          return entry;
+        }
+    }
+
+  return NULL;
+}
+
+/*
+ * Releases the least recently used factors, which no request solves by,
+ * until the cache fits its limit.
+ */
+static void
+cache_evict (Solverd *solverd)
+{
+  SolverdCache **link, **victim, *entry;
+
+  while (solverd->cache_bytes > solverd->cache_limit)
+    {
+      victim = NULL;
+      for (link = &solverd->cache; *link != NULL; link = &(*link)->next)
+        {
+          if ((*link)->n_users == 0)
+            victim = link;
+        }
+
+      if (victim == NULL)
+        break;
+
+      entry = *victim;
+      *victim = entry->next;
+      solverd->cache_bytes -= entry->bytes;
+      lightsoff_factor_free (entry->factor);
+      free (entry);
+    }
+}
+
+/*
+ * Gets the factorized system for the field size from the cache. Factorizes
+ * the system out of the lock, so the other sizes are served meanwhile. The
+ * requests of a size in factorization wait for it, the entry is used until
+ * solverd_release().
+ */
+static SolverdCache *
+solverd_factor (Solverd  *solverd,
+                int       n_rows,
+                int       n_cols,
+                Progress *progress)
+{
+  SolverdCache   **link, *entry;
+  LightsoffFactor *factor;
+
+  pthread_mutex_lock (&solverd->lock);
+  while ((entry = cache_find (solverd, n_rows, n_cols)) != NULL)
+    {
+      /* All requests have the same limit, so the factorizing one has the
+       * earlier deadline and ends first */
+      entry->n_users++;
+      while (entry->factor == NULL && !entry->failed)
+        pthread_cond_wait (&solverd->factored, &solverd->lock);
+
+      if (entry->factor != NULL)
+        {
+          pthread_mutex_unlock (&solverd->lock);
+          return entry;
+        }
+
+      /* The failed entry is out of the cache, the last user frees it */
+      if (--entry->n_users == 0)
+        free (entry);
+
+      if (progress_cancelled (progress))
+        {
+          pthread_mutex_unlock (&solverd->lock);
+          return NULL;
+        }
+    }
+
+  entry = calloc (1, sizeof *entry);
+  if (entry != NULL)
+    {
+      entry->n_rows = n_rows;
+      entry->n_cols = n_cols;
+      entry->n_users = 1;
+      entry->next = solverd->cache;
+      solverd->cache = entry;
+    }
+  pthread_mutex_unlock (&solverd->lock);
+
+  if (entry == NULL)
+    return NULL;
+
+  factor = lightsoff_factor_new (n_rows, n_cols, STENCIL_PLUS, progress);
+
+  pthread_mutex_lock (&solverd->lock);
+  if (factor != NULL)
+    {
+      entry->factor = factor;
+      entry->bytes = factor_bytes (factor);
+      solverd->cache_bytes += entry->bytes;
+      solverd->n_factorized++;
+      cache_evict (solverd);
+    }
+  else
+    {
+      /* Unlink the entry, so the waiting requests factorize again */
+      for (link = &solverd->cache; *link != entry; link = &(*link)->next)
+        ;
+      *link = entry->next;
+      entry->failed = true;
+      if (--entry->n_users == 0)
+        free (entry);
+      entry = NULL;
+    }
+  pthread_cond_broadcast (&solverd->factored);
+  pthread_mutex_unlock (&solverd->lock);
+
+  return entry;
+}
+
+/*
+ * Releases the entry of cache after the solve, the factors over the limit
+ * are freed.
+ */
+static void
+solverd_release (Solverd      *solverd,
+                 SolverdCache *entry)
+{
+  pthread_mutex_lock (&solverd->lock);
+  entry->n_users--;
+  cache_evict (solverd);
+  pthread_mutex_unlock (&solverd->lock);
+}
+
+/*
+ * Serves one request of the connection. All memory of the request is taken
+ * from the arena of worker, the solve is limited in time by the progress of
+ * worker.
+ */
+bool
+solverd_serve (Solverd  *solverd,
+               Arena    *arena,
+               Progress *progress,
+               int       fd)
+{
+  uint32_t               header[3];
+  int32_t                reply[3]    = { 8, -1, 0 };
+  bool                   success     = false;
+  uint8_t               *rows        = NULL;
+  word_t               **field       = NULL;
+  word_t               **solution    = NULL;
+  const LightsoffFactor *factor      = NULL;
+  SolverdCache          *entry       = NULL;
+  int                    n_rows, n_cols, n_bytes, n_solutions, weight, i;
+
+  if (!read_all (fd, header, sizeof header))
+    return false;
+
+  n_rows = header[1];
+  n_cols = header[2];
+  n_bytes = (n_cols + 7) / 8;
+
+  /* Validate the request */
+  if (n_rows > 0 && n_cols > 0 &&
+      (uint64_t) header[1] * header[2] <= SOLVERD_MAX_CELLS &&
+      header[0] == 8 + (uint64_t) n_rows * n_bytes)
+    {
+      arena_reset (arena);
+      rows = arena_alloc (arena, n_rows * n_bytes);
+      field = bool_matrix_new_in (arena, n_rows, n_cols);
+      success = rows != NULL && field != NULL &&
+                read_all (fd, rows, n_rows * n_bytes);
+    }
+
+  if (success)
+    {
+      for (i = 0; i < n_rows; i++)
+        unpack_row (rows + i * n_bytes, field[i], n_cols);
+
+      /* Small boards are solved by tables without a factor */
+      progress_start (progress);
+      if (!small_board_fits (n_rows, n_cols))
+        {
+          entry = solverd_factor (solverd, n_rows, n_cols, progress);
+          factor = entry != NULL ? entry->factor : NULL;
+          success = entry != NULL;
+        }
+    }
+
+  if (success)
+    {
+      if (factor != NULL)
+        solution = lightsoff_factor_solve_in (arena, factor, field,
+                                              &n_solutions, &weight,
+                                              progress);
+      else
+        solution = lightsoff_solve_in (arena, field, n_rows, n_cols,
+                                       STENCIL_PLUS, &n_solutions, &weight,
+                                       progress);
+      reply[1] = progress_cancelled (progress) ? SOLVERD_TIMED_OUT :
+                                                 n_solutions;
+      reply[2] = weight;
+      if (solution != NULL)
+        {
+          reply[0] += n_rows * n_bytes;
+          for (i = 0; i < n_rows; i++)
+            pack_row (solution[i], rows + i * n_bytes, n_bytes);
+        }
+
+      success = write_all (fd, reply, sizeof reply) &&
+                (solution == NULL || write_all (fd, rows, n_rows * n_bytes));
+    }
+  else if (progress_cancelled (progress))
+    {
+      /* The factorization is out of time, the request itself is fine */
+      reply[1] = SOLVERD_TIMED_OUT;
+      success = write_all (fd, reply, sizeof reply);
+    }
+  else
+    write_all (fd, reply, sizeof reply);
+
+  if (entry != NULL)
+    solverd_release (solverd, entry);
+  progress_stop (progress);
+
+  return success;
+}
+
+/*
+ * Serves one request of a ready connection at once. The connection is handed
+ * back to the polling thread after the request, so an idle client does not
+ * hold the worker.
+ */
+static void *
+solverd_worker (void *data)
+{
+  Solverd  *solverd  = data;
+  Arena    *arena    = arena_new (0);
+  Progress *progress = NULL;
+  bool      kept;
+  int       fd;
+
+  /* The progress only cancels the requests by the deadline, no thread runs */
+  if (solverd->time_limit > 0)
+    {
+      progress = progress_new (NULL, NULL);
+      if (progress != NULL)
+        progress_set_limit (progress, solverd->time_limit);
+    }
+
+  if (arena == NULL || (progress == NULL && solverd->time_limit > 0))
+    {
+      arena_free (arena);
+      progress_free (progress);
+      return NULL;
+    }
+
+  for (;;)
+    {
+      pthread_mutex_lock (&solverd->lock);
+      while (solverd->ready.n_fds == 0 && !solverd->stopped)
+        pthread_cond_wait (&solverd->queued, &solverd->lock);
+
+      if (solverd->stopped)
+        {
+          pthread_mutex_unlock (&solverd->lock);
+          break;
+        }
+
+      /* The connections are served in the order they got ready */
+      fd = solverd->ready.fds[0];
+      solverd->ready.n_fds--;
+      memmove (solverd->ready.fds, solverd->ready.fds + 1,
+               solverd->ready.n_fds * sizeof *solverd->ready.fds);
+      pthread_mutex_unlock (&solverd->lock);
+
+      if (!solverd_serve (solverd, arena, progress, fd))
+        {
+          close (fd);
+          continue;
+        }
+
+      pthread_mutex_lock (&solverd->lock);
+      kept = fd_list_push (&solverd->idle, fd);
+      pthread_mutex_unlock (&solverd->lock);
+
+      if (!kept)
+        close (fd);
+      else if (write (solverd->wake_fds[1], "", 1) < 0 && errno != EAGAIN)
+        perror ("write");
+    }
+
+  arena_free (arena);
+  progress_free (progress);
+
+  return NULL;
+}
+
+/*
+ * Adds a connection to the polled ones. Returns false if out of memory.
+ */
+static bool
+poll_add (struct pollfd **polls,
+          int            *n_polls,
+          int            *capacity,
+          int             fd)
+{
+  struct pollfd *grown;
+
+  if (*n_polls == *capacity)
+    {
+      grown = realloc (*polls, (2 * *capacity + 16) * sizeof *grown);
+      if (grown == NULL)
+        return false;
+      *polls = grown;
+      *capacity = 2 * *capacity + 16;
+    }
+
+  (*polls)[*n_polls].fd = fd;
+  (*polls)[*n_polls].events = POLLIN;
+  (*polls)[*n_polls].revents = 0;
+  (*n_polls)++;
+
+  return true;
+}
+
+/*
+ * Accepts the connections and polls the idle ones. A connection with a
+ * request is queued to the workers and is not polled until a worker hands
+ * it back. Returns on error of the socket.
+ */
+static void
+solverd_dispatch (Solverd *solverd)
+{
+  struct pollfd *polls    = NULL;
+  int            n_polls  = 0;
+  int            capacity = 0;
+  char           wakes[256];
+  int            fd, i;
+
+  if (!poll_add (&polls, &n_polls, &capacity, solverd->listen_fd) ||
+      !poll_add (&polls, &n_polls, &capacity, solverd->wake_fds[0]))
+    {
+      free (polls);
+      return;
+    }
+
+  for (;;)
+    {
+      if (poll (polls, n_polls, -1) < 0)
+        {
+          if (errno == EINTR)
+            continue;
+          perror ("poll");
+          break;
+        }
+
+      /* Queue the connections with a request or closed by the client */
+      pthread_mutex_lock (&solverd->lock);
+      for (i = n_polls - 1; i >= 2; i--)
+        {
+          if (polls[i].revents == 0)
+            continue;
+
+          if (fd_list_push (&solverd->ready, polls[i].fd))
+            pthread_cond_signal (&solverd->queued);
+          else
+            close (polls[i].fd);
+          polls[i] = polls[--n_polls];
+        }
+
+      /* Poll the connections handed back by the workers */
+      if (polls[1].revents != 0)
+        {
+          if (read (solverd->wake_fds[0], wakes, sizeof wakes) < 0)
+            perror ("read");
+          for (i = 0; i < solverd->idle.n_fds; i++)
+            {
+              if (!poll_add (&polls, &n_polls, &capacity,
+                             solverd->idle.fds[i]))
+                close (solverd->idle.fds[i]);
+            }
+          solverd->idle.n_fds = 0;
+        }
+      pthread_mutex_unlock (&solverd->lock);
+
+      if (polls[0].revents != 0)
+        {
+          fd = accept (solverd->listen_fd, NULL, NULL);
+          if (fd < 0 && errno != EINTR && errno != ECONNABORTED)
+            {
+              perror ("accept");
+              break;
+            }
+          if (fd >= 0 && !poll_add (&polls, &n_polls, &capacity, fd))
+            close (fd);
+        }
+    }
+
+  for (i = 2; i < n_polls; i++)
+    close (polls[i].fd);
+  free (polls);
+}
+
+/*
+ * Creates a daemon without a socket.
+ */
+Solverd *
+solverd_new (double time_limit,
+             size_t cache_limit)
+{
+  Solverd *solverd = calloc (1, sizeof *solverd);
+
+  if (solverd == NULL)
+    return NULL;
+
+  solverd->listen_fd = -1;
+  solverd->wake_fds[0] = solverd->wake_fds[1] = -1;
+  solverd->time_limit = time_limit;
+  solverd->cache_limit = cache_limit;
+  pthread_mutex_init (&solverd->lock, NULL);
+  pthread_cond_init (&solverd->factored, NULL);
+  pthread_cond_init (&solverd->queued, NULL);
+
+  return solverd;
+}
+
+/*
+ * Releases a daemon with its cache and the queued connections.
+ */
+void
+solverd_free (Solverd *solverd)
+{
+  SolverdCache *entry;
+
+  if (solverd == NULL)
+    return;
+
+  fd_list_close (&solverd->ready);
+  fd_list_close (&solverd->idle);
+
+  while (solverd->cache != NULL)
+    {
+      entry = solverd->cache;
+      solverd->cache = entry->next;
+      lightsoff_factor_free (entry->factor);
+      free (entry);
+    }
+
+  pthread_cond_destroy (&solverd->queued);
+  pthread_cond_destroy (&solverd->factored);
+  pthread_mutex_destroy (&solverd->lock);
+  free (solverd);
+}
+
+/*
+ * Gets the statistics of the cache.
+ */
+void
+solverd_get_stats (Solverd      *solverd,
+                   SolverdStats *stats)
+{
+  SolverdCache *entry;
+
+  pthread_mutex_lock (&solverd->lock);
+  stats->n_cached = 0;
+  for (entry = solverd->cache; entry != NULL; entry = entry->next)
+    {
+      if (entry->factor != NULL)
+        stats->n_cached++;
+    }
+  stats->n_factorized = solverd->n_factorized;
+  stats->bytes = solverd->cache_bytes;
+  pthread_mutex_unlock (&solverd->lock);
+}
+
+/*
+ * Serves solve requests on a Unix domain socket.
+ */
+int
+solverd_run (const char *socket_path,
+             int         n_workers,
+             double      time_limit)
+{
+  struct sockaddr_un addr;
+  Solverd           *solverd;
+  pthread_t         *workers;
+  int                listen_fd, wake_fds[2], n_started, i;
+
+  if (strlen (socket_path) >= sizeof addr.sun_path)
+    {
+      fprintf (stderr, "Socket path is too long: %s\n", socket_path);
+      return -1;
+    }
+
+  memset (&addr, 0, sizeof addr);
+  addr.sun_family = AF_UNIX;
+  strcpy (addr.sun_path, socket_path);
+
+  /* The clients may go away before the response */
+  signal (SIGPIPE, SIG_IGN);
+
+  listen_fd = socket (AF_UNIX, SOCK_STREAM, 0);
+  if (listen_fd < 0)
+    {
+      perror ("socket");
+      return -1;
+    }
+
+  /* The workers wake the polling thread by a byte, a full pipe wakes it
+   * already */
+  if (pipe (wake_fds) < 0 || fcntl (wake_fds[1], F_SETFL, O_NONBLOCK) < 0)
+    {
+      perror ("pipe");
+      close (listen_fd);
+      return -1;
+    }
+
+  unlink (socket_path);
+  if (bind (listen_fd, (struct sockaddr *) &addr, sizeof addr) < 0 ||
+      listen (listen_fd, SOMAXCONN) < 0)
+    {
+      perror (socket_path);
+      close (listen_fd);
+      close (wake_fds[0]);
+      close (wake_fds[1]);
+      return -1;
+    }
+
+  if (n_workers < 1)
+    n_workers = 1;
+
+  workers = malloc (n_workers * sizeof *workers);
+  solverd = solverd_new (time_limit, SOLVERD_CACHE_BYTES);
+  if (workers == NULL || solverd == NULL)
+    {
+      free (workers);
+      solverd_free (solverd);
+      close (listen_fd);
+      close (wake_fds[0]);
+      close (wake_fds[1]);
+      return -1;
+    }
+
+  solverd->listen_fd = listen_fd;
+  solverd->wake_fds[0] = wake_fds[0];
+  solverd->wake_fds[1] = wake_fds[1];
+  for (n_started = 0; n_started < n_workers; n_started++)
+    {
+      if (pthread_create (&workers[n_started], NULL, solverd_worker,
+                          solverd) != 0)
+        {
+          fprintf (stderr, "Unable to start worker %i of %i\n",
+                   n_started + 1, n_workers);
+          break;
+        }
+    }
+
+  /* Serve until an error of the socket, then stop the workers */
+  if (n_started > 0)
+    solverd_dispatch (solverd);
+
+  pthread_mutex_lock (&solverd->lock);
+  solverd->stopped = true;
+  pthread_cond_broadcast (&solverd->queued);
+  pthread_mutex_unlock (&solverd->lock);
+
+  for (i = 0; i < n_started; i++)
+    pthread_join (workers[i], NULL);
+
+  solverd_free (solverd);
+  close (listen_fd);
+  close (wake_fds[0]);
+  close (wake_fds[1]);
+  unlink (socket_path);
+  free (workers);
+
+  return -1;
+}
@@ -0,0 +1,146 @@
+/*
+ * solverd.h
+ *
+ * Copyright (C) 2017 - Pavel Nikitin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SOLVERD_H_
+#define SOLVERD_H_
+
+#include "lightsoffsolver.h"
+
+#define SOLVERD_MAX_CELLS 16384
+#define SOLVERD_TIMED_OUT -2
+
+/* Memory of the cached factors, the least recently used ones are freed */
+#define SOLVERD_CACHE_BYTES ((size_t) 256 << 20)
+
+/**
+ * SECTION: solverd
+ * @title: solverd
+ * @short_description: Serves solve requests on a Unix domain socket.
+ *
+ * The solver daemon accepts connections on a Unix domain socket and serves
+ * them by a fixed pool of worker threads. A connection carries any number
+ * of requests, each answered in order. The calling thread polls the idle
+ * connections and queues a connection with a request to the workers, so a
+ * worker is held by a request, not by a connection. The factorized systems
+ * are cached by the field size, so the repeated sizes are solved without the
+ * Gauss method. The cache keeps the recently used sizes within its limit,
+ * %SOLVERD_CACHE_BYTES for the daemon, a size is factorized once, the other
+ * requests of it wait for the factor.
+ *
+ * All integers of the protocol are 32-bit in the host byte order. The rows of
+ * a field are packed to (n_cols + 7) / 8 bytes, the column col is the bit
+ * col % 8 of the byte col / 8. The bits past the columns are ignored.
+ *
+ * Request:  length, n_rows, n_cols, n_rows packed rows of the field.
+ * Response: length, n_solutions, weight, n_rows packed rows of the solution.
+ *
+ * The length counts the bytes following it. The response has no rows if
+ * n_solutions is 0 (no solution), -1 (malformed request) or -2 (the solve
+ * ran out of the time limit). A malformed request closes the connection.
+ * The weight is -1 if there are too many solutions to search for the
+ * lightest one, then the solution is any of them.
+ */
+
+typedef struct _Solverd Solverd;
+
+/**
+ * SolverdStats:
+ * @n_cached:     Number of the factors in the cache
+ * @n_factorized: Number of the factorizations made, the evicted sizes are
+ *                factorized again
+ * @bytes:        Memory of the cached factors in bytes
+ *
+ * The statistics of the cache of factors.
+ */
+typedef struct
+{
+  int    n_cached;
+  int    n_factorized;
+  size_t bytes;
+} SolverdStats;
+
+/**
+ * solverd_new:
+ * @time_limit:  Seconds to solve a request by a worker, 0 for no limit
+ * @cache_limit: Memory of the cached factors in bytes
+ *
+ * Creates a daemon with an empty cache and without a socket, its requests
+ * are served by solverd_serve().
+ *
+ * Returns: A new daemon or %NULL if out of memory
+ **/
+Solverd *
+solverd_new (double time_limit,
+             size_t cache_limit);
+
+/**
+ * solverd_free:
+ * @solverd: A daemon or %NULL
+ *
+ * Releases a daemon with its cache and the connections queued to it.
+ **/
+void
+solverd_free (Solverd *solverd);
+
+/**
+ * solverd_serve:
+ * @solverd:  A daemon
+ * @arena:    The scratch memory of the request, it is reset
+ * @progress: A progress to limit the solve in time or %NULL
+ * @fd:       A connection
+ *
+ * Reads one request of the connection and writes the response. A malformed
+ * request is answered by -1. It may be called by several threads at once.
+ *
+ * Returns: %FALSE if the connection should be closed
+ **/
+bool
+solverd_serve (Solverd  *solverd,
+               Arena    *arena,
+               Progress *progress,
+               int       fd);
+
+/**
+ * solverd_get_stats:
+ * @solverd:      A daemon
+ * @stats: (out): The statistics of the cache
+ *
+ * Gets the statistics of the cache of factors.
+ **/
+void
+solverd_get_stats (Solverd      *solverd,
+                   SolverdStats *stats);
+
+/**
+ * solverd_run:
+ * @socket_path: Path of the Unix domain socket to listen
+ * @n_workers:   Number of worker threads
+ * @time_limit:  Seconds to solve a request, 0 for no limit
+ *
+ * Serves solve requests on a Unix domain socket. Returns only on error. A
+ * request out of the time limit is cancelled by the progress of worker.
+ *
+ * Returns: -1 on error
+ **/
+int
+solverd_run (const char *socket_path,
+             int         n_workers,
+             double      time_limit);
+
+#endif
@@ -0,0 +1,375 @@
+/*
+ * stencil.c
+ *
+ * Copyright (C) 2017 - Pavel Nikitin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "stencil.h"
+
+/*
+ * A stencil is the band of three cells of its row and the band of the rows
+ * above and below. The bit 0 of band is the left neighbour, the bit 1 is the
+ * cell itself, the bit 2 is the right neighbour.
+ */
+typedef struct
+{
+  const char *name;
+  word_t      middle;
+  word_t      sides;
+  bool        wrap;
+} StencilInfo;
+
+static const StencilInfo stencil_info[STENCIL_N_STENCILS] =
+{
+  { "plus",  7, 2, false },
+  { "cross", 2, 5, false },
+  { "king",  7, 7, false },
+  { "torus", 7, 2, true  }
+};
+
+/*
+ * Ors a band of three bits into the boolean array. The bit 0 of band goes to
+ * @index - 1, so the band may cross the boundary of words.
+ */
+static void
+or_band (word_t *array,
+         int     index,
+         word_t  band)
+{
+  int start = index - 1;
+  int shift;
+
+  /* The left neighbor of the first cell is already dropped */
+  if (start < 0)
+    {
+      band >>= 1;
+      start = 0;
+    }
+
+  shift = BIT_INDEX (start);
+  array[ARRAY_INDEX (start)] |= band << shift;
+  if (shift > WORD_BITS - 3 && (band >> (WORD_BITS - shift)) != 0)
+    array[ARRAY_INDEX (start) + 1] |= band >> (WORD_BITS - shift);
+}
+
+/*
+ * Gets the word of the xor of two rows, zero out of the rows. Any of rows
+ * may be NULL.
+ */
+static word_t
+row_word (const word_t *row,
+          const word_t *other,
+          int           k,
+          int           n_words)
+{
+  word_t word = 0;
+
+  if (k < 0 || k >= n_words)
+    return 0;
+
+  if (row != NULL)
+    word ^= row[k];
+  if (other != NULL)
+    word ^= other[k];
+
+  return word;
+}
+
+/*
+ * Spreads a word of clicks by the band: every click toggles the cells of band
+ * around it. The bits are shifted in from the previous and the next words.
+ */
+static word_t
+spread_word (word_t band,
+             word_t prev,
+             word_t word,
+             word_t next)
+{
+  word_t result = 0;
+
+  if (band & 2)
+    result ^= word;
+  if (band & 1)
+    result ^= (word << 1) | (prev >> (WORD_BITS - 1));
+  if (band & 4)
+    result ^= (word >> 1) | (next << (WORD_BITS - 1));
+
+  return result;
+}
+
+/*
+ * Defines the system builder and the click kernel of a stencil without
+ * wrapping. The bands are constants, so the unused shifts are dropped by
+ * the compiler.
+ */
+#define DEFINE_BAND_STENCIL(name, MIDDLE, SIDES)                               \
+static void                                                                    \
+fill_system_##name (word_t **system,                                           \
+                    int      n_rows,                                           \
+                    int      n_cols)                                           \
+{                                                                              \
+  int    index, row, col;                                                      \
+  word_t edge;                                                                 \
+                                                                               \
+  for (row = 0; row < n_rows; row++)                                           \
+    {                                                                          \
+      for (col = 0; col < n_cols; col++)                                       \
+        {                                                                      \
+          index = n_cols * row + col;                                          \
+                                                                               \
+          edge = 7;                                                            \
+          if (col == 0)                                                        \
+            edge &= ~(word_t) 1;                                               \
+          if (col == n_cols - 1)                                               \
+            edge &= ~(word_t) 4;                                               \
+                                                                               \
+          or_band (system[index], index, (MIDDLE) & edge);                     \
+          if (row > 0)                                                         \
+            or_band (system[index], index - n_cols, (SIDES) & edge);           \
+          if (row < n_rows - 1)                                                \
+            or_band (system[index], index + n_cols, (SIDES) & edge);           \
+        }                                                                      \
+    }                                                                          \
+}                                                                              \
+                                                                               \
+static void                                                                    \
+click_row_##name (word_t       *clicks,                                        \
+                  const word_t *row,                                           \
+                  const word_t *above,                                         \
+                  const word_t *below,                                         \
+                  int           n_cols)                                        \
+{                                                                              \
+  int n_words = bool_array_n_words (n_cols);                                   \
+  int k;                                                                       \
+                                                                               \
+  for (k = 0; k < n_words; k++)                                                \
+    {                                                                          \
+      clicks[k] = spread_word (MIDDLE,                                         \
+                               k > 0 ? row[k - 1] : 0,                         \
+                               row[k],                                         \
+                               k < n_words - 1 ? row[k + 1] : 0) ^             \
+                  spread_word (SIDES,                                          \
+                               row_word (above, below, k - 1, n_words),        \
+                               row_word (above, below, k, n_words),            \
+                               row_word (above, below, k + 1, n_words));       \
+    }                                                                          \
+                                                                               \
+  if (BIT_INDEX (n_cols) != 0)                                                 \
+    clicks[n_words - 1] &= BIT_MASK (n_cols) - 1;                              \
+}
+
+DEFINE_BAND_STENCIL (plus, 7, 2)
+DEFINE_BAND_STENCIL (cross, 2, 5)
+DEFINE_BAND_STENCIL (king, 7, 7)
+
+/*
+ * Wraps the index of row or column around the field. A field of less than
+ * three rows or columns isn't wrapped, the neighbours would repeat.
+ */
+static int
+wrap_index (int index,
+            int size)
+{
+  if (index >= 0 && index < size)
+    return index;
+
+  if (size < 3)
+    return -1;
+
+  return (index + size) % size;
+}
+
+/*
+ * Fills the system of the torus: the plus and the bits of the cells wrapped
+ * around the edges.
+ */
+static void
+fill_system_torus (word_t **system,
+                   int      n_rows,
+                   int      n_cols)
+{
+  int index, row, col, other;
+
+  fill_system_plus (system, n_rows, n_cols);
+
+  for (row = 0; row < n_rows; row++)
+    {
+      index = n_cols * row;
+      other = wrap_index (-1, n_cols);
+      if (other >= 0)
+        {
+          bool_array_set (system[index], index + other, true);
+          bool_array_set (system[index + other], index, true);
+        }
+    }
+
+  for (col = 0; col < n_cols; col++)
+    {
+      other = wrap_index (-1, n_rows);
+      if (other >= 0)
+        {
+          bool_array_set (system[col], n_cols * other + col, true);
+          bool_array_set (system[n_cols * other + col], col, true);
+        }
+    }
+}
+
+/*
+ * Calculates the toggles of the row of the torus: the plus of the wrapped
+ * rows and the bits moved around the edges.
+ */
+static void
+click_row_torus (word_t  *clicks,
+                 word_t **solution,
+                 int      row,
+                 int      n_rows,
+                 int      n_cols)
+{
+  int above = wrap_index (row - 1, n_rows);
+  int below = wrap_index (row + 1, n_rows);
+
+  click_row_plus (clicks, solution[row],
+                  above >= 0 ? solution[above] : NULL,
+                  below >= 0 ? solution[below] : NULL,
+                  n_cols);
+
+  if (wrap_index (-1, n_cols) >= 0)
+    {
+      if (bool_array_get (solution[row], n_cols - 1))
+        clicks[0] ^= 1;
+      if (bool_array_get (solution[row], 0))
+        clicks[ARRAY_INDEX (n_cols - 1)] ^= BIT_MASK (n_cols - 1);
+    }
+}
+
+/*
+ * Finds a stencil by name.
+ */
+bool
+stencil_parse (const char *name,
+               Stencil    *stencil)
+{
+  int i;
+
+  for (i = 0; i < STENCIL_N_STENCILS; i++)
+    {
+      if (strcmp (name, stencil_info[i].name) == 0)
+        {
+          *stencil = i;
+          return true;
+        }
+    }
+
+  return false;
+}
+
+/*
+ * Gets the name of stencil.
+ */
+const char *
+stencil_name (Stencil stencil)
+{
+  return stencil_info[stencil].name;
+}
+
+/*
+ * Fills the system of logical equations by the kernel of stencil.
+ */
+void
+stencil_fill_system (Stencil   stencil,
+                     word_t  **system,
+                     int       n_rows,
+                     int       n_cols)
+{
+  switch (stencil)
+    {
+    case STENCIL_CROSS:
+      fill_system_cross (system, n_rows, n_cols);
+      break;
+    case STENCIL_KING:
+      fill_system_king (system, n_rows, n_cols);
+      break;
+    case STENCIL_TORUS:
+      fill_system_torus (system, n_rows, n_cols);
+      break;
+    default:
+      fill_system_plus (system, n_rows, n_cols);
+    }
+}
+
+/*
+ * Calculates the toggles of a row by the kernel of stencil.
+ */
+void
+stencil_click_row (Stencil   stencil,
+                   word_t   *clicks,
+                   word_t  **solution,
+                   int       row,
+                   int       n_rows,
+                   int       n_cols)
+{
+  const word_t *above = row > 0 ? solution[row - 1] : NULL;
+  const word_t *below = row < n_rows - 1 ? solution[row + 1] : NULL;
+
+  switch (stencil)
+    {
+    case STENCIL_CROSS:
+      click_row_cross (clicks, solution[row], above, below, n_cols);
+      break;
+    case STENCIL_KING:
+      click_row_king (clicks, solution[row], above, below, n_cols);
+      break;
+    case STENCIL_TORUS:
+      click_row_torus (clicks, solution, row, n_rows, n_cols);
+      break;
+    default:
+      click_row_plus (clicks, solution[row], above, below, n_cols);
+    }
+}
+
+/*
+ * Lists the cells of the bands of stencil one by one.
+ */
+int
+stencil_cells (Stencil  stencil,
+               int      row,
+               int      col,
+               int      n_rows,
+               int      n_cols,
+               int     *cells)
+{
+  const StencilInfo *info    = &stencil_info[stencil];
+  int                n_cells = 0;
+  int                i, j, r, c;
+  word_t             band;
+
+  for (i = -1; i <= 1; i++)
+    {
+      band = i == 0 ? info->middle : info->sides;
+      r = info->wrap ? wrap_index (row + i, n_rows) : row + i;
+      if (r < 0 || r >= n_rows)
+        continue;
+
+      for (j = -1; j <= 1; j++)
+        {
+          c = info->wrap ? wrap_index (col + j, n_cols) : col + j;
+          if ((band & ((word_t) 1 << (j + 1))) && c >= 0 && c < n_cols)
+            cells[n_cells++] = n_cols * r + c;
+        }
+    }
+
+  return n_cells;
+}
@@ -0,0 +1,137 @@
+/*
+ * stencil.h
+ *
+ * Copyright (C) 2017 - Pavel Nikitin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef STENCIL_H_
+#define STENCIL_H_
+
+#include "boolmatrix.h"
+
+#define STENCIL_MAX_CELLS 9
+
+/**
+ * SECTION: stencil
+ * @title: stencil
+ * @short_description: Neighbourhoods of a click.
+ *
+ * A stencil is the set of cells toggled by a click. Every stencil has its own
+ * system builder and click kernel generated at compile time, so the common
+ * plus stencil pays for the others only by one switch per row. The kernels
+ * shift whole words of the rows of clicks, like the kernel of plus did.
+ */
+
+/**
+ * Stencil:
+ * @STENCIL_PLUS:  The cell and its four neighbours by side
+ * @STENCIL_CROSS: The cell and its four neighbours by corner
+ * @STENCIL_KING:  The cell and all of its eight neighbours
+ * @STENCIL_TORUS: The plus, the edges of field are glued together
+ *
+ * The neighbourhoods of a click. A torus of less than three rows or columns
+ * doesn't wrap them, since the neighbours would repeat.
+ */
+typedef enum
+{
+  STENCIL_PLUS,
+  STENCIL_CROSS,
+  STENCIL_KING,
+  STENCIL_TORUS,
+  STENCIL_N_STENCILS
+} Stencil;
+
+/**
+ * stencil_parse:
+ * @name:    A name of stencil: plus, cross, king or torus
+ * @stencil: The stencil found
+ *
+ * Finds a stencil by name.
+ *
+ * Returns: A success flag
+ */
+bool
+stencil_parse (const char *name,
+               Stencil    *stencil);
+
+/**
+ * stencil_name:
+ * @stencil: A stencil
+ *
+ * Returns: The name of stencil
+ */
+const char *
+stencil_name (Stencil stencil);
+
+/**
+ * stencil_fill_system:
+ * @stencil: A stencil
+ * @system:  The zeroed matrix of at least @n_rows * @n_cols square
+ * @n_rows:  Number of rows in the field
+ * @n_cols:  Number of columns in the field
+ *
+ * Fills the coefficients of the system of logical equations for the field.
+ * The equation of a cell has ones in the columns of the cells toggling it.
+ */
+void
+stencil_fill_system (Stencil   stencil,
+                     word_t  **system,
+                     int       n_rows,
+                     int       n_cols);
+
+/**
+ * stencil_click_row:
+ * @stencil:  A stencil
+ * @clicks:   The boolean array for the toggles of row
+ * @solution: The matrix of clicks
+ * @row:      Index of row
+ * @n_rows:   Number of rows in the field
+ * @n_cols:   Number of columns in the field
+ *
+ * Calculates which cells of the row are toggled by the clicks. The unused
+ * bits of the last word are zero.
+ */
+void
+stencil_click_row (Stencil   stencil,
+                   word_t   *clicks,
+                   word_t  **solution,
+                   int       row,
+                   int       n_rows,
+                   int       n_cols);
+
+/**
+ * stencil_cells:
+ * @stencil: A stencil
+ * @row:     Row of the clicked cell
+ * @col:     Column of the clicked cell
+ * @n_rows:  Number of rows in the field
+ * @n_cols:  Number of columns in the field
+ * @cells:   The array of %STENCIL_MAX_CELLS indices
+ *
+ * Lists the distinct cells toggled by a click as indices n_cols * row + col.
+ * It is the slow reference of the kernels, used by the engine of more states.
+ *
+ * Returns: Number of cells
+ */
+int
+stencil_cells (Stencil  stencil,
+               int      row,
+               int      col,
+               int      n_rows,
+               int      n_cols,
+               int     *cells);
+
+#endif
@@ -0,0 +1,581 @@
+/*
+ * bench.c
+ *
+ * Benchmarks the solver over a sweep of board sizes and the input corpus.
+ * Every case is solved by every engine, the factorized engine also by
+ * growing numbers of threads. The runs are repeated after warmup and their
+ * median and 95th percentile times are written as JSON, one run per line,
+ * so a saved report serves as the baseline to compare with.
+ *
+ * Copyright (C) 2017 - Pavel Nikitin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "lightsoffsolver.h"
+#include "profile.h"
+
+#define BENCH_MAX_CASES   64
+#define BENCH_MAX_RUNS    1024
+#define BENCH_NAME_SIZE   64
+#define BENCH_N_PHASES    3
+
+static const char *default_sizes = "5x5,8x8,20x20,50x50,80x80,16x40,30x70";
+
+/* The phases of solving, the parse and output are not benchmarked */
+static const ProfilePhase bench_phases[BENCH_N_PHASES] = {
+  PROFILE_CREATE_SYSTEM, PROFILE_GAUSS, PROFILE_SEARCH
+};
+
+typedef enum
+{
+  ENGINE_SOLVE,
+  ENGINE_FACTOR,
+  N_ENGINES
+} Engine;
+
+static const char *engine_names[N_ENGINES] = { "solve", "factor" };
+
+typedef struct
+{
+  char     name[BENCH_NAME_SIZE];
+  int      n_rows;
+  int      n_cols;
+  word_t **field;
+} BenchCase;
+
+typedef struct
+{
+  char     name[BENCH_NAME_SIZE];
+  char     engine[16];
+  int      n_threads;
+  uint64_t median;
+  uint64_t p95;
+} BenchRun;
+
+typedef struct
+{
+  const LightsoffFactor *factor;
+  const BenchCase       *bench_case;
+} BenchWorker;
+
+static uint64_t random_state = 0x2545F4914F6CDD1DULL;
+
+/*
+ * Gets the next number of xorshift generator, so the random fields are the
+ * same from run to run.
+ */
+static uint64_t
+random_next (void)
+{
+  random_state ^= random_state << 13;
+  random_state ^= random_state >> 7;
+  random_state ^= random_state << 17;
+
+  return random_state;
+}
+
+/*
+ * Reads a monotonic clock in nanoseconds.
+ */
+static uint64_t
+bench_clock (void)
+{
+  struct timespec time;
+
+  clock_gettime (CLOCK_MONOTONIC, &time);
+
+  return (uint64_t) time.tv_sec * 1000000000 + time.tv_nsec;
+}
+
+static int
+compare_uint64 (const void *a,
+                const void *b)
+{
+  uint64_t x = *(const uint64_t *) a;
+  uint64_t y = *(const uint64_t *) b;
+
+  return (x > y) - (x < y);
+}
+
+/*
+ * Sorts the samples and gets the percentile of them by the nearest rank.
+ */
+static uint64_t
+percentile (uint64_t *samples,
+            int       n_samples,
+            int       percent)
+{
+  int rank = (n_samples * percent + 99) / 100;
+
+  qsort (samples, n_samples, sizeof *samples, compare_uint64);
+
+  return samples[rank > 0 ? rank - 1 : 0];
+}
+
+/*
+ * Creates a field of all ones or a random solvable field, which is the
+ * field of random clicks on the empty board.
+ */
+static bool
+add_sized_case (BenchCase *cases,
+                int       *n_cases,
+                int        n_rows,
+                int        n_cols,
+                bool       random)
+{
+  BenchCase *bench_case = &cases[*n_cases];
+  word_t   **clicks;
+  int        row, col;
+
+  if (*n_cases >= BENCH_MAX_CASES)
+    return false;
+
+  bench_case->n_rows = n_rows;
+  bench_case->n_cols = n_cols;
+  bench_case->field = bool_matrix_new (n_rows, n_cols);
+  if (bench_case->field == NULL)
+    return false;
+
+  snprintf (bench_case->name, BENCH_NAME_SIZE, "%s-%dx%d",
+            random ? "random" : "ones", n_rows, n_cols);
+
+  if (random)
+    {
+      clicks = bool_matrix_new (n_rows, n_cols);
+      if (clicks == NULL)
+        {
+          bool_matrix_free (bench_case->field, n_rows);
+          return false;
+        }
+
+      for (row = 0; row < n_rows; row++)
+        {
+          for (col = 0; col < n_cols; col++)
+            {
+              if (random_next () & 1)
+                bool_array_set (clicks[row], col, true);
+            }
+        }
+
+      lightsoff_apply (bench_case->field, clicks, n_rows, n_cols,
+                       STENCIL_PLUS);
+      bool_matrix_free (clicks, n_rows);
+    }
+  else
+    {
+      for (row = 0; row < n_rows; row++)
+        bool_array_set_bits (bench_case->field[row], 0, n_cols);
+    }
+
+  (*n_cases)++;
+
+  return true;
+}
+
+/*
+ * Adds a field of the corpus file.
+ */
+static bool
+add_file_case (BenchCase  *cases,
+               int        *n_cases,
+               const char *filename)
+{
+  BenchCase  *bench_case = &cases[*n_cases];
+  const char *basename   = strrchr (filename, '/');
+  FILE       *stream;
+
+  if (*n_cases >= BENCH_MAX_CASES)
+    return false;
+
+  stream = fopen (filename, "r");
+  if (stream == NULL)
+    {
+      perror (filename);
+      return false;
+    }
+
+  bench_case->field = bool_matrix_read (stream, &bench_case->n_rows,
+                                        &bench_case->n_cols);
+  fclose (stream);
+  if (bench_case->field == NULL)
+    {
+      fprintf (stderr, "Can't read the field: %s\n", filename);
+      return false;
+    }
+
+  snprintf (bench_case->name, BENCH_NAME_SIZE, "%s",
+            basename != NULL ? basename + 1 : filename);
+  (*n_cases)++;
+
+  return true;
+}
+
+/*
+ * Solves the field of case with the shared factor.
+ */
+static void *
+bench_worker (void *data)
+{
+  BenchWorker *worker = data;
+  word_t     **solution;
+  int          n_solutions, weight;
+
+  solution = lightsoff_factor_solve (worker->factor, worker->bench_case->field,
+                                     &n_solutions, &weight);
+  bool_matrix_free (solution, worker->bench_case->n_rows);
+
+  return NULL;
+}
+
+/*
+ * Solves the case once by the engine. The factorized engine solves the case
+ * by every thread at once. The unsolvable fields are timed the same way.
+ */
+static void
+bench_once (const BenchCase       *bench_case,
+            Engine                 engine,
+            const LightsoffFactor *factor,
+            int                    n_threads)
+{
+  BenchWorker workers[n_threads];
+  pthread_t   threads[n_threads];
+  word_t    **solution;
+  int         n_solutions, weight, i;
+
+  if (engine == ENGINE_SOLVE)
+    {
+      solution = lightsoff_solve (bench_case->field, bench_case->n_rows,
+                                  bench_case->n_cols, STENCIL_PLUS,
+                                  &n_solutions, &weight, NULL);
+      bool_matrix_free (solution, bench_case->n_rows);
+      return;
+    }
+
+  for (i = 0; i < n_threads; i++)
+    {
+      workers[i].factor = factor;
+      workers[i].bench_case = bench_case;
+      pthread_create (&threads[i], NULL, bench_worker, &workers[i]);
+    }
+
+  for (i = 0; i < n_threads; i++)
+    pthread_join (threads[i], NULL);
+}
+
+/*
+ * Repeats the case after warmup and writes the times of run as a JSON line.
+ * The phase times are summed over the threads.
+ */
+static void
+bench_run (FILE                  *stream,
+           const BenchCase       *bench_case,
+           Engine                 engine,
+           const LightsoffFactor *factor,
+           int                    n_threads,
+           int                    n_warmup,
+           int                    n_reps,
+           BenchRun              *run)
+{
+  uint64_t samples[n_reps];
+  uint64_t phases[BENCH_N_PHASES][n_reps];
+  uint64_t start;
+  int      i, j;
+
+  for (i = 0; i < n_warmup; i++)
+    bench_once (bench_case, engine, factor, n_threads);
+
+  for (i = 0; i < n_reps; i++)
+    {
+      profile_reset ();
+      start = bench_clock ();
+      bench_once (bench_case, engine, factor, n_threads);
+      samples[i] = bench_clock () - start;
+
+      for (j = 0; j < BENCH_N_PHASES; j++)
+        phases[j][i] = profile_phase_wall (bench_phases[j]);
+    }
+
+  memcpy (run->name, bench_case->name, BENCH_NAME_SIZE);
+  snprintf (run->engine, sizeof run->engine, "%s", engine_names[engine]);
+  run->n_threads = n_threads;
+  run->median = percentile (samples, n_reps, 50);
+  run->p95 = percentile (samples, n_reps, 95);
+
+  fprintf (stream, "{\"case\": \"%s\", \"engine\": \"%s\", \"threads\": %d, "
+           "\"rows\": %d, \"cols\": %d, \"reps\": %d, "
+           "\"median_ns\": %" PRIu64 ", \"p95_ns\": %" PRIu64 ", \"phases\": {",
+           run->name, run->engine, n_threads, bench_case->n_rows,
+           bench_case->n_cols, n_reps, run->median, run->p95);
+  for (j = 0; j < BENCH_N_PHASES; j++)
+    {
+      fprintf (stream, "%s\"%s\": {\"median_ns\": %" PRIu64 ", "
+               "\"p95_ns\": %" PRIu64 "}", j > 0 ? ", " : "",
+               profile_phase_name (bench_phases[j]),
+               percentile (phases[j], n_reps, 50),
+               percentile (phases[j], n_reps, 95));
+    }
+  fprintf (stream, "}}");
+}
+
+/*
+ * Reads the runs of saved report.
+ */
+static int
+read_baseline (const char *filename,
+               BenchRun   *runs)
+{
+  FILE    *stream;
+  char     line[1024];
+  int      n_runs = 0;
+  BenchRun run;
+
+  stream = fopen (filename, "r");
+  if (stream == NULL)
+    {
+      perror (filename);
+      return -1;
+    }
+
+  while (n_runs < BENCH_MAX_RUNS && fgets (line, sizeof line, stream) != NULL)
+    {
+      if (sscanf (line, " {\"case\": \"%63[^\"]\", \"engine\": \"%15[^\"]\", "
+                  "\"threads\": %d, \"rows\": %*d, \"cols\": %*d, "
+                  "\"reps\": %*d, \"median_ns\": %" SCNu64 ", "
+                  "\"p95_ns\": %" SCNu64,
+                  run.name, run.engine, &run.n_threads,
+                  &run.median, &run.p95) == 5)
+        runs[n_runs++] = run;
+    }
+
+  fclose (stream);
+
+  return n_runs;
+}
+
+/*
+ * Flags the runs slower than the same runs of baseline by more than the
+ * threshold. Returns number of regressions.
+ */
+static int
+compare_runs (const BenchRun *runs,
+              int             n_runs,
+              const BenchRun *baseline,
+              int             n_baseline,
+              int             threshold)
+{
+  int n_regressions = 0;
+  int i, j;
+
+  for (i = 0; i < n_runs; i++)
+    {
+      for (j = 0; j < n_baseline; j++)
+        {
+          if (strcmp (runs[i].name, baseline[j].name) == 0 &&
+              strcmp (runs[i].engine, baseline[j].engine) == 0 &&
+              runs[i].n_threads == baseline[j].n_threads)
+            break;
+        }
+
+      if (j == n_baseline || baseline[j].median == 0)
+        continue;
+
+      if (runs[i].median * 100 > baseline[j].median * (100 + threshold))
+        {
+          fprintf (stderr, "Regression %s %s %d: %" PRIu64 " ns -> %"
+                   PRIu64 " ns (+%" PRIu64 "%%)\n", runs[i].name,
+                   runs[i].engine, runs[i].n_threads, baseline[j].median,
+                   runs[i].median,
+                   (runs[i].median - baseline[j].median) * 100 /
+                   baseline[j].median);
+          n_regressions++;
+        }
+    }
+
+  return n_regressions;
+}
+
+static void
+print_help (void)
+{
+  printf ("Usage: lightsoffbench [switches] [corpus files]\n\n"
+          "  -s<sizes>      Sizes of boards as 20x20,16x40 (%s)\n"
+          "  -r<n>          Number of repetitions (5)\n"
+          "  -w<n>          Number of warmup runs (1)\n"
+          "  -m<n>          Maximum number of threads (number of CPUs)\n"
+          "  -o<file>       Writes the report to the file\n"
+          "  -b<file>       Compares with the baseline report\n"
+          "  -x<percent>    Threshold of regression (10)\n"
+          "  -h             Prints this help\n", default_sizes);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  BenchCase        cases[BENCH_MAX_CASES];
+  BenchRun         runs[BENCH_MAX_RUNS];
+  BenchRun        *baseline;
+  LightsoffFactor *factor;
+  FILE            *stream        = stdout;
+  const char      *sizes         = default_sizes;
+  const char      *output_name   = NULL;
+  const char      *baseline_name = NULL;
+  const char      *size;
+  int              n_reps        = 5;
+  int              n_warmup      = 1;
+  int              max_threads   = sysconf (_SC_NPROCESSORS_ONLN);
+  int              threshold     = 10;
+  int              n_cases       = 0;
+  int              n_runs        = 0;
+  int              n_baseline    = 0;
+  int              n_regressions = 0;
+  int              n_rows, n_cols, n_threads, i;
+  Engine           engine;
+
+  for (i = 1; i < argc; i++)
+    {
+      if (argv[i][0] != '-')
+        {
+          if (!add_file_case (cases, &n_cases, argv[i]))
+            return EXIT_FAILURE;
+          continue;
+        }
+
+      switch (argv[i][1])
+        {
+        case 's':
+          sizes = &argv[i][2];
+          break;
+        case 'r':
+          n_reps = atoi (&argv[i][2]);
+          break;
+        case 'w':
+          n_warmup = atoi (&argv[i][2]);
+          break;
+        case 'm':
+          max_threads = atoi (&argv[i][2]);
+          break;
+        case 'o':
+          output_name = &argv[i][2];
+          break;
+        case 'b':
+          baseline_name = &argv[i][2];
+          break;
+        case 'x':
+          threshold = atoi (&argv[i][2]);
+          break;
+        default:
+          print_help ();
+          return EXIT_SUCCESS;
+        }
+    }
+
+  if (n_reps < 1)
+    n_reps = 1;
+  if (max_threads < 1)
+    max_threads = 1;
+
+  for (size = sizes; *size != '\0'; size++)
+    {
+      if (sscanf (size, "%dx%d", &n_rows, &n_cols) != 2 ||
+          n_rows < 1 || n_cols < 1)
+        {
+          fprintf (stderr, "Wrong sizes of boards: %s\n", sizes);
+          return EXIT_FAILURE;
+        }
+
+      if (!add_sized_case (cases, &n_cases, n_rows, n_cols, false) ||
+          !add_sized_case (cases, &n_cases, n_rows, n_cols, true))
+        return EXIT_FAILURE;
+
+      size = strchr (size, ',');
+      if (size == NULL)
+        break;
+    }
+
+  if (output_name != NULL)
+    {
+      stream = fopen (output_name, "w");
+      if (stream == NULL)
+        {
+          perror (output_name);
+          return EXIT_FAILURE;
+        }
+    }
+
+  /* Only the spans are needed, the counters stay off */
+  profile_enable ();
+
+  fprintf (stream, "{\"runs\": [\n");
+  for (i = 0; i < n_cases; i++)
+    {
+      factor = lightsoff_factor_new (cases[i].n_rows, cases[i].n_cols,
+                                     STENCIL_PLUS, NULL);
+      if (factor == NULL)
+        {
+          fprintf (stderr, "Can't factorize %s\n", cases[i].name);
+          return EXIT_FAILURE;
+        }
+
+      for (engine = 0; engine < N_ENGINES; engine++)
+        {
+          for (n_threads = 1;
+               n_threads <= (engine == ENGINE_FACTOR ? max_threads : 1) &&
+               n_runs < BENCH_MAX_RUNS;
+               n_threads *= 2)
+            {
+              fprintf (stream, "%s  ", n_runs > 0 ? ",\n" : "");
+              bench_run (stream, &cases[i], engine, factor, n_threads,
+                         n_warmup, n_reps, &runs[n_runs]);
+              fflush (stream);
+              n_runs++;
+            }
+        }
+
+      lightsoff_factor_free (factor);
+      bool_matrix_free (cases[i].field, cases[i].n_rows);
+    }
+  fprintf (stream, "\n]}\n");
+
+  if (stream != stdout)
+    fclose (stream);
+
+  if (baseline_name != NULL)
+    {
+      baseline = malloc (BENCH_MAX_RUNS * sizeof *baseline);
+      if (baseline != NULL)
+        n_baseline = read_baseline (baseline_name, baseline);
+      if (baseline == NULL || n_baseline < 0)
+        {
+          free (baseline);
+          return EXIT_FAILURE;
+        }
+
+      n_regressions = compare_runs (runs, n_runs, baseline, n_baseline,
+                                    threshold);
+      fprintf (stderr, "%d of %d runs regressed by more than %d%%\n",
+               n_regressions, n_runs, threshold);
+      free (baseline);
+    }
+
+  return n_regressions > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,142 @@
+/*
+ * gensmall.c
+ *
+ * Generates the tables of small board solvers. Every board of up to
+ * SMALL_BOARD_MAX_SIZE x SMALL_BOARD_MAX_SIZE cells fits in a 64-bit word,
+ * so its system is gaussed here by words, the same way as bool_gauss() does.
+ *
+ * Copyright (C) 2017 - Pavel Nikitin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include "smallboard.h"
+
+/*
+ * Gausses the system of board and prints its transform and kernel words.
+ * Returns the rank of system.
+ */
+static int
+print_board (int n_rows,
+             int n_cols)
+{
+  int      n    = n_rows * n_cols;
+  int      rank = 0;
+  uint64_t system[64], transform[64], kernel, swap;
+  int      row, col, i, j;
+
+  /* The cell with its non-diagonal neighbors and the identity transform */
+  for (row = 0; row < n_rows; row++)
+    {
+      for (col = 0; col < n_cols; col++)
+        {
+          i = n_cols * row + col;
+          system[i] = 1ULL << i;
+          if (col > 0)
+            system[i] |= 1ULL << (i - 1);
+          if (col < n_cols - 1)
+            system[i] |= 1ULL << (i + 1);
+          if (row > 0)
+            system[i] |= 1ULL << (i - n_cols);
+          if (row < n_rows - 1)
+            system[i] |= 1ULL << (i + n_cols);
+          transform[i] = 1ULL << i;
+        }
+    }
+
+  for (i = 0; i < n; i++)
+    {
+      for (j = i; j < n; j++)
+        {
+          if ((system[j] >> i) & 1)
+            {
+              swap = system[j];
+              system[j] = system[i];
+              system[i] = swap;
+              swap = transform[j];
+              transform[j] = transform[i];
+              transform[i] = swap;
+              break;
+            }
+        }
+
+      if (!((system[i] >> i) & 1))
+        continue;
+
+      rank = i + 1;
+
+      for (j = 0; j < n; j++)
+        {
+          if (((system[j] >> i) & 1) && j != i)
+            {
+              system[j] ^= system[i];
+              transform[j] ^= transform[i];
+            }
+        }
+    }
+
+  printf ("  /* %i x %i */\n", n_rows, n_cols);
+  for (i = 0; i < n; i++)
+    printf ("  0x%016llXULL,\n", (unsigned long long) transform[i]);
+
+  /* Every free variable gives a vector of the kernel */
+  for (i = rank; i < n; i++)
+    {
+      kernel = 1ULL << i;
+      for (j = 0; j < rank; j++)
+        kernel |= ((system[j] >> i) & 1ULL) << j;
+      printf ("  0x%016llXULL,\n", (unsigned long long) kernel);
+    }
+
+  return rank;
+}
+
+/*
+ * The main program.
+ */
+int
+main (void)
+{
+  int ranks[SMALL_BOARD_MAX_SIZE][SMALL_BOARD_MAX_SIZE];
+  int offset = 0;
+  int n_rows, n_cols, n;
+
+  printf ("/* Generated by tools/gensmall.c, do not edit. */\n\n");
+  printf ("static const uint64_t small_board_words[] =\n{\n");
+  for (n_rows = 1; n_rows <= SMALL_BOARD_MAX_SIZE; n_rows++)
+    {
+      for (n_cols = 1; n_cols <= SMALL_BOARD_MAX_SIZE; n_cols++)
+        ranks[n_rows - 1][n_cols - 1] = print_board (n_rows, n_cols);
+    }
+  printf ("};\n\n");
+
+  printf ("static const SmallBoard small_boards[%i][%i] =\n{\n",
+          SMALL_BOARD_MAX_SIZE, SMALL_BOARD_MAX_SIZE);
+  for (n_rows = 1; n_rows <= SMALL_BOARD_MAX_SIZE; n_rows++)
+    {
+      printf ("  {\n");
+      for (n_cols = 1; n_cols <= SMALL_BOARD_MAX_SIZE; n_cols++)
+        {
+          n = n_rows * n_cols;
+          printf ("    { %i, %i },\n", ranks[n_rows - 1][n_cols - 1], offset);
+          offset += 2 * n - ranks[n_rows - 1][n_cols - 1];
+        }
+      printf ("  },\n");
+    }
+  printf ("};\n");
+
+  return 0;
+}
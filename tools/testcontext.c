@@ -0,0 +1,250 @@
+/*
+ * testcontext.c
+ *
+ * Tests the solver contexts on threads. Every thread solves random solvable
+ * fields of mixed sizes and stencils by its own context and verifies every
+ * solution, the second solve of a size must factorize the system and the
+ * following ones must reuse the factor. A cancel before a solve and a cancel
+ * from another thread must stop the solves of a context until its reset.
+ *
+ * Copyright (C) 2017 - Pavel Nikitin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "lightsoffcontext.h"
+#include "smallboard.h"
+
+/* Number of threads solving at once */
+#define TEST_N_THREADS 8
+
+/* Number of fields of a size solved in a row */
+#define TEST_N_REPEATS 3
+
+typedef struct
+{
+  int     n_rows;
+  int     n_cols;
+  Stencil stencil;
+} TestCase;
+
+/* The small boards of the plus stencil are solved by tables */
+static const TestCase test_cases[] = {
+  { 5,  5,  STENCIL_PLUS  },
+  { 16, 16, STENCIL_PLUS  },
+  { 11, 2,  STENCIL_PLUS  },
+  { 9,  9,  STENCIL_CROSS },
+  { 13, 7,  STENCIL_KING  },
+  { 10, 10, STENCIL_TORUS },
+  { 24, 20, STENCIL_PLUS  }
+};
+
+#define TEST_N_CASES ((int) (sizeof test_cases / sizeof *test_cases))
+
+/* The size of the field solved until it is cancelled by another thread */
+#define TEST_CANCEL_SIZE 60
+
+typedef struct
+{
+  int               index;
+  int               n_failed;
+  LightsoffContext *context;
+} TestThread;
+
+/*
+ * Gets the next number of splitmix generator.
+ */
+static uint64_t
+random_next (uint64_t *state)
+{
+  uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+
+  return z ^ (z >> 31);
+}
+
+/*
+ * Solves random solvable fields of every case by the context of thread.
+ */
+static void *
+solve_cases (void *data)
+{
+  TestThread     *thread = data;
+  uint64_t        state  = thread->index;
+  const TestCase *test;
+  LightsoffStats  stats;
+  word_t        **field, **clicks, **solution;
+  int             n_solutions, weight, c, r, i, j;
+  bool            factored;
+
+  for (c = 0; c < TEST_N_CASES; c++)
+    {
+      /* Every thread starts by its own case */
+      test = &test_cases[(c + thread->index) % TEST_N_CASES];
+      lightsoff_context_set_stencil (thread->context, test->stencil);
+      field = bool_matrix_new (test->n_rows, test->n_cols);
+      clicks = bool_matrix_new (test->n_rows, test->n_cols);
+
+      for (r = 0; r < TEST_N_REPEATS && field != NULL && clicks != NULL; r++)
+        {
+          for (i = 0; i < test->n_rows; i++)
+            {
+              bool_array_clear (field[i], bool_array_n_words (test->n_cols));
+              for (j = 0; j < test->n_cols; j++)
+                bool_array_set (clicks[i], j, random_next (&state) & 1);
+            }
+          lightsoff_apply (field, clicks, test->n_rows, test->n_cols,
+                           test->stencil);
+
+          solution = lightsoff_context_solve (thread->context, field,
+                                              test->n_rows, test->n_cols,
+                                              &n_solutions, &weight);
+          if (solution == NULL ||
+              lightsoff_verify (field, solution, test->n_rows, test->n_cols,
+                                test->stencil) != 1)
+            {
+              fprintf (stderr, "Thread %i, %ix%i, stencil %i, field %i: "
+                       "the solution is wrong\n", thread->index,
+                       test->n_rows, test->n_cols, test->stencil, r);
+              thread->n_failed++;
+            }
+
+          /* The tables need no factor, the others factorize once */
+          lightsoff_context_get_stats (thread->context, &stats);
+          factored = r == 1 &&
+                     !(test->stencil == STENCIL_PLUS &&
+                       small_board_fits (test->n_rows, test->n_cols));
+          if (stats.factored != factored)
+            {
+              fprintf (stderr, "Thread %i, %ix%i, stencil %i, field %i: "
+                       "the factor is %s\n", thread->index, test->n_rows,
+                       test->n_cols, test->stencil, r,
+                       stats.factored ? "made again" : "not made");
+              thread->n_failed++;
+            }
+        }
+
+      bool_matrix_free (field, test->n_rows);
+      bool_matrix_free (clicks, test->n_rows);
+    }
+
+  return NULL;
+}
+
+/*
+ * Solves a dark field by the context until it is cancelled.
+ */
+static void *
+solve_until_cancel (void *data)
+{
+  TestThread *thread = data;
+  word_t    **field  = bool_matrix_new (TEST_CANCEL_SIZE, TEST_CANCEL_SIZE);
+  int         n_solutions, weight;
+
+  while (field != NULL &&
+         lightsoff_context_solve (thread->context, field, TEST_CANCEL_SIZE,
+                                  TEST_CANCEL_SIZE, &n_solutions,
+                                  &weight) != NULL)
+    ;
+
+  if (field == NULL || !lightsoff_context_cancelled (thread->context))
+    {
+      fprintf (stderr, "The solve stopped without cancel\n");
+      thread->n_failed++;
+    }
+
+  bool_matrix_free (field, TEST_CANCEL_SIZE);
+
+  return NULL;
+}
+
+/*
+ * Checks that a cancel before a solve is kept until the reset.
+ */
+static int
+check_cancel (LightsoffContext *context)
+{
+  word_t **field = bool_matrix_new (16, 16);
+  int      n_failed = 0, n_solutions, weight;
+
+  lightsoff_context_set_stencil (context, STENCIL_PLUS);
+  lightsoff_context_cancel (context);
+  if (lightsoff_context_solve (context, field, 16, 16, &n_solutions,
+                               &weight) != NULL ||
+      !lightsoff_context_cancelled (context))
+    {
+      fprintf (stderr, "A cancel before the solve is lost\n");
+      n_failed++;
+    }
+
+  lightsoff_context_reset (context);
+  if (lightsoff_context_solve (context, field, 16, 16, &n_solutions,
+                               &weight) == NULL ||
+      lightsoff_context_cancelled (context))
+    {
+      fprintf (stderr, "The solve after the reset is cancelled\n");
+      n_failed++;
+    }
+
+  bool_matrix_free (field, 16);
+
+  return n_failed;
+}
+
+int
+main (void)
+{
+  TestThread      threads[TEST_N_THREADS];
+  pthread_t       ids[TEST_N_THREADS];
+  struct timespec delay = { 0, 10000000 };
+  int             n_failed = 0, i;
+
+  for (i = 0; i < TEST_N_THREADS; i++)
+    {
+      threads[i].index = i;
+      threads[i].n_failed = 0;
+      threads[i].context = lightsoff_context_new (NULL, NULL);
+      if (threads[i].context == NULL)
+        return EXIT_FAILURE;
+    }
+
+  /* The contexts solve at once */
+  for (i = 0; i < TEST_N_THREADS; i++)
+    pthread_create (&ids[i], NULL, solve_cases, &threads[i]);
+  for (i = 0; i < TEST_N_THREADS; i++)
+    pthread_join (ids[i], NULL);
+
+  /* A cancel from the main thread stops the solve of another one */
+  pthread_create (&ids[0], NULL, solve_until_cancel, &threads[0]);
+  nanosleep (&delay, NULL);
+  lightsoff_context_cancel (threads[0].context);
+  pthread_join (ids[0], NULL);
+  n_failed += check_cancel (threads[0].context);
+
+  for (i = 0; i < TEST_N_THREADS; i++)
+    {
+      n_failed += threads[i].n_failed;
+      lightsoff_context_free (threads[i].context);
+    }
+
+  printf ("Solver contexts: %s\n", n_failed == 0 ? "passed" : "failed");
+
+  return n_failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,220 @@
+/*
+ * testgauss.c
+ *
+ * Tests the contract of bool_gauss_recursive() on a rank-deficient dense
+ * system: the rank is the rank of system, the first rank columns are pivots
+ * reduced to the identity, the rows after the rank are zero, and the reduced
+ * system has the same solutions as the original one. The pivot rows and the
+ * order of the free columns are not pinned, they may differ from the tiled
+ * elimination of bool_gauss().
+ *
+ * Copyright (C) 2017 - Pavel Nikitin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "boolgauss.h"
+
+/* Number of variables, enough for the recursive elimination */
+#define TEST_N_VARS      1100
+
+/* Number of equations, which are sums of other equations */
+#define TEST_N_DEPENDENT 37
+
+static uint64_t random_state = 0x2545F4914F6CDD1DULL;
+
+/*
+ * Gets the next number of splitmix generator. Unlike xorshift it is not
+ * linear over GF(2), so the random rows are independent.
+ */
+static uint64_t
+random_next (void)
+{
+  uint64_t z = (random_state += 0x9E3779B97F4A7C15ULL);
+
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+
+  return z ^ (z >> 31);
+}
+
+/*
+ * Multiplies the left square part of system by the vector of variables.
+ */
+static word_t *
+multiply (word_t **system,
+          word_t  *vars,
+          int      n_vars)
+{
+  word_t *product = bool_array_new (n_vars);
+  int     n_words = bool_array_n_words (n_vars);
+  int     i, k;
+  word_t  sum;
+
+  for (i = 0; i < n_vars; i++)
+    {
+      sum = 0;
+      for (k = 0; k < n_words; k++)
+        sum ^= system[i][k] & vars[k];
+      bool_array_set (product, i, __builtin_parityl (sum));
+    }
+
+  return product;
+}
+
+/*
+ * Checks that the solution of the reduced system by its @column, with the
+ * free variable of @column if @is_free, unpacked by @order, is mapped by the
+ * original system to @expected.
+ */
+static bool
+check_solution (word_t **original,
+                word_t **reduced,
+                int     *order,
+                int      rank,
+                int      column,
+                bool     is_free,
+                word_t  *expected)
+{
+  int     n_vars  = TEST_N_VARS;
+  int     n_words = bool_array_n_words (n_vars);
+  word_t *vars    = bool_array_new (n_vars);
+  word_t *product;
+  bool    success;
+  int     j;
+
+  for (j = 0; j < rank; j++)
+    bool_array_set (vars, order[j], bool_array_get (reduced[j], column));
+  if (is_free)
+    bool_array_set (vars, order[column], true);
+
+  product = multiply (original, vars, n_vars);
+  success = memcmp (product, expected, n_words * sizeof *product) == 0;
+
+  free (product);
+  free (vars);
+
+  return success;
+}
+
+int
+main (void)
+{
+  int      n_vars  = TEST_N_VARS;
+  int      n_cols  = n_vars + 1;
+  int      n_words = bool_array_n_words (n_cols);
+  word_t **original, **system;
+  word_t  *vars, *rhs, *zero;
+  int     *order;
+  bool    *seen;
+  int      rank, n_failed = 0, i, j, k;
+
+  original = bool_matrix_new (n_vars, n_cols);
+  system = bool_matrix_new (n_vars, n_cols);
+  order = malloc (n_vars * sizeof *order);
+  seen = calloc (n_vars, sizeof *seen);
+  vars = bool_array_new (n_vars);
+  zero = bool_array_new (n_vars);
+
+  /* A dense system with dependent rows, consistent by a random solution */
+  for (i = 0; i < n_vars; i++)
+    {
+      for (k = 0; k < n_words; k++)
+        original[i][k] = random_next ();
+      bool_array_clear_bits (original[i], n_vars, n_words * WORD_BITS);
+    }
+  for (i = 0; i < TEST_N_DEPENDENT; i++)
+    {
+      j = (i * 29 + 3) % n_vars;
+      for (k = 0; k < n_words; k++)
+        original[j][k] = original[(j + 1) % n_vars][k] ^
+                         original[(j + 7) % n_vars][k];
+    }
+  for (k = 0; k < bool_array_n_words (n_vars); k++)
+    vars[k] = random_next ();
+  bool_array_clear_bits (vars, n_vars, bool_array_n_words (n_vars) * WORD_BITS);
+  rhs = multiply (original, vars, n_vars);
+  for (i = 0; i < n_vars; i++)
+    bool_array_set (original[i], n_vars, bool_array_get (rhs, i));
+
+  for (i = 0; i < n_vars; i++)
+    memcpy (system[i], original[i], n_words * sizeof *system[i]);
+
+  /* The kernel vectors checked below are independent, so it is the rank */
+  rank = bool_gauss_recursive (system, n_vars, n_cols, order, NULL);
+  if (rank != n_vars - TEST_N_DEPENDENT)
+    {
+      fprintf (stderr, "Rank %d, expected %d\n",
+               rank, n_vars - TEST_N_DEPENDENT);
+      n_failed++;
+    }
+
+  for (j = 0; j < n_vars; j++)
+    {
+      if (order[j] < 0 || order[j] >= n_vars || seen[order[j]])
+        {
+          fprintf (stderr, "Order is not a permutation at %d\n", j);
+          n_failed++;
+          break;
+        }
+      seen[order[j]] = true;
+    }
+
+  /* The pivots form the identity, the rows after the rank are zero */
+  for (i = 0; i < n_vars && n_failed == 0; i++)
+    {
+      for (j = 0; j < (i < rank ? rank : n_cols); j++)
+        {
+          if (bool_array_get (system[i], j) != (i == j && i < rank))
+            {
+              fprintf (stderr, "Row %d is not reduced at column %d\n", i, j);
+              n_failed++;
+              break;
+            }
+        }
+    }
+
+  /* The particular solution and every vector of the kernel */
+  if (n_failed == 0 &&
+      !check_solution (original, system, order, rank, n_vars, false, rhs))
+    {
+      fprintf (stderr, "The particular solution is wrong\n");
+      n_failed++;
+    }
+  for (j = rank; j < n_vars && n_failed == 0; j++)
+    {
+      if (!check_solution (original, system, order, rank, j, true, zero))
+        {
+          fprintf (stderr, "The kernel vector of column %d is wrong\n", j);
+          n_failed++;
+        }
+    }
+
+  printf ("bool_gauss_recursive, rank %d of %d: %s\n",
+          rank, n_vars, n_failed == 0 ? "passed" : "failed");
+
+  bool_matrix_free (original, n_vars);
+  bool_matrix_free (system, n_vars);
+  free (order);
+  free (seen);
+  free (vars);
+  free (rhs);
+  free (zero);
+
+  return n_failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,404 @@
+/*
+ * testsolve.c
+ *
+ * Tests that the solve paths agree on ties. The plain solve, the factorized
+ * solve and the lightest solution of the factor must give the same one of
+ * the solutions of minimum weight, and the plus stencil must keep the order
+ * of cells, which the tied all-ones 11x2 field pins. The bits of a row past
+ * the columns are not lights. The solution of a problem must keep the fixed
+ * clicks, a click fixed both ways and a cell out of the field are rejected.
+ * The solutions of random solvable fields of
+ * states modulo a prime must turn them dark, and a single lit corner of a
+ * singular size must have no solution.
+ *
+ * Copyright (C) 2017 - Pavel Nikitin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "lightsoffsolver.h"
+
+/* Number of random fields per case */
+#define TEST_N_FIELDS 20
+
+/* Number of random clicks fixed per field */
+#define TEST_N_FIXES 4
+
+typedef struct
+{
+  int     n_rows;
+  int     n_cols;
+  Stencil stencil;
+} TestCase;
+
+/* The small boards are solved by tables, the others by the system */
+static const TestCase test_cases[] = {
+  { 4,  4,  STENCIL_PLUS  },
+  { 5,  5,  STENCIL_PLUS  },
+  { 11, 2,  STENCIL_PLUS  },
+  { 4,  9,  STENCIL_PLUS  },
+  { 8,  13, STENCIL_PLUS  },
+  { 16, 16, STENCIL_PLUS  },
+  { 9,  9,  STENCIL_CROSS },
+  { 8,  10, STENCIL_KING  },
+  { 10, 10, STENCIL_TORUS }
+};
+
+typedef struct
+{
+  int     prime;
+  int     n_rows;
+  int     n_cols;
+  Stencil stencil;
+} ModCase;
+
+/* The sizes are singular modulo the prime, a lit corner is not solvable */
+static const ModCase mod_cases[] = {
+  { 3, 4,  4,  STENCIL_PLUS  },
+  { 3, 8,  8,  STENCIL_CROSS },
+  { 5, 9,  9,  STENCIL_PLUS  },
+  { 5, 5,  5,  STENCIL_KING  },
+  { 7, 7,  7,  STENCIL_PLUS  },
+  { 7, 6,  6,  STENCIL_TORUS }
+};
+
+/* The lightest solution of the all-ones 11x2 field, which has 4 of weight 6 */
+static const char *pinned_11x2 = "01" "00" "10" "00" "01" "00"
+                                 "10" "00" "01" "00" "10";
+
+static uint64_t random_state = 0x2545F4914F6CDD1DULL;
+
+/*
+ * Gets the next number of splitmix generator.
+ */
+static uint64_t
+random_next (void)
+{
+  uint64_t z = (random_state += 0x9E3779B97F4A7C15ULL);
+
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+
+  return z ^ (z >> 31);
+}
+
+/*
+ * Compares two solutions cell by cell, %NULL is no solution.
+ */
+static bool
+same_solution (word_t **a,
+               word_t **b,
+               int      n_rows,
+               int      n_cols)
+{
+  int i, j;
+
+  if (a == NULL || b == NULL)
+    return a == b;
+
+  for (i = 0; i < n_rows; i++)
+    {
+      for (j = 0; j < n_cols; j++)
+        {
+          if (bool_array_get (a[i], j) != bool_array_get (b[i], j))
+            return false;
+        }
+    }
+
+  return true;
+}
+
+/*
+ * Solves the field by all paths and compares the solutions.
+ */
+static bool
+check_field (const TestCase        *test,
+             const LightsoffFactor *factor,
+             word_t               **field)
+{
+  word_t  **plain, **factored, ***lightest;
+  int       n_solutions, weight, factor_weight, n_found = 0, lightest_weight;
+  bool      success;
+
+  plain = lightsoff_solve (field, test->n_rows, test->n_cols, test->stencil,
+                           &n_solutions, &weight, NULL);
+  factored = lightsoff_factor_solve (factor, field, &n_solutions,
+                                     &factor_weight);
+  lightest = lightsoff_factor_lightest (factor, field, 1, &n_found,
+                                        &lightest_weight, NULL);
+
+  success = same_solution (plain, factored, test->n_rows, test->n_cols) &&
+            same_solution (plain, n_found > 0 ? lightest[0] : NULL,
+                           test->n_rows, test->n_cols) &&
+            (plain == NULL || (weight == factor_weight &&
+                               weight == lightest_weight));
+
+  bool_matrix_free (plain, test->n_rows);
+  bool_matrix_free (factored, test->n_rows);
+  lightsoff_solutions_free (lightest, n_found, test->n_rows);
+
+  return success;
+}
+
+/*
+ * Fixes random clicks of the solvable field and the first click both ways,
+ * the solution of the problem must keep the accepted ones.
+ */
+static bool
+check_problem (const TestCase        *test,
+               const LightsoffFactor *factor,
+               word_t               **field)
+{
+  LightsoffProblem *problem;
+  word_t          **solution = NULL;
+  int               rows[TEST_N_FIXES + 1], cols[TEST_N_FIXES + 1];
+  bool              clicks[TEST_N_FIXES + 1];
+  int               n_fixed = 0, n_solutions, weight, i;
+  bool              forced, forbidden, success;
+
+  problem = lightsoff_problem_new (factor, field);
+  if (problem == NULL)
+    return false;
+
+  /* A contradicting fix is not added, so only the accepted ones are kept */
+  for (i = 0; i < TEST_N_FIXES; i++)
+    {
+      rows[n_fixed] = random_next () % test->n_rows;
+      cols[n_fixed] = random_next () % test->n_cols;
+      clicks[n_fixed] = random_next () & 1;
+      if (lightsoff_problem_fix (problem, rows[n_fixed], cols[n_fixed],
+                                 clicks[n_fixed]))
+        n_fixed++;
+    }
+
+  /* Exactly one of the contradicting pair is accepted */
+  forced = lightsoff_problem_fix (problem, 0, 0, true);
+  forbidden = lightsoff_problem_fix (problem, 0, 0, false);
+  success = forced != forbidden;
+  rows[n_fixed] = 0;
+  cols[n_fixed] = 0;
+  clicks[n_fixed++] = forced;
+
+  success &= !lightsoff_problem_fix (problem, test->n_rows, 0, true) &&
+             !lightsoff_problem_fix (problem, 0, -1, true);
+
+  if (success)
+    solution = lightsoff_problem_solve (problem, &n_solutions, &weight);
+  success &= solution != NULL &&
+             lightsoff_verify (field, solution, test->n_rows, test->n_cols,
+                               test->stencil) == 1;
+  for (i = 0; i < n_fixed && success; i++)
+    success = bool_array_get (solution[rows[i]], cols[i]) == clicks[i];
+
+  bool_matrix_free (solution, test->n_rows);
+  lightsoff_problem_free (problem);
+
+  return success;
+}
+
+/*
+ * Solves the dark field with the bits past the columns set, the solution
+ * must be no clicks.
+ */
+static bool
+check_padding (int     n_rows,
+               int     n_cols,
+               Stencil stencil)
+{
+  word_t **field, **solution;
+  int      n_words = bool_array_n_words (n_cols);
+  int      n_solutions, weight, i;
+  bool     success;
+
+  field = bool_matrix_new (n_rows, n_cols);
+  for (i = 0; i < n_rows; i++)
+    field[i][n_words - 1] = ~(BIT_MASK (n_cols) - 1);
+
+  solution = lightsoff_solve (field, n_rows, n_cols, stencil, &n_solutions,
+                              &weight, NULL);
+  success = solution != NULL && weight == 0;
+
+  bool_matrix_free (solution, n_rows);
+  bool_matrix_free (field, n_rows);
+
+  return success;
+}
+
+/*
+ * Solves random solvable fields of states and the lit corner of the case.
+ */
+static int
+check_mod_case (const ModCase *test)
+{
+  ModMatrix *field, *clicks, *solution;
+  int        n_failed = 0, n_solutions, weight, f, i, j;
+
+  field = mod_matrix_new (test->prime, test->n_rows, test->n_cols);
+  clicks = mod_matrix_new (test->prime, test->n_rows, test->n_cols);
+  if (field == NULL || clicks == NULL)
+    {
+      mod_matrix_free (field);
+      mod_matrix_free (clicks);
+      return 1;
+    }
+
+  for (f = 0; f < TEST_N_FIELDS; f++)
+    {
+      for (i = 0; i < test->n_rows; i++)
+        {
+          for (j = 0; j < test->n_cols; j++)
+            {
+              mod_matrix_set (field, i, j, 0);
+              mod_matrix_set (clicks, i, j, random_next () % test->prime);
+            }
+        }
+      lightsoff_mod_apply (field, clicks, test->stencil);
+
+      solution = lightsoff_mod_solve (field, test->stencil, &n_solutions,
+                                      &weight, NULL);
+      if (solution == NULL ||
+          !lightsoff_mod_verify (field, solution, test->stencil))
+        {
+          fprintf (stderr, "%ix%i, stencil %i, modulo %i, field %i: the "
+                   "solution is wrong\n", test->n_rows, test->n_cols,
+                   test->stencil, test->prime, f);
+          n_failed++;
+        }
+      mod_matrix_free (solution);
+    }
+
+  /* The lit corner is out of the image of the singular system */
+  for (i = 0; i < test->n_rows; i++)
+    {
+      for (j = 0; j < test->n_cols; j++)
+        mod_matrix_set (field, i, j, i == 0 && j == 0);
+    }
+  solution = lightsoff_mod_solve (field, test->stencil, &n_solutions, &weight,
+                                  NULL);
+  if (solution != NULL || n_solutions != 0)
+    {
+      fprintf (stderr, "%ix%i, stencil %i, modulo %i: the lit corner is "
+               "solved\n", test->n_rows, test->n_cols, test->stencil,
+               test->prime);
+      n_failed++;
+    }
+
+  mod_matrix_free (solution);
+  mod_matrix_free (field);
+  mod_matrix_free (clicks);
+
+  return n_failed;
+}
+
+int
+main (void)
+{
+  const TestCase  *test;
+  LightsoffFactor *factor;
+  word_t         **field, **clicks, **solution;
+  int              n_failed = 0, n_solutions, weight, c, f, i, j;
+  bool             pinned;
+
+  /* The tied all-ones 11x2 field keeps its solution */
+  field = bool_matrix_new (11, 2);
+  for (i = 0; i < 11; i++)
+    field[i][0] = 3;
+  solution = lightsoff_solve (field, 11, 2, STENCIL_PLUS, &n_solutions,
+                              &weight, NULL);
+  pinned = solution != NULL && n_solutions == 4 && weight == 6;
+  for (i = 0; i < 11 && pinned; i++)
+    {
+      for (j = 0; j < 2; j++)
+        pinned &= bool_array_get (solution[i], j) ==
+                  (pinned_11x2[2 * i + j] == '1');
+    }
+  if (!pinned)
+    {
+      fprintf (stderr, "The all-ones 11x2 field has another solution\n");
+      n_failed++;
+    }
+  bool_matrix_free (solution, 11);
+  bool_matrix_free (field, 11);
+
+  /* The bits past the columns are not lights */
+  for (c = 0; c < (int) (sizeof test_cases / sizeof *test_cases); c++)
+    {
+      test = &test_cases[c];
+      if (!check_padding (test->n_rows, test->n_cols, test->stencil))
+        {
+          fprintf (stderr, "%ix%i, stencil %i: the padding bits are "
+                   "solved\n", test->n_rows, test->n_cols, test->stencil);
+          n_failed++;
+        }
+    }
+
+  /* The all-ones and random solvable fields by every path */
+  for (c = 0; c < (int) (sizeof test_cases / sizeof *test_cases); c++)
+    {
+      test = &test_cases[c];
+      factor = lightsoff_factor_new (test->n_rows, test->n_cols,
+                                     test->stencil, NULL);
+      field = bool_matrix_new (test->n_rows, test->n_cols);
+      clicks = bool_matrix_new (test->n_rows, test->n_cols);
+
+      for (f = 0; f <= TEST_N_FIELDS; f++)
+        {
+          for (i = 0; i < test->n_rows; i++)
+            {
+              bool_array_clear (field[i], bool_array_n_words (test->n_cols));
+              for (j = 0; j < test->n_cols; j++)
+                {
+                  bool_array_set (field[i], j, f == 0);
+                  bool_array_set (clicks[i], j, random_next () & 1);
+                }
+            }
+          if (f > 0)
+            lightsoff_apply (field, clicks, test->n_rows, test->n_cols,
+                             test->stencil);
+
+          if (!check_field (test, factor, field))
+            {
+              fprintf (stderr, "%ix%i, stencil %i, field %i: the solve "
+                       "paths differ\n", test->n_rows, test->n_cols,
+                       test->stencil, f);
+              n_failed++;
+            }
+
+          /* The all-ones field may have no solution */
+          if (f > 0 && !check_problem (test, factor, field))
+            {
+              fprintf (stderr, "%ix%i, stencil %i, field %i: the fixed "
+                       "clicks are not kept\n", test->n_rows, test->n_cols,
+                       test->stencil, f);
+              n_failed++;
+            }
+        }
+
+      bool_matrix_free (field, test->n_rows);
+      bool_matrix_free (clicks, test->n_rows);
+      lightsoff_factor_free (factor);
+    }
+
+  /* The fields of states modulo a prime */
+  for (c = 0; c < (int) (sizeof mod_cases / sizeof *mod_cases); c++)
+    n_failed += check_mod_case (&mod_cases[c]);
+
+  printf ("Solve paths: %s\n", n_failed == 0 ? "passed" : "failed");
+
+  return n_failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
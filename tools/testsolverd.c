@@ -0,0 +1,276 @@
+/*
+ * testsolverd.c
+ *
+ * Tests the protocol of the solver daemon on a socket pair. A random solvable
+ * field must be answered by a solution of it, an oversized request and a
+ * request of a wrong length by -1 and a closed connection. The requests of a
+ * size share one factor of the cache, and the least recently used factor is
+ * evicted out of the limit of the cache.
+ *
+ * Copyright (C) 2017 - Pavel Nikitin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "solverd.h"
+
+/* The sizes of the cache, none of them is solved by tables */
+#define TEST_SIZE_A 20, 20
+#define TEST_SIZE_B 24, 20
+#define TEST_SIZE_C 20, 24
+
+/* The largest packed field of the sizes */
+#define TEST_MAX_BYTES (24 * 3)
+
+static uint64_t random_state = 0x2545F4914F6CDD1DULL;
+
+/*
+ * Gets the next number of splitmix generator.
+ */
+static uint64_t
+random_next (void)
+{
+  uint64_t z = (random_state += 0x9E3779B97F4A7C15ULL);
+
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+
+  return z ^ (z >> 31);
+}
+
+/*
+ * Serves the request on a new socket pair and reads the response header.
+ * The rows of the response are read to @rows. Returns the result of
+ * solverd_serve().
+ */
+static bool
+serve (Solverd        *solverd,
+       Arena          *arena,
+       const uint32_t *header,
+       const uint8_t  *rows,
+       int             n_bytes,
+       int32_t        *reply,
+       uint8_t        *solution)
+{
+  int  fds[2];
+  bool kept;
+
+  reply[0] = reply[1] = reply[2] = 0;
+  if (socketpair (AF_UNIX, SOCK_STREAM, 0, fds) < 0)
+    {
+      perror ("socketpair");
+      exit (EXIT_FAILURE);
+    }
+
+  /* The request and the response fit the buffers of the socket */
+  if (write (fds[0], header, 3 * sizeof *header) != 3 * sizeof *header ||
+      write (fds[0], rows, n_bytes) != n_bytes)
+    perror ("write");
+
+  kept = solverd_serve (solverd, arena, NULL, fds[1]);
+
+  if (read (fds[0], reply, 3 * sizeof *reply) != 3 * sizeof *reply)
+    reply[1] = -3;
+  else if (reply[0] > 8 &&
+           read (fds[0], solution, reply[0] - 8) != reply[0] - 8)
+    reply[1] = -3;
+
+  close (fds[0]);
+  close (fds[1]);
+
+  return kept;
+}
+
+/*
+ * Solves a random solvable field of the size by the daemon and verifies the
+ * solution.
+ */
+static bool
+check_solve (Solverd *solverd,
+             Arena   *arena,
+             int      n_rows,
+             int      n_cols)
+{
+  uint8_t  rows[TEST_MAX_BYTES], solution[TEST_MAX_BYTES];
+  uint32_t header[3];
+  int32_t  reply[3];
+  word_t **field, **clicks, **result;
+  int      n_bytes = (n_cols + 7) / 8;
+  int      i, j;
+  bool     success;
+
+  field = bool_matrix_new (n_rows, n_cols);
+  clicks = bool_matrix_new (n_rows, n_cols);
+  result = bool_matrix_new (n_rows, n_cols);
+  for (i = 0; i < n_rows; i++)
+    {
+      for (j = 0; j < n_cols; j++)
+        bool_array_set (clicks[i], j, random_next () & 1);
+    }
+  lightsoff_apply (field, clicks, n_rows, n_cols, STENCIL_PLUS);
+
+  for (i = 0; i < n_rows; i++)
+    {
+      for (j = 0; j < n_bytes; j++)
+        rows[i * n_bytes + j] = 0;
+      for (j = 0; j < n_cols; j++)
+        rows[i * n_bytes + j / 8] |= bool_array_get (field[i], j) << j % 8;
+    }
+
+  header[0] = 8 + n_rows * n_bytes;
+  header[1] = n_rows;
+  header[2] = n_cols;
+  success = serve (solverd, arena, header, rows, n_rows * n_bytes, reply,
+                   solution) &&
+            reply[0] == 8 + n_rows * n_bytes && reply[1] > 0;
+
+  for (i = 0; i < n_rows && success; i++)
+    {
+      for (j = 0; j < n_cols; j++)
+        bool_array_set (result[i], j,
+                        solution[i * n_bytes + j / 8] >> j % 8 & 1);
+    }
+  success = success &&
+            lightsoff_verify (field, result, n_rows, n_cols,
+                              STENCIL_PLUS) == 1;
+
+  bool_matrix_free (field, n_rows);
+  bool_matrix_free (clicks, n_rows);
+  bool_matrix_free (result, n_rows);
+
+  return success;
+}
+
+/*
+ * Sends a malformed request, it must be answered by -1 and close the
+ * connection.
+ */
+static bool
+check_malformed (Solverd  *solverd,
+                 Arena    *arena,
+                 uint32_t  length,
+                 uint32_t  n_rows,
+                 uint32_t  n_cols)
+{
+  uint8_t  rows[TEST_MAX_BYTES] = { 0 }, solution[TEST_MAX_BYTES];
+  uint32_t header[3];
+  int32_t  reply[3];
+
+  header[0] = length;
+  header[1] = n_rows;
+  header[2] = n_cols;
+
+  return !serve (solverd, arena, header, rows, 0, reply, solution) &&
+         reply[0] == 8 && reply[1] == -1;
+}
+
+/*
+ * Checks the statistics of the cache.
+ */
+static bool
+check_stats (Solverd *solverd,
+             int      n_cached,
+             int      n_factorized)
+{
+  SolverdStats stats;
+
+  solverd_get_stats (solverd, &stats);
+
+  return stats.n_cached == n_cached && stats.n_factorized == n_factorized;
+}
+
+int
+main (void)
+{
+  Solverd      *solverd;
+  Arena        *arena = arena_new (0);
+  SolverdStats  stats;
+  size_t        bytes_a, bytes_b, bytes_c, limit;
+  int           n_failed = 0;
+
+  solverd = solverd_new (0, SOLVERD_CACHE_BYTES);
+  if (solverd == NULL || arena == NULL)
+    return EXIT_FAILURE;
+
+  if (!check_solve (solverd, arena, TEST_SIZE_A))
+    {
+      fprintf (stderr, "The solution of the field is wrong\n");
+      n_failed++;
+    }
+
+  if (!check_malformed (solverd, arena, 8 + 130 * 17, 130, 130))
+    {
+      fprintf (stderr, "The oversized request is served\n");
+      n_failed++;
+    }
+
+  if (!check_malformed (solverd, arena, 5, 20, 20) ||
+      !check_malformed (solverd, arena, 8, 0, 20))
+    {
+      fprintf (stderr, "The malformed request is served\n");
+      n_failed++;
+    }
+
+  /* The second request of the size shares the factor */
+  if (!check_solve (solverd, arena, TEST_SIZE_A) ||
+      !check_stats (solverd, 1, 1))
+    {
+      fprintf (stderr, "The factor of the size is not shared\n");
+      n_failed++;
+    }
+
+  /* The memory of each factor */
+  solverd_get_stats (solverd, &stats);
+  bytes_a = stats.bytes;
+  check_solve (solverd, arena, TEST_SIZE_B);
+  solverd_get_stats (solverd, &stats);
+  bytes_b = stats.bytes - bytes_a;
+  check_solve (solverd, arena, TEST_SIZE_C);
+  solverd_get_stats (solverd, &stats);
+  bytes_c = stats.bytes - bytes_a - bytes_b;
+  solverd_free (solverd);
+
+  /* The limit fits A with either of B and C, but not all three */
+  limit = bytes_a + (bytes_b > bytes_c ? bytes_b : bytes_c);
+  solverd = solverd_new (0, limit);
+  if (solverd == NULL)
+    return EXIT_FAILURE;
+
+  /* A is used after B, so C evicts B */
+  if (!check_solve (solverd, arena, TEST_SIZE_A) ||
+      !check_solve (solverd, arena, TEST_SIZE_B) ||
+      !check_solve (solverd, arena, TEST_SIZE_A) ||
+      !check_stats (solverd, 2, 2) ||
+      !check_solve (solverd, arena, TEST_SIZE_C) ||
+      !check_stats (solverd, 2, 3) ||
+      !check_solve (solverd, arena, TEST_SIZE_A) ||
+      !check_stats (solverd, 2, 3) ||
+      !check_solve (solverd, arena, TEST_SIZE_B) ||
+      !check_stats (solverd, 2, 4))
+    {
+      fprintf (stderr, "The least recently used factor is not evicted\n");
+      n_failed++;
+    }
+
+  solverd_free (solverd);
+  arena_free (arena);
+
+  printf ("Solver daemon: %s\n", n_failed == 0 ? "passed" : "failed");
+
+  return n_failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}